@@ -0,0 +1,433 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+#include <getopt.h>
+
+#include "model.h"
+#include "score.h"
+#include "stats.h"
+#include "partial.h"
+#include "tree.h"
+#include "random.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+using std::stringstream;
+
+//! Kernel results are summed here so the compiler cannot drop the work.
+
+static volatile double Sink = 0.0;
+
+//! Synthetic model and feature block of one benchmark configuration.
+//! Features are drawn from the model itself so no mixture underflows, as with real data.
+
+class Workload {
+	public:
+		Workload( unsigned int, unsigned int, unsigned int );
+
+		~Workload() { delete stats; delete tree; }
+
+		Model model;
+		Stats *stats;
+		GaussianTree *tree;		//!< Selection tree of the model, built on first use.
+
+		unsigned int Frames;		//!< Feature vectors per block.
+		vector<double> frames;		//!< Feature block as read by HTKReader (Frames*Dimension).
+		vector<float> samples;		//!< Feature block in HTK sample format (Frames*Dimension).
+		vector<const double *> centroids;	//!< Model means as a kmeans codebook.
+		vector<double> PR;		//!< Mixture scratch space.
+		unsigned int Ignored;		//!< Feature vectors the kernel ignored.
+};
+
+Workload::Workload( unsigned int mixtures, unsigned int length, unsigned int number ) : model( mixtures, length, 0.01 )
+{
+	Random generator( mixtures*131 + length );
+	unsigned int i = 0, j, T = 0;
+
+	stats = new Stats( mixtures, length );
+	tree = NULL;
+	Frames = number;
+	Ignored = 0;
+	frames.resize( (size_t)Frames*length );
+	samples.resize( (size_t)Frames*length );
+	centroids.resize( mixtures );
+	PR.resize( mixtures );
+
+	j = 0;
+	while( j < length )
+	{
+		model.globalvars[j++] = 1.0;
+	}
+
+	while( i < mixtures )
+	{
+		model.weights[i] = 1.0/(double)mixtures;
+		centroids[i] = model.means + i*length;
+		j = 0;
+
+		while( j < length )
+		{
+			model.means[i*length + j] = 2.0*generator.uniform() - 1.0;
+			model.variances[i*length + j] = 0.5 + generator.uniform();
+			j++;
+		}
+		i++;
+	}
+
+	while( T < Frames )
+	{
+		i = (unsigned int)( generator.uniform()*mixtures );
+		j = 0;
+
+		while( j < length )
+		{
+			samples[(size_t)T*length + j] = (float)( model.means[i*length + j] + sqrt( model.variances[i*length + j] )*generator.gauss() );
+			frames[(size_t)T*length + j] = (double)samples[(size_t)T*length + j];
+			j++;
+		}
+		T++;
+	}
+}
+
+//! Benchmarked kernel.
+
+typedef struct {
+	const char *Name;		//!< Kernel name.
+	double (*Flops)( unsigned int );	//!< Floating point operations per frame and mixture.
+	void (*Run)( Workload & );	//!< Process one feature block.
+}Kernel;
+
+//! Scoring: GMM::LogL and gmmscore.
+
+static double scoreFlops( unsigned int D ) { return 5.0*D + 6.0; }
+
+static void scoreRun( Workload &w )
+{
+	double LL = 0.0;
+	unsigned int processed = 0;
+
+	blockLogL( w.model, &w.frames[0], w.Frames, &w.PR[0], LL, processed, w.Ignored );
+	Sink += LL;
+}
+
+//! E-step: Speaker::modifyModel of gmmtrain.
+
+static double estepFlops( unsigned int D ) { return 10.0*D + 8.0; }
+
+static void estepRun( Workload &w )
+{
+	unsigned int T = 0;
+
+	while( T < w.Frames )
+	{
+		w.stats->accumulate( w.model, &w.frames[(size_t)T*w.model.Dimension] );
+		T++;
+	}
+	w.Ignored += w.stats->VectorsIgnored;
+	w.stats->VectorsIgnored = 0;
+	Sink += w.stats->N[0];
+}
+
+//! E-step keeping the 10 largest posteriors above 1e-3 (gmmtrain -k 10 -q 0.001).
+//! Flops are counted as for scoring, the accumulation is a small part.
+
+static void sparseRun( Workload &w )
+{
+	w.stats->prune( 10, 1e-3 );
+	estepRun( w );
+	w.stats->prune( 0, 0.0 );
+}
+
+//! Cluster assignment of kmeans.
+
+static double nearestFlops( unsigned int D ) { return 3.0*D; }
+
+static void nearestRun( Workload &w )
+{
+	unsigned int T = 0, sum = 0;
+
+	while( T < w.Frames )
+	{
+		sum += nearest( &w.centroids[0], w.model.MixtureNumber, w.model.Dimension, &w.samples[(size_t)T*w.model.Dimension], &w.PR[0] );
+		T++;
+	}
+	Sink += sum;
+}
+
+//! Scoring with partial distance elimination, beam 10 (gmmscore -B 10).
+
+static void partialScoreRun( Workload &w )
+{
+	PartialModel scorer( w.model, 10.0 );
+	double LL = 0.0;
+	unsigned int processed = 0;
+
+	scorer.blockLogL( &w.frames[0], w.Frames, LL, processed, w.Ignored );
+	Sink += LL;
+}
+
+//! Cluster assignment with partial distance elimination (kmeans PARTIAL 1).
+//! kmeans rebuilds the codebook once per pass, here once per block.
+
+static void partialNearestRun( Workload &w )
+{
+	PartialCodebook codebook( &w.centroids[0], w.model.MixtureNumber, w.model.Dimension );
+	unsigned int T = 0, sum = 0;
+
+	while( T < w.Frames )
+	{
+		sum += codebook.nearest( &w.samples[(size_t)T*w.model.Dimension], &w.PR[0] );
+		T++;
+	}
+	Sink += sum;
+}
+
+//! Scoring over the mixtures a selection tree picks, width 8 (gmmscore -G -W 8).
+//! The tree is built once per workload like gmmtree builds it once per UBM.
+
+static void treeScoreRun( Workload &w )
+{
+	if( w.tree == NULL )
+	{
+		w.tree = new GaussianTree();
+		w.tree->build( w.model );
+	}
+
+	SelectedModel scorer( w.model, *w.tree, 8 );
+	double LL = 0.0;
+	unsigned int processed = 0;
+
+	scorer.blockLogL( &w.frames[0], w.Frames, LL, processed, w.Ignored );
+	Sink += LL;
+}
+
+static const Kernel Kernels[] = {
+	{ "score", scoreFlops, scoreRun },
+	{ "estep", estepFlops, estepRun },
+	{ "estep_sparse", scoreFlops, sparseRun },
+	{ "nearest", nearestFlops, nearestRun },
+	{ "score_partial", scoreFlops, partialScoreRun },
+	{ "nearest_partial", nearestFlops, partialNearestRun },
+	{ "score_tree", scoreFlops, treeScoreRun },
+	{ NULL, NULL, NULL }
+};
+
+static double now()
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+}
+
+//! Parse a comma separated list of numbers.
+/*!	\param list.
+	\param values.
+	\return false if the list holds no number or a zero.
+*/
+
+bool parseList( string list, vector<unsigned int> &values )
+{
+	stringstream parse( list );
+	string item;
+
+	values.clear();
+
+	while( getline( parse, item, ',' ) )
+	{
+		values.push_back( atoi( item.c_str() ) );
+
+		if( values.back() == 0 )
+		{
+			return false;
+		}
+	}
+
+	return !values.empty();
+}
+
+void printUsage( void )
+{
+	cout << "gmmbench: help" << endl;
+	cout << endl;
+	cout << "Times the scoring, E-step and kmeans kernels on synthetic models and features" << endl;
+	cout << endl;
+	cout << "-h,  --help\t\tThis message" << endl;
+	cout << "-m,  --mixture\t\tMixture numbers (default 64,256,1024,4096)" << endl;
+	cout << "-d,  --dimension\tFeature vector dimensions (default 13,20,39,60)" << endl;
+	cout << "-n,  --number\t\tFeature vectors per block (default 100,1000,10000)" << endl;
+	cout << "-k,  --kernel\t\tKernels (default score,estep,nearest; estep_sparse, score_partial, nearest_partial, score_tree)" << endl;
+	cout << "-s,  --seconds\t\tMinimum time per measurement (default 0.1)" << endl;
+	cout << "-c,  --cycle\t\tMeasurements per configuration, the best is reported (default 3)" << endl;
+	cout << "-j,  --json\t\tOutput one JSON object per line" << endl;
+
+	exit( -1 );
+}
+
+int main( int argc, char *argv[] )
+{
+	int nextOption;
+
+	const char * shortOptions = "hm:d:n:k:s:c:j";
+
+	const struct option longOptions[] = {
+	{ "help", 0, NULL, 'h' },
+	{ "mixture", 1, NULL, 'm' },
+	{ "dimension", 1, NULL, 'd' },
+	{ "number", 1, NULL, 'n' },
+	{ "kernel", 1, NULL, 'k' },
+	{ "seconds", 1, NULL, 's' },
+	{ "cycle", 1, NULL, 'c' },
+	{ "json", 0, NULL, 'j' },
+	{ NULL, 0, NULL, 0 }
+	};
+
+	string mixtureList = "64,256,1024,4096", dimensionList = "13,20,39,60", numberList = "100,1000,10000", kernelList = "score,estep,nearest";
+	double seconds = 0.1;
+	unsigned int cycles = 3;
+	bool json = false;
+
+	do {
+		nextOption = getopt_long( argc, argv, shortOptions, longOptions, NULL );
+
+		switch( nextOption )
+		{
+			case 'm':
+				mixtureList = optarg;
+				break;
+
+			case 'd':
+				dimensionList = optarg;
+				break;
+
+			case 'n':
+				numberList = optarg;
+				break;
+
+			case 'k':
+				kernelList = optarg;
+				break;
+
+			case 's':
+				seconds = atof( optarg );
+				break;
+
+			case 'c':
+				cycles = atoi( optarg );
+				break;
+
+			case 'j':
+				json = true;
+				break;
+
+			case 'h':
+				printUsage();
+
+			case '?':
+				printUsage();
+
+			case -1:
+				break;
+
+			default:
+				abort();
+		}
+
+	} while( nextOption != -1 );
+
+	vector<unsigned int> mixtures, dimensions, numbers;
+	vector<const Kernel *> kernels;
+
+	if( !parseList( mixtureList, mixtures ) || !parseList( dimensionList, dimensions ) || !parseList( numberList, numbers ) || cycles == 0 )
+	{
+		cout << "-m, -d, -n, -c need positive numbers" << endl;
+		printUsage();
+	}
+
+	stringstream parse( kernelList );
+	string name;
+	unsigned int k;
+
+	while( getline( parse, name, ',' ) )
+	{
+		k = 0;
+		while( Kernels[k].Name != NULL && name != Kernels[k].Name )
+		{
+			k++;
+		}
+
+		if( Kernels[k].Name == NULL )
+		{
+			cout << "-k, --kernel unknown kernel " << name << endl;
+			printUsage();
+		}
+		kernels.push_back( &Kernels[k] );
+	}
+
+	if( !json )
+	{
+		cout << "kernel\tM\tD\tn\tframes/s\tns/(frame*M)\tGFLOP/s\tignored" << endl;
+	}
+
+	unsigned int m, d, n, c, blocks;
+	double start, elapsed, rate, best;
+
+	for( m = 0; m < mixtures.size(); m++ )
+	{
+		for( d = 0; d < dimensions.size(); d++ )
+		{
+			for( n = 0; n < numbers.size(); n++ )
+			{
+				Workload workload( mixtures[m], dimensions[d], numbers[n] );
+
+				for( k = 0; k < kernels.size(); k++ )
+				{
+					best = 0.0;
+
+					for( c = 0; c < cycles; c++ )
+					{
+						workload.Ignored = 0;
+						blocks = 0;
+						start = now();
+
+						do {
+							kernels[k]->Run( workload );
+							blocks++;
+							elapsed = now() - start;
+						} while( elapsed < seconds );
+
+						rate = (double)blocks*(double)numbers[n] / elapsed;
+						best = rate > best ? rate : best;
+					}
+
+					double nsPerPair = 1e9 / ( best*mixtures[m] );
+					double gflops = best*mixtures[m]*kernels[k]->Flops( dimensions[d] ) * 1e-9;
+					double ignored = (double)workload.Ignored / ( (double)blocks*numbers[n] );
+
+					if( json )
+					{
+						cout << "{\"kernel\":\"" << kernels[k]->Name << "\",\"mixtures\":" << mixtures[m] << ",\"dimension\":" << dimensions[d]
+							<< ",\"block\":" << numbers[n] << ",\"frames_per_s\":" << best << ",\"ns_per_frame_mixture\":" << nsPerPair
+							<< ",\"gflops\":" << gflops << ",\"ignored\":" << ignored << "}" << endl;
+					}
+					else
+					{
+						cout << kernels[k]->Name << "\t" << mixtures[m] << "\t" << dimensions[d] << "\t" << numbers[n] << "\t"
+							<< best << "\t" << nsPerPair << "\t" << gflops << "\t" << ignored << endl;
+					}
+				}
+			}
+		}
+	}
+
+	return 0;
+}
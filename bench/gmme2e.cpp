@@ -0,0 +1,495 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+#include <sys/stat.h>
+
+#include "htk.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+using std::ostream;
+using std::ofstream;
+using std::ifstream;
+using std::stringstream;
+
+//! Resource usage of one pipeline stage.
+
+typedef struct {
+	string		Name;		//!< stage name.
+	int		Status;		//!< exit status, -1 if the process did not exit normally.
+	double		Wall,		//!< elapsed time (s).
+			User,		//!< user CPU time (s).
+			System;		//!< system CPU time (s).
+	long		MaxRSS;		//!< peak resident set size (kB).
+	unsigned long long	ReadChars,	//!< bytes passed to read calls.
+			WriteChars,	//!< bytes passed to write calls.
+			ReadBytes,	//!< bytes fetched from storage.
+			WriteBytes;	//!< bytes sent to storage.
+	unsigned long long	Frames;		//!< feature vectors of the stage input.
+}Stage;
+
+static double now()
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+}
+
+//! Read the I/O accounting of a process that has exited but was not reaped yet.
+/*!	\param process id.
+	\param stage.
+*/
+
+void readIO( pid_t pid, Stage &stage )
+{
+	stringstream name;
+	string key;
+	unsigned long long value;
+
+	name << "/proc/" << pid << "/io";
+	ifstream Fio( name.str().c_str() );
+
+	while( Fio >> key >> value )
+	{
+		if( key == "rchar:" )
+			stage.ReadChars = value;
+		else if( key == "wchar:" )
+			stage.WriteChars = value;
+		else if( key == "read_bytes:" )
+			stage.ReadBytes = value;
+		else if( key == "write_bytes:" )
+			stage.WriteBytes = value;
+	}
+}
+
+//! Run one pipeline stage and record its resource usage.
+/*!	\param stage name, output goes to <work dir>/<name>.log.
+	\param work directory.
+	\param program and arguments.
+	\param feature vectors of the stage input.
+	\return stage record.
+*/
+
+Stage runStage( string name, string workDir, const vector<string> &args, unsigned long long frames )
+{
+	Stage stage;
+	vector<char *> argv;
+	unsigned int i = 0;
+
+	stage.Name = name;
+	stage.Status = -1;
+	stage.Wall = stage.User = stage.System = 0.0;
+	stage.MaxRSS = 0;
+	stage.ReadChars = stage.WriteChars = stage.ReadBytes = stage.WriteBytes = 0;
+	stage.Frames = frames;
+
+	while( i < args.size() )
+	{
+		argv.push_back( const_cast<char *>( args[i++].c_str() ) );
+	}
+	argv.push_back( NULL );
+
+	string logFile = workDir + "/" + name + ".log";
+	double start = now();
+	pid_t pid = fork();
+
+	if( pid < 0 )
+	{
+		cout << "Cannot start stage " << name << ": " << strerror( errno ) << endl;
+		return stage;
+	}
+
+	if( pid == 0 )
+	{
+		int fd = open( logFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+		if( fd >= 0 )
+		{
+			dup2( fd, 1 );
+			dup2( fd, 2 );
+			close( fd );
+		}
+
+		if( chdir( workDir.c_str() ) == 0 )
+		{
+			execv( argv[0], &argv[0] );
+		}
+		_exit( 127 );
+	}
+
+	siginfo_t info;
+	struct rusage usage;
+	int status;
+
+	// Keep the child as zombie until its I/O accounting is read
+	while( waitid( P_PID, pid, &info, WEXITED | WNOWAIT ) < 0 && errno == EINTR );
+	stage.Wall = now() - start;
+	readIO( pid, stage );
+
+	while( wait4( pid, &status, 0, &usage ) < 0 && errno == EINTR );
+
+	stage.Status = WIFEXITED( status ) ? WEXITSTATUS( status ) : -1;
+	stage.User = (double)usage.ru_utime.tv_sec + 1e-6*(double)usage.ru_utime.tv_usec;
+	stage.System = (double)usage.ru_stime.tv_sec + 1e-6*(double)usage.ru_stime.tv_usec;
+	stage.MaxRSS = usage.ru_maxrss;
+
+	return stage;
+}
+
+void writeStage( ostream &out, const Stage &stage )
+{
+	out << "{\"name\":\"" << stage.Name << "\",\"status\":" << stage.Status << ",\"frames\":" << stage.Frames
+		<< ",\"wall_s\":" << stage.Wall << ",\"user_s\":" << stage.User << ",\"system_s\":" << stage.System
+		<< ",\"frames_per_s\":" << ( stage.Wall > 0.0 ? stage.Frames / stage.Wall : 0.0 )
+		<< ",\"max_rss_kb\":" << stage.MaxRSS << ",\"read_chars\":" << stage.ReadChars << ",\"write_chars\":" << stage.WriteChars
+		<< ",\"read_bytes\":" << stage.ReadBytes << ",\"write_bytes\":" << stage.WriteBytes << "}";
+}
+
+void printUsage( void )
+{
+	cout << "gmme2e: help" << endl;
+	cout << endl;
+	cout << "End-to-end benchmark: synthetic corpus, kmeans, gmmtrain EM, gmmtrain MAP and gmmscore" << endl;
+	cout << "with world normalisation. Writes a JSON report with wall time, CPU time, peak RSS" << endl;
+	cout << "and I/O per stage." << endl;
+	cout << endl;
+	cout << "-h,  --help\t\tThis message" << endl;
+	cout << "-o,  --output\t\tWork directory (corpus, models and stage logs)" << endl;
+	cout << "-b,  --bindir\t\tDirectory of the tools (default: directory of gmme2e)" << endl;
+	cout << "-r,  --report\t\tReport file (default: stdout)" << endl;
+	cout << "-g,  --tag\t\tLabel stored in the report (e.g. commit id)" << endl;
+	cout << "-m,  --mixture\t\tMixture number (default 64)" << endl;
+	cout << "-d,  --dimension\tFeature vector dimension (default 20)" << endl;
+	cout << "-s,  --speakers\t\tNumber of background speakers (default 20)" << endl;
+	cout << "-l,  --length\t\tMean feature vectors per file (default 3000)" << endl;
+	cout << "-D,  --spread\t\tLog-normal spread of the file lengths (default 0.5)" << endl;
+	cout << "-t,  --tests\t\tTest files per test list (default 10)" << endl;
+	cout << "-c,  --cycle\t\tEM iterations (default 5)" << endl;
+	cout << "-S,  --split\t\tGrow the UBM by binary splitting with this many EM iterations per size instead of kmeans" << endl;
+	cout << "-G,  --tree\t\tBuild a selection tree of the UBM (gmmtree) and score with this tree width" << endl;
+
+	exit( -1 );
+}
+
+int main( int argc, char *argv[] )
+{
+	int nextOption;
+
+	const char * shortOptions = "ho:b:r:g:m:d:s:l:D:t:c:S:G:";
+
+	const struct option longOptions[] = {
+	{ "help", 0, NULL, 'h' },
+	{ "output", 1, NULL, 'o' },
+	{ "bindir", 1, NULL, 'b' },
+	{ "report", 1, NULL, 'r' },
+	{ "tag", 1, NULL, 'g' },
+	{ "mixture", 1, NULL, 'm' },
+	{ "dimension", 1, NULL, 'd' },
+	{ "speakers", 1, NULL, 's' },
+	{ "length", 1, NULL, 'l' },
+	{ "spread", 1, NULL, 'D' },
+	{ "tests", 1, NULL, 't' },
+	{ "cycle", 1, NULL, 'c' },
+	{ "split", 1, NULL, 'S' },
+	{ "tree", 1, NULL, 'G' },
+	{ NULL, 0, NULL, 0 }
+	};
+
+	string workDir, binDir, reportFile, tag;
+	string mixture = "64", dimension = "20", speakers = "20", length = "3000", spread = "0.5", tests = "10", cycle = "5", split, width;
+
+	do {
+		nextOption = getopt_long( argc, argv, shortOptions, longOptions, NULL );
+
+		switch( nextOption )
+		{
+			case 'o':
+				workDir = optarg;
+				break;
+
+			case 'b':
+				binDir = optarg;
+				break;
+
+			case 'r':
+				reportFile = optarg;
+				break;
+
+			case 'g':
+				tag = optarg;
+				break;
+
+			case 'm':
+				mixture = optarg;
+				break;
+
+			case 'd':
+				dimension = optarg;
+				break;
+
+			case 's':
+				speakers = optarg;
+				break;
+
+			case 'l':
+				length = optarg;
+				break;
+
+			case 'D':
+				spread = optarg;
+				break;
+
+			case 't':
+				tests = optarg;
+				break;
+
+			case 'c':
+				cycle = optarg;
+				break;
+
+			case 'S':
+				split = optarg;
+				break;
+
+			case 'G':
+				width = optarg;
+				break;
+
+			case 'h':
+				printUsage();
+
+			case '?':
+				printUsage();
+
+			case -1:
+				break;
+
+			default:
+				abort();
+		}
+
+	} while( nextOption != -1 );
+
+	if( workDir.empty() )
+	{
+		cout << "-o, --output not set" << endl;
+		printUsage();
+	}
+
+	char path[PATH_MAX];
+
+	if( binDir.empty() )
+	{
+		ssize_t size = readlink( "/proc/self/exe", path, sizeof( path ) - 1 );
+
+		if( size <= 0 )
+		{
+			cout << "Cannot find the tool directory, use -b" << endl;
+			exit( -1 );
+		}
+		path[size] = '\0';
+		binDir = path;
+		binDir.erase( binDir.rfind( '/' ) );
+	}
+
+	mkdir( workDir.c_str(), 0755 );
+
+	if( realpath( workDir.c_str(), path ) == NULL )
+	{
+		cout << "Cannot open work directory " << workDir << endl;
+		exit( -1 );
+	}
+	workDir = path;
+
+	if( realpath( binDir.c_str(), path ) == NULL )
+	{
+		cout << "Cannot open tool directory " << binDir << endl;
+		exit( -1 );
+	}
+	binDir = path;
+
+	vector<Stage> stages;
+	vector<string> args;
+
+	args.push_back( binDir + "/gmmsynth" );
+	args.push_back( "-o" ); args.push_back( workDir );
+	args.push_back( "-m" ); args.push_back( mixture );
+	args.push_back( "-d" ); args.push_back( dimension );
+	args.push_back( "-s" ); args.push_back( speakers );
+	args.push_back( "-l" ); args.push_back( length );
+	args.push_back( "-D" ); args.push_back( spread );
+	args.push_back( "-t" ); args.push_back( tests );
+	stages.push_back( runStage( "synth", workDir, args, 0 ) );
+
+	unsigned long long ubmFrames = 0, spkFrames = 0, tgtFrames = 0, impFrames = 0;
+
+	if( stages.back().Status == 0 )
+	{
+		ubmFrames = listFrames( workDir + "/ubm.list" );
+		spkFrames = listFrames( workDir + "/spk.list" );
+		tgtFrames = listFrames( workDir + "/tgt.list" );
+		impFrames = listFrames( workDir + "/imp.list" );
+		stages.back().Frames = ubmFrames + spkFrames + tgtFrames + impFrames;
+
+		if( split.empty() )
+		{
+			args.clear();
+			args.push_back( binDir + "/kmeans" );
+			args.push_back( "kmeans.cfg" );
+			stages.push_back( runStage( "kmeans", workDir, args, ubmFrames ) );
+		}
+	}
+
+	if( stages.back().Status == 0 )
+	{
+		args.clear();
+		args.push_back( binDir + "/gmmtrain" );
+
+		if( split.empty() )
+		{
+			args.push_back( "-i" ); args.push_back( "ubm.vq" );
+			args.push_back( "-t" ); args.push_back( "2" );
+		}
+		else
+		{
+			args.push_back( "-t" ); args.push_back( "3" );
+			args.push_back( "-s" ); args.push_back( split );
+		}
+		args.push_back( "-e" ); args.push_back( "1" );
+		args.push_back( "-l" ); args.push_back( "ubm.list" );
+		args.push_back( "-m" ); args.push_back( mixture );
+		args.push_back( "-d" ); args.push_back( dimension );
+		args.push_back( "-a" ); args.push_back( "7" );
+		args.push_back( "-c" ); args.push_back( cycle );
+		args.push_back( "-o" ); args.push_back( "ubm.mdl" );
+		args.push_back( "-r" ); args.push_back( "ubm.res" );
+		stages.push_back( runStage( "train_em", workDir, args, ubmFrames*atoi( cycle.c_str() ) ) );
+	}
+
+	if( stages.back().Status == 0 )
+	{
+		args.clear();
+		args.push_back( binDir + "/gmmtrain" );
+		args.push_back( "-i" ); args.push_back( "ubm.mdl" );
+		args.push_back( "-t" ); args.push_back( "1" );
+		args.push_back( "-e" ); args.push_back( "2" );
+		args.push_back( "-l" ); args.push_back( "spk.list" );
+		args.push_back( "-m" ); args.push_back( mixture );
+		args.push_back( "-d" ); args.push_back( dimension );
+		args.push_back( "-a" ); args.push_back( "2" );
+		args.push_back( "-c" ); args.push_back( "1" );
+		args.push_back( "-o" ); args.push_back( "spk.mdl" );
+		args.push_back( "-r" ); args.push_back( "spk.res" );
+		stages.push_back( runStage( "train_map", workDir, args, spkFrames ) );
+	}
+
+	if( stages.back().Status == 0 && !width.empty() )
+	{
+		args.clear();
+		args.push_back( binDir + "/gmmtree" );
+		args.push_back( "-i" ); args.push_back( "ubm.mdl" );
+		args.push_back( "-m" ); args.push_back( mixture );
+		args.push_back( "-d" ); args.push_back( dimension );
+		args.push_back( "-o" ); args.push_back( "ubm.tree" );
+		stages.push_back( runStage( "tree", workDir, args, 0 ) );
+	}
+
+	const char *testLists[] = { "tgt", "imp" };
+	unsigned long long testFrames[] = { tgtFrames, impFrames };
+	unsigned int i = 0;
+
+	while( i < 2 && stages.back().Status == 0 )
+	{
+		args.clear();
+		args.push_back( binDir + "/gmmscore" );
+		args.push_back( "-i" ); args.push_back( "spk.mdl" );
+		args.push_back( "-t" ); args.push_back( "1" );
+		args.push_back( "-w" ); args.push_back( "ubm.mdl" );
+		args.push_back( "-b" ); args.push_back( "1" );
+		args.push_back( "-l" ); args.push_back( string( testLists[i] ) + ".list" );
+		args.push_back( "-m" ); args.push_back( mixture );
+		args.push_back( "-d" ); args.push_back( dimension );
+		args.push_back( "-r" ); args.push_back( string( testLists[i] ) + ".res" );
+
+		if( !width.empty() )
+		{
+			args.push_back( "-G" ); args.push_back( "ubm.tree" );
+			args.push_back( "-W" ); args.push_back( width );
+		}
+		stages.push_back( runStage( string( "score_" ) + testLists[i], workDir, args, testFrames[i] ) );
+		i++;
+	}
+
+	ofstream Freport;
+
+	if( !reportFile.empty() )
+	{
+		Freport.open( reportFile.c_str() );
+
+		if( !Freport )
+		{
+			cout << "Cannot open report file " << reportFile << endl;
+			exit( -1 );
+		}
+	}
+
+	ostream &out = reportFile.empty() ? cout : Freport;
+	struct utsname system;
+	double wall = 0.0, cpu = 0.0;
+	bool failed = false;
+
+	uname( &system );
+
+	out << "{\"tag\":\"" << tag << "\",\"machine\":{\"system\":\"" << system.sysname << "\",\"release\":\"" << system.release
+		<< "\",\"arch\":\"" << system.machine << "\",\"cpus\":" << sysconf( _SC_NPROCESSORS_ONLN ) << "},"
+		<< "\"corpus\":{\"mixtures\":" << mixture << ",\"dimension\":" << dimension << ",\"speakers\":" << speakers
+		<< ",\"length\":" << length << ",\"spread\":" << spread << ",\"tests\":" << tests << ",\"em_iterations\":" << cycle
+		<< ",\"ubm_frames\":" << ubmFrames << ",\"enroll_frames\":" << spkFrames << ",\"test_frames\":" << tgtFrames + impFrames << "},"
+		<< "\"stages\":[";
+
+	i = 0;
+	while( i < stages.size() )
+	{
+		if( i > 0 )
+		{
+			out << ",";
+		}
+		out << endl << "\t";
+		writeStage( out, stages[i] );
+
+		wall += stages[i].Wall;
+		cpu += stages[i].User + stages[i].System;
+		failed |= stages[i].Status != 0;
+		i++;
+	}
+
+	out << endl << "],\"total\":{\"wall_s\":" << wall << ",\"cpu_s\":" << cpu << ",\"complete\":" << ( failed || stages.size() < ( split.empty() ? 6U : 5U ) + ( width.empty() ? 0U : 1U ) ? "false" : "true" ) << "}}" << endl;
+
+	if( failed )
+	{
+		cout << "Stage " << stages.back().Name << " failed, see " << workDir << "/" << stages.back().Name << ".log" << endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,460 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <getopt.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/utsname.h>
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+using std::map;
+using std::ifstream;
+using std::ofstream;
+using std::stringstream;
+
+//! One measured benchmark result.
+
+typedef struct {
+	double	Rate;		//!< frames per second.
+	double	Memory;		//!< peak resident set size (kB), 0 if not measured.
+}Measure;
+
+//! Numeric or string field of a flat JSON object held on one line.
+/*!	\param line.
+	\param field name.
+	\param value.
+	\return false if the field is missing.
+*/
+
+bool field( const string &line, string name, string &value )
+{
+	size_t pos = line.find( "\"" + name + "\":" );
+
+	if( pos == string::npos )
+	{
+		return false;
+	}
+
+	pos += name.size() + 3;
+
+	if( pos < line.size() && line[pos] == '"' )
+	{
+		size_t end = line.find( '"', pos + 1 );
+		value = line.substr( pos + 1, end - pos - 1 );
+	}
+	else
+	{
+		size_t end = line.find_first_of( ",}", pos );
+		value = line.substr( pos, end - pos );
+	}
+
+	return true;
+}
+
+double number( const string &line, string name )
+{
+	string value;
+
+	return field( line, name, value ) ? atof( value.c_str() ) : 0.0;
+}
+
+//! Machine class: architecture, CPU model and number of CPUs.
+
+string machineClass()
+{
+	struct utsname system;
+	ifstream Fcpu( "/proc/cpuinfo" );
+	string line, model = "unknown", slug;
+	size_t i;
+
+	uname( &system );
+
+	while( getline( Fcpu, line ) )
+	{
+		if( line.compare( 0, 10, "model name" ) == 0 && ( i = line.find( ':' ) ) != string::npos )
+		{
+			model = line.substr( i + 1 );
+			break;
+		}
+	}
+
+	for( i = 0; i < model.size(); i++ )
+	{
+		if( isalnum( model[i] ) )
+		{
+			slug += tolower( model[i] );
+		}
+		else if( !slug.empty() && slug[slug.size() - 1] != '-' )
+		{
+			slug += '-';
+		}
+	}
+
+	while( !slug.empty() && slug[slug.size() - 1] == '-' )
+	{
+		slug.erase( slug.size() - 1 );
+	}
+
+	stringstream name;
+
+	name << system.machine << "-" << slug << "-" << sysconf( _SC_NPROCESSORS_ONLN ) << "cpu";
+
+	return name.str();
+}
+
+//! Run a command and collect its output lines.
+/*!	\param command line.
+	\param output lines.
+	\return false if the command fails.
+*/
+
+bool run( string command, vector<string> &lines )
+{
+	FILE *pipe = popen( command.c_str(), "r" );
+	char buffer[4096];
+
+	if( pipe == NULL )
+	{
+		return false;
+	}
+
+	string line;
+
+	while( fgets( buffer, sizeof( buffer ), pipe ) != NULL )
+	{
+		line += buffer;
+
+		if( line[line.size() - 1] == '\n' )
+		{
+			lines.push_back( line );
+			line.clear();
+		}
+	}
+
+	return pclose( pipe ) == 0;
+}
+
+//! Run the kernel micro-benchmarks and the end-to-end benchmark.
+/*!	\param tool directory.
+	\param work directory of the end-to-end benchmark.
+	\param kernel benchmark arguments.
+	\param results by benchmark key.
+	\return false if a benchmark fails.
+*/
+
+bool measure( string binDir, string workDir, string benchArgs, map<string, Measure> &results )
+{
+	vector<string> lines;
+	string kernel, stage;
+	unsigned int i;
+
+	cout << "Running kernel benchmarks" << endl;
+	if( !run( binDir + "/gmmbench -j " + benchArgs, lines ) )
+	{
+		cout << "gmmbench failed" << endl;
+		return false;
+	}
+
+	for( i = 0; i < lines.size(); i++ )
+	{
+		if( field( lines[i], "kernel", kernel ) )
+		{
+			stringstream key;
+			Measure m;
+
+			key << "kernel " << kernel << " m" << number( lines[i], "mixtures" ) << " d" << number( lines[i], "dimension" ) << " n" << number( lines[i], "block" );
+			m.Rate = number( lines[i], "frames_per_s" );
+			m.Memory = 0.0;
+			results[key.str()] = m;
+		}
+	}
+
+	cout << "Running end-to-end benchmark" << endl;
+	lines.clear();
+	if( !run( binDir + "/gmme2e -o " + workDir, lines ) )
+	{
+		cout << "gmme2e failed" << endl;
+		return false;
+	}
+
+	for( i = 0; i < lines.size(); i++ )
+	{
+		// Stage objects are printed one per line
+		if( field( lines[i], "name", stage ) && stage != "synth" )
+		{
+			Measure m;
+
+			m.Rate = number( lines[i], "frames_per_s" );
+			m.Memory = number( lines[i], "max_rss_kb" );
+			results["e2e " + stage] = m;
+		}
+	}
+
+	return true;
+}
+
+bool readBaseline( string file, map<string, Measure> &baseline )
+{
+	ifstream Fbase( file.c_str() );
+	string line, key;
+
+	if( !Fbase )
+	{
+		return false;
+	}
+
+	while( getline( Fbase, line ) )
+	{
+		if( field( line, "key", key ) )
+		{
+			Measure m;
+
+			m.Rate = number( line, "frames_per_s" );
+			m.Memory = number( line, "max_rss_kb" );
+			baseline[key] = m;
+		}
+	}
+
+	return true;
+}
+
+bool writeBaseline( string file, string machine, string benchArgs, const map<string, Measure> &results )
+{
+	ofstream Fbase( file.c_str() );
+	map<string, Measure>::const_iterator r;
+
+	if( !Fbase )
+	{
+		return false;
+	}
+
+	Fbase << "{\"machine\":\"" << machine << "\",\"bench_args\":\"" << benchArgs << "\",\"entries\":[" << endl;
+
+	for( r = results.begin(); r != results.end(); r++ )
+	{
+		Fbase << "{\"key\":\"" << r->first << "\",\"frames_per_s\":" << r->second.Rate << ",\"max_rss_kb\":" << r->second.Memory << "}";
+		Fbase << ( ++map<string, Measure>::const_iterator( r ) == results.end() ? "" : "," ) << endl;
+	}
+
+	Fbase << "]}" << endl;
+
+	return (bool)Fbase;
+}
+
+void printUsage( void )
+{
+	cout << "gmmgate: help" << endl;
+	cout << endl;
+	cout << "Performance regression gate: runs gmmbench and gmme2e and compares frames/s and peak" << endl;
+	cout << "memory with the baseline of the machine class. Exits non-zero on a regression." << endl;
+	cout << endl;
+	cout << "-h,  --help\t\tThis message" << endl;
+	cout << "-B,  --baselines\tBaseline directory (default bench/baselines of the source tree)" << endl;
+	cout << "-c,  --class\t\tMachine class (default: <arch>-<cpu model>-<cpus>cpu)" << endl;
+	cout << "-b,  --bindir\t\tDirectory of the tools (default: directory of gmmgate)" << endl;
+	cout << "-o,  --output\t\tWork directory of the end-to-end benchmark (default /tmp/gmmgate)" << endl;
+	cout << "-x,  --threshold\tAllowed relative regression (default 0.1)" << endl;
+	cout << "-r,  --repeat\t\tRun the benchmarks this many times and keep the best result (default 2)" << endl;
+	cout << "-u,  --update\t\tRecord the measurements as new baseline instead of comparing" << endl;
+
+	exit( -1 );
+}
+
+int main( int argc, char *argv[] )
+{
+	int nextOption;
+
+	const char * shortOptions = "hB:c:b:o:x:r:u";
+
+	const struct option longOptions[] = {
+	{ "help", 0, NULL, 'h' },
+	{ "baselines", 1, NULL, 'B' },
+	{ "class", 1, NULL, 'c' },
+	{ "bindir", 1, NULL, 'b' },
+	{ "output", 1, NULL, 'o' },
+	{ "threshold", 1, NULL, 'x' },
+	{ "repeat", 1, NULL, 'r' },
+	{ "update", 0, NULL, 'u' },
+	{ NULL, 0, NULL, 0 }
+	};
+
+#ifdef GMM_SOURCE_DIR
+	string baseDir = GMM_SOURCE_DIR "/bench/baselines";
+#else
+	string baseDir = "bench/baselines";
+#endif
+	string machine = machineClass(), binDir, workDir = "/tmp/gmmgate";
+	double threshold = 0.1;
+	unsigned int repeat = 2;
+	bool update = false;
+
+	// Fixed grid so measurements stay comparable with the baseline
+	const string benchArgs = "-m 64,512,2048 -d 20,39 -n 1000 -s 0.2 -c 3";
+
+	do {
+		nextOption = getopt_long( argc, argv, shortOptions, longOptions, NULL );
+
+		switch( nextOption )
+		{
+			case 'B':
+				baseDir = optarg;
+				break;
+
+			case 'c':
+				machine = optarg;
+				break;
+
+			case 'b':
+				binDir = optarg;
+				break;
+
+			case 'o':
+				workDir = optarg;
+				break;
+
+			case 'x':
+				threshold = atof( optarg );
+				break;
+
+			case 'r':
+				repeat = atoi( optarg );
+				break;
+
+			case 'u':
+				update = true;
+				break;
+
+			case 'h':
+				printUsage();
+
+			case '?':
+				printUsage();
+
+			case -1:
+				break;
+
+			default:
+				abort();
+		}
+
+	} while( nextOption != -1 );
+
+	if( binDir.empty() )
+	{
+		char path[PATH_MAX];
+		ssize_t size = readlink( "/proc/self/exe", path, sizeof( path ) - 1 );
+
+		if( size <= 0 )
+		{
+			cout << "Cannot find the tool directory, use -b" << endl;
+			return -1;
+		}
+		path[size] = '\0';
+		binDir = path;
+		binDir.erase( binDir.rfind( '/' ) );
+	}
+
+	string baseFile = baseDir + "/" + machine + ".json";
+	map<string, Measure> baseline, results;
+
+	if( !update && !readBaseline( baseFile, baseline ) )
+	{
+		cout << "No baseline for machine class " << machine << " (" << baseFile << "), record one with -u" << endl;
+		return -1;
+	}
+
+	// Noise only ever slows a run down, so the best of several runs is the most stable
+	while( repeat-- > 0 )
+	{
+		map<string, Measure> run;
+		map<string, Measure>::iterator m, best;
+
+		if( !measure( binDir, workDir, benchArgs, run ) )
+		{
+			return -1;
+		}
+
+		for( m = run.begin(); m != run.end(); m++ )
+		{
+			best = results.find( m->first );
+
+			if( best == results.end() )
+			{
+				results[m->first] = m->second;
+			}
+			else
+			{
+				best->second.Rate = m->second.Rate > best->second.Rate ? m->second.Rate : best->second.Rate;
+				best->second.Memory = m->second.Memory < best->second.Memory ? m->second.Memory : best->second.Memory;
+			}
+		}
+	}
+
+	if( update )
+	{
+		if( !writeBaseline( baseFile, machine, benchArgs, results ) )
+		{
+			cout << "Cannot write baseline " << baseFile << endl;
+			return -1;
+		}
+
+		cout << "Baseline written to " << baseFile << endl;
+		return 0;
+	}
+
+	map<string, Measure>::iterator b, r;
+	unsigned int regressions = 0;
+
+	cout << "Machine class " << machine << ", threshold " << threshold*100.0 << " %" << endl;
+	cout.setf( std::ios::fixed );
+	cout.precision( 1 );
+	cout << "benchmark\tbaseline frames/s\tframes/s\tchange\tbaseline kB\tkB\tchange" << endl;
+
+	for( b = baseline.begin(); b != baseline.end(); b++ )
+	{
+		r = results.find( b->first );
+
+		if( r == results.end() )
+		{
+			cout << b->first << "\tmissing from this run" << endl;
+			regressions++;
+			continue;
+		}
+
+		double rate = b->second.Rate > 0.0 ? r->second.Rate/b->second.Rate - 1.0 : 0.0;
+		double memory = b->second.Memory > 0.0 ? r->second.Memory/b->second.Memory - 1.0 : 0.0;
+		bool slower = rate < -threshold, larger = memory > threshold;
+
+		cout << b->first << "\t" << b->second.Rate << "\t" << r->second.Rate << "\t" << std::showpos << rate*100.0 << " %" << std::noshowpos
+			<< ( slower ? " REGRESSION" : "" ) << "\t" << b->second.Memory << "\t" << r->second.Memory << "\t" << std::showpos << memory*100.0 << " %"
+			<< std::noshowpos << ( larger ? " REGRESSION" : "" ) << endl;
+
+		if( slower || larger )
+		{
+			regressions++;
+		}
+	}
+
+	if( regressions > 0 )
+	{
+		cout << regressions << " benchmark(s) regressed beyond " << threshold*100.0 << " %" << endl;
+		return 1;
+	}
+
+	cout << "No regression" << endl;
+
+	return 0;
+}
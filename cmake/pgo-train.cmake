@@ -0,0 +1,30 @@
+# PGO training workload, run by the pgo-train target:
+#   cmake -DKMEANS=... -DGMMTRAIN=... -DGMMSCORE=... -DGMMSYNTH=... -DWORK_DIR=... -P pgo-train.cmake
+# Covers the hot paths of every tool: kmeans clustering, UBM EM training from the VQ
+# codebook, MAP adaption and scoring against the UBM.
+
+foreach(var KMEANS GMMTRAIN GMMSCORE GMMSYNTH WORK_DIR)
+	if(NOT DEFINED ${var})
+		message(FATAL_ERROR "${var} not set")
+	endif()
+endforeach()
+
+set(mixture 32)
+set(dimension 20)
+
+function(run)
+	execute_process(COMMAND ${ARGN} WORKING_DIRECTORY ${WORK_DIR} RESULT_VARIABLE status OUTPUT_QUIET)
+	if(NOT status EQUAL 0)
+		message(FATAL_ERROR "PGO workload step failed (${status}): ${ARGN}")
+	endif()
+endfunction()
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+run(${GMMSYNTH} -o ${WORK_DIR} -m ${mixture} -d ${dimension} -s 20 -l 3000)
+run(${KMEANS} ${WORK_DIR}/kmeans.cfg)
+run(${GMMTRAIN} -i ubm.vq -t 2 -e 1 -l ubm.list -m ${mixture} -d ${dimension} -a 7 -c 5 -o ubm.mdl -r ubm.res)
+run(${GMMTRAIN} -i ubm.mdl -t 1 -e 2 -l spk.list -m ${mixture} -d ${dimension} -a 2 -c 2 -o spk.mdl -r spk.res)
+run(${GMMSCORE} -i spk.mdl -t 1 -w ubm.mdl -b 1 -l tgt.list -m ${mixture} -d ${dimension} -r score.res)
+run(${GMMSCORE} -i spk.mdl -t 1 -w ubm.mdl -b 1 -l imp.list -m ${mixture} -d ${dimension} -r score.res)
@@ -0,0 +1,207 @@
+#include "cohort.h"
+#include "profile.h"
+
+Cohort::Cohort( const GMM &world, unsigned long long worldHash, unsigned int top, string cacheDir, unsigned int block ) : World( world )
+{
+	WorldHash = worldHash;
+	Top = top;
+	CacheDir = cacheDir;
+	Block = block;
+	WorldLL = 0.0;
+	Frames = 0;
+	Cached = 0;
+
+	frames.resize( (size_t)Block*World.getModel().Dimension );
+	PR.resize( Top );
+}
+
+//! Add a model, it has to be adapted from the UBM.
+
+void Cohort::add( GMM *model )
+{
+	Models.push_back( model );
+}
+
+void Cohort::clear()
+{
+	Models.clear();
+}
+
+//! Score the files of a data list as one trial, results in ModelLL, Processed and WorldLL.
+/*!	\param data files.
+*/
+
+void Cohort::score( const vector<string> &files )
+{
+	const unsigned int D = World.getModel().Dimension, N = Models.size();
+	unsigned int f = 0, number, offset, T, k, worldProcessed = 0, worldIgnored = 0;
+	double value;
+	int status;
+
+	ModelLL.assign( N, 0.0 );
+	Processed.assign( N, 0 );
+	WorldLL = 0.0;
+	Frames = 0;
+	Cached = 0;
+
+	while( f < files.size() )
+	{
+		status = Side.prepare( World.getModel(), WorldHash, Top, files[f], CacheDir, Block );
+
+		if( status != 0 )
+		{
+			ScoreError( Side.Error, status );
+		}
+
+		Cached += Side.Cached ? 1 : 0;
+		WorldLL += Side.worldLL( worldProcessed, worldIgnored );
+
+		if( !Reader.open( files[f] ) )
+		{
+			ScoreError( "SetupData(): Cannot open data file " + files[f], -502 );
+		}
+
+		offset = 0;
+
+		while( ( number = Reader.read( &frames[0], Block, D ) ) > 0 )
+		{
+			ProfileTimer timer( PHASE_SCORE );
+
+			if( offset + number > Side.Frames )
+			{
+				ScoreError( "Score(): Sidecar of " + files[f] + " has too few feature vectors", -1006 );
+			}
+
+			T = 0;
+			while( T < number )
+			{
+				if( Side.LL[offset + T] != -HUGE_VAL )
+				{
+					k = 0;
+					while( k < N )
+					{
+						if( topLogL( Models[k]->getModel(), &frames[(size_t)T*D], &Side.Index[(size_t)( offset + T )*Top], Top, &PR[0], value ) )
+						{
+							ModelLL[k] += value;
+							Processed[k]++;
+						}
+						k++;
+					}
+				}
+				T++;
+			}
+
+			profileWork( PHASE_SCORE, (unsigned long long)number*Top*N );
+			offset += number;
+		}
+
+		Frames += offset;
+		Reader.close();
+		f++;
+	}
+
+	if( worldProcessed == 0 )
+	{
+		ScoreError( "Score(): No feature vector of the data list could be scored", -1007 );
+	}
+
+	k = 0;
+	while( k < N )
+	{
+		if( Processed[k] == 0 )
+		{
+			ScoreError( "Score(): No feature vector of the data list could be scored", -1007 );
+		}
+
+		ModelLL[k] /= (double)Processed[k];
+		k++;
+	}
+
+	WorldLL /= (double)worldProcessed;
+}
+
+//! Z-norm statistics of the models, every impostor data file is one trial.
+/*!	\param impostor data files, at least two.
+	\param statistics of every model.
+*/
+
+void Cohort::impostorStats( const vector<string> &impostors, vector<NormStats> &stats )
+{
+	const unsigned int N = Models.size(), F = impostors.size();
+	vector<double> values( (size_t)N*F ), sum( N, 0.0 );
+	vector<string> trial( 1 );
+	unsigned int f = 0, k;
+	double diff, square;
+
+	if( F < 2 )
+	{
+		ScoreError( "ImpostorStats(): Z-norm needs at least two impostor data files", -1100 );
+	}
+
+	while( f < F )
+	{
+		trial[0] = impostors[f];
+		score( trial );
+
+		k = 0;
+		while( k < N )
+		{
+			values[(size_t)f*N + k] = ModelLL[k] - WorldLL;
+			sum[k] += values[(size_t)f*N + k];
+			k++;
+		}
+		f++;
+	}
+
+	// Two passes: the squares are summed around the mean, no cancellation
+	stats.resize( N );
+	k = 0;
+
+	while( k < N )
+	{
+		stats[k].Trials = F;
+		stats[k].Mean = sum[k] / (double)F;
+
+		square = 0.0;
+		f = 0;
+		while( f < F )
+		{
+			diff = values[(size_t)f*N + k] - stats[k].Mean;
+			square += diff*diff;
+			f++;
+		}
+
+		stats[k].Deviation = sqrt( square / (double)( F - 1 ) );
+		k++;
+	}
+}
+
+bool loadNorm( string modelFile, const string &key, NormStats &stats )
+{
+	ifstream Fnorm( ( modelFile + ".znorm" ).c_str() );
+	string magic, stored;
+
+	if( !Fnorm )
+	{
+		return false;
+	}
+
+	Fnorm >> magic >> stored >> stats.Mean >> stats.Deviation >> stats.Trials;
+
+	return Fnorm && magic == ZNORM_MAGIC && stored == key;
+}
+
+bool saveNorm( string modelFile, const string &key, const NormStats &stats )
+{
+	ofstream Fnorm( ( modelFile + ".znorm" ).c_str() );
+
+	if( !Fnorm )
+	{
+		return false;
+	}
+
+	Fnorm.precision( 17 );
+	Fnorm << ZNORM_MAGIC << " " << key << " " << stats.Mean << " " << stats.Deviation << " " << stats.Trials << endl;
+
+	return (bool)Fnorm;
+}
@@ -0,0 +1,92 @@
+#ifndef COHORT_H
+#define COHORT_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include "gmm.h"
+
+//! Z-norm statistics file identifier (first word of a model's .znorm file).
+
+#define ZNORM_MAGIC "ZNORM1"
+
+//! Smallest score standard deviation Z-norm and T-norm divide by; impostor or cohort scores
+//! spreading less leave the normalisation undefined.
+
+#define NORM_MIN_DEVIATION 1e-10
+
+//! Z-norm statistics of a model: mean and standard deviation of its scores against an
+//! impostor data list, one trial per data file.
+
+typedef struct {
+	double		Mean,		//!< mean impostor score.
+			Deviation;	//!< standard deviation of the impostor scores.
+	unsigned int	Trials;		//!< number of impostor trials.
+}NormStats;
+
+//! One pass scoring of several models adapted from the same UBM.
+//! Every data file is read once: the UBM scores and top mixtures come from its sidecar
+//! (see Sidecar), every model is evaluated over the top mixtures of every feature vector.
+//! Feature vectors the UBM ignores are ignored for all models.
+
+class Cohort {
+	public:
+		//! Constructor.
+		/*!	\param UBM (world model).
+			\param content hash of the UBM file.
+			\param UBM mixtures scored per feature vector.
+			\param sidecar cache directory, empty to compute the sidecars without storing them.
+			\param feature vectors read at a time.
+		*/
+		Cohort( const GMM &, unsigned long long, unsigned int, string, unsigned int );
+
+		void add( GMM * );
+		void clear();
+		void score( const vector<string> & );
+		void impostorStats( const vector<string> &, vector<NormStats> & );
+
+		unsigned int size() { return Models.size(); }	//!< The number of models.
+
+		vector<double> ModelLL;		//!< Average log-likelihood of every model.
+		vector<unsigned int> Processed;	//!< Feature vectors scored by every model.
+		double WorldLL;			//!< Average UBM log-likelihood.
+		unsigned int Frames;		//!< Feature vectors read.
+		unsigned int Cached;		//!< Data files whose sidecar was cached.
+
+	private:
+
+		const GMM &World;		//!< UBM.
+		unsigned long long WorldHash;	//!< Content hash of the UBM file.
+		unsigned int Top;		//!< UBM mixtures scored per feature vector.
+		string CacheDir;		//!< Sidecar cache directory.
+		unsigned int Block;		//!< Feature vectors read at a time.
+
+		vector<GMM *> Models;		//!< Scored models, not owned.
+		Sidecar Side;			//!< Sidecar of the current data file.
+		HTKReader Reader;		//!< Data file reader.
+		vector<double> frames;		//!< Feature vector block.
+		vector<double> PR;		//!< Top mixture likelihoods.
+};
+
+//! Load the Z-norm statistics stored next to a model (model file + ".znorm").
+//! The statistics are only used when they were computed for the same model, UBM, impostor
+//! list and top mixture number.
+/*!	\param model file.
+	\param statistics key: model, UBM and impostor list content hashes and top mixture number.
+	\param statistics.
+	\return false if there are no matching statistics.
+*/
+
+bool loadNorm( string, const string &, NormStats & );
+
+//! Store the Z-norm statistics next to a model, see loadNorm().
+/*!	\param model file.
+	\param statistics key.
+	\param statistics.
+	\return false if the file cannot be written.
+*/
+
+bool saveNorm( string, const string &, const NormStats & );
+
+#endif
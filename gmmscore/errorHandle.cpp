@@ -7,3 +7,10 @@ void InClassError( GMM *model, string Message, int ErrorCode )
 	cout << Message << endl;
 	exit(ErrorCode);
 }
+
+void ScoreError( string Message, int ErrorCode )
+{
+	cout << "Error Encountered!" << endl;
+	cout << Message << endl;
+	exit( ErrorCode );
+}
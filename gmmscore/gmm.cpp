@@ -1,428 +1,147 @@
 #include "gmm.h"
 
-GMM::GMM( string modelInitFile, unsigned int initType, unsigned int mixtures, unsigned int length, double floor, unsigned int dataSize )
+GMM::GMM( string modelInitFile, unsigned int initType, unsigned int mixtures, unsigned int length, double floor, unsigned int dataSize, string baseFile, bool shared )
 {
 	MixtureNumber = mixtures;
 	Dimension = length;
 	vFloor = floor;
 	MaxDataNumber = dataSize;
+	Partial = NULL;
+	Selected = NULL;
 
-	means = new vector< valarray<double> * > (MixtureNumber);
-	variances = new vector< valarray<double> * > (MixtureNumber);
-	dataParm = new vector< valarray<double> * >(MaxDataNumber);
+	Memory.reserve( arenaSize( parameterNumber( MixtureNumber, Dimension ) ) + arenaSize( (size_t)MaxDataNumber*Dimension ) + arenaSize( MixtureNumber ) );
 
-	weights = new valarray<double>( 0.0, MixtureNumber );
-	globalvars = new valarray<double>( 0.0, Dimension );
-	distance = new valarray<double>( 0.0, Dimension );
-	PR = new valarray<double>( 0.0, MixtureNumber );
+	model = new Model( MixtureNumber, Dimension, vFloor, &Memory );
+	dataParm = Memory.doubles( (size_t)MaxDataNumber*Dimension );
+	PR = Memory.doubles( MixtureNumber );
 
-	int i = 0;
+	int status = model->load( modelInitFile, initType, baseFile, shared );
 
-	while( i < MixtureNumber )
+	if( status != 0 )
 	{
-		(*means)[i] = new valarray<double>( 0.0, Dimension );
-		(*variances)[i] = new valarray<double>( 0.0, Dimension );
-		i++;
-	}
-
-	i = 0;
-	while( i < MaxDataNumber )
-	{
-		(*dataParm)[i++] = new valarray<double>( 0.0, Dimension );
-	}
-
-	if( initType == 1 )
-	{
-		loadModel( modelInitFile );
-	}
-	else if( initType == 2 )
-	{
-		loadVQ( modelInitFile );
-	}
-	else
-	{
-		InClassError( this, "GMM(): InitType error value specified not known.", -100 );
+		InClassError( this, model->Error, status );
 	}
 }
 
-void GMM::loadModel( string modelFile )
-{
-	Finit.open( modelFile.c_str(), ios_base::binary );
-
-	Finit.read( reinterpret_cast <char *>( &Hmodel ), sizeof( ModelHeader ) );
-
-	if( !Finit )
-	{
-		InClassError( this, "LoadModel(): Cannot open model file " + modelFile + " .", -200 );
-	}
-
-	if( Hmodel.MixtureNumber != MixtureNumber )
-	{
-		InClassError( this, "LoadModel(): Model file reports non-equal mixture number", -201 );
-	}
-
-	if( Hmodel.Dimension != Dimension )
-	{
-		InClassError( this, "LoadModel(): Model file reports non-equal feature vector dimension", -202 );
-	}
-
-	int i = 0;
-	double value;
-
-	while( i < Dimension )
-	{
-		Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
-		(*globalvars)[i++] = value;
-	}
-
-	int j = 0;
-	i = 0;
-
-	while( i < MixtureNumber )
-	{
-		Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
-		(*weights)[i] = value;
-
-		while( j < Dimension )
-		{
-			Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
-			(*(*means)[i])[j] = value;
-
-			Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
-			(*(*variances)[i])[j++] = value;
-		}
-		j = 0;
-		i++;
-	}
-	
-	Finit.close();
-}
-
-void GMM::loadVQ( string dataFile )
-{
-	Finit.open( dataFile.c_str() );
-
-	if( !Finit )
-	{
-		InClassError( this, "LoadVQ(): Cannot open VQcodebook file " + dataFile + " .", -300 );
-	}
-
-	int SkipNumber = 6*Dimension*Dimension;
-
-	// Ignore headers and mean data
-	Finit.ignore( SkipNumber, '\n' );
-	Finit.ignore( SkipNumber, '\n' );
-	Finit.ignore( SkipNumber, '\n' );
-	Finit.ignore( SkipNumber, '\n' );
-
-	int i = 0;
-	double value;
-
-	while( i < Dimension )
-	{
-		Finit >> value;
-		(*globalvars)[i++] = value;
-	}
-
-//	(*globalvars) = pow( (*globalvars), -1.0 );
-//	(*globalvars) *= vFloor;
-
-	int type = 0;
-	Finit >> type;	// magic
-	Finit >> type; // type
-
-	if( type != 0 )
-	{
-		InClassError( this, "LoadVQ(): Cannot read in tree-structed VQ codebook.", -301 );
-	}
-
-	int covkind = 0;
-	Finit >> covkind;
-
-	if( covkind != 1 )
-	{
-		InClassError( this, "LoadVQ(): File contains non-diagonal covariance values.", -302 );
-	}
-
-	int clusterNumber = 0;
-	Finit >> clusterNumber;
-
-	if( clusterNumber != MixtureNumber )
-	{
-		InClassError( this, "LoadVQ(): The cluster number does not match mixture number.", -303 );
-	}
-
-	int streamNumber = 0;
-	Finit >> streamNumber;
-
-	if( streamNumber != 1 )
-	{
-		InClassError( this, "LoadVQ(): More than one stream in file.", -304 );
-	}
-
-	int streamWidth = 0;
-	Finit >> streamWidth;
-
-	if( streamWidth != Dimension )
-	{
-		InClassError( this, "LoadVQ(): Stream width not equal to feature vector dimension.", -305 );
-	}
-
-	// Readout cluster header
-	Finit.ignore( 40, '\n' );
-	Finit.ignore( 40, '\n' );
-
-	// Read cluster data
-	int j;
-	i = 0;
-
-	while( i < MixtureNumber )
-	{
-		j = 0;
-
-		while( j < Dimension )
-		{
-			Finit >> value;
-			(*(*means)[i])[j++] = value;
-		}
-
-		j = 0;
-
-		while( j < Dimension )
-		{
-			Finit >> value;
-			(*(*variances)[i])[j++] = value;
-		}
-		i++;
-
-		// Readout next header
-		Finit.ignore( 40, '\n' );
-		Finit.ignore( 40, '\n' );
-		Finit.ignore( 40, '\n' );
-	}
-
-	i = 0;
-
-	while( i < MixtureNumber )
-	{
-		(*weights)[i++] = 1.0/(double)MixtureNumber;
-	}
-
-	Finit.close();
-}
-
 double GMM::LogL( string dataList )
 {
-	Flist.open( dataList.c_str() );
+	vector<string> files;
 
-	if( !Flist )
+	if( !readList( dataList, files ) )
 	{
 		InClassError( this, "LogL(): Cannot open data list file " + dataList,  -400 );
 	}
 
-	string dataFile;
-	float htkData = 0.0f;
-	unsigned int i, j;
+	unsigned int f = 0, number;
 	VectorProcessNumber = 0;
 	VectorsIgnored = 0;
 	LL = 0.0;
 
-	Flist >> dataFile;
 	cout << "LogL()" << endl;
 
-	while( !Flist.eof() )
+	while( f < files.size() )
 	{
-		Fdata.clear();
-		Fdata.open( dataFile.c_str(), ios_base::binary );
-
-		if( !Fdata )
+		if( !Reader.open( files[f] ) )
 		{
-			InClassError( this, "SetupData(): Cannot open data file " + dataFile,  -502 );
+			InClassError( this, "SetupData(): Cannot open data file " + files[f],  -502 );
 		}
 
-		Fdata.read( reinterpret_cast<char *> ( &Htk ), sizeof( Htk ) );
-
-		unsigned int tmpSamples = Htk.nSamples;
-
-		if( Htk.nSamples > MaxDataNumber )
+		while( ( number = Reader.read( dataParm, MaxDataNumber, Dimension ) ) > 0 )
 		{
-			while( tmpSamples >= MaxDataNumber )
+			if( Partial != NULL )
 			{
-
-				i = 0;
-
-				while( i < MaxDataNumber )
-				{
-					j = 0;
-					while( j < Dimension )
-					{
-						Fdata.read(  reinterpret_cast<char *> ( &htkData ), sizeof( float ));
-						(*(*dataParm)[i])[j++] = (double)htkData;
-					}
-					i++;
-				}
-
-				Score( MaxDataNumber );
-
-				tmpSamples -= MaxDataNumber;
+				Partial->blockLogL( dataParm, number, LL, VectorProcessNumber, VectorsIgnored );
 			}
-		}
-
-// process rest of samples
-		i = 0;
-
-		while( i < tmpSamples )
-		{
-			j = 0;
-			while( j < Dimension )
+			else if( Selected != NULL )
+			{
+				Selected->blockLogL( dataParm, number, LL, VectorProcessNumber, VectorsIgnored );
+			}
+			else
 			{
-				Fdata.read(  reinterpret_cast<char *> ( &htkData ), sizeof( float ));
-				(*(*dataParm)[i])[j++] = (double)htkData;
+				blockLogL( *model, dataParm, number, PR, LL, VectorProcessNumber, VectorsIgnored );
 			}
-			i++;
 		}
 
-		Score( tmpSamples );
-
-		Fdata.close();
-		Flist >> dataFile;
+		Reader.close();
+		f++;
 	}
 
 	cout << "VectorProcessNumber\t" << VectorProcessNumber << endl;
 	cout << "VectorsIgnored\t\t" << VectorsIgnored << endl;
 
-	Flist.close();
-	Flist.clear();
-
 	return LL/(double)VectorProcessNumber;
 }
 
-inline void GMM::Score( unsigned int VectorNumber )
+double GMM::LogL( const vector<float> &frames )
 {
-	double value = 0.0, enorm = 0.0;
-	int T = 0, i, j;
-	bool overflow;
-
-	while( T < VectorNumber )
+	if( Partial != NULL )
 	{
-		i = 0;
-		overflow = false;
-
-		while( i < MixtureNumber )
-		{
-			*distance = *((*dataParm)[T]) - *((*means)[i]);
-			*distance = pow( *distance, 2.0 );
-			*distance /= *((*variances)[i]);
-			value = (*distance).sum();
-			value *= -0.5;
-
-			if( value < -700.0 )
-			{
-				overflow = true;
-				VectorsIgnored++;
-				break;
-			}
-
-			enorm = 1.0;
-			j = 0;
-
-			while( j < Dimension )
-			{
-				enorm *= (*(*variances)[i])[j++];
-			}
-
-			enorm = sqrt( enorm );
-			enorm *= pow( 2.0*M_PI, (double)Dimension / 2.0 );
-			enorm = pow( enorm, -1.0 );
-			(*PR)[i] = exp(value)*enorm*(*weights)[i];
-
-			i++;
-		}
-
-		if( overflow != true )
-		{
-			VectorProcessNumber++;
-			LL += log( (*PR).sum() );
-		}
-
-		T++;
+		return Partial->averageLogL( &frames[0], frames.size() / Dimension, VectorsIgnored );
 	}
-}
 
-void GMM::printModel()
-{
-	int i = 0, j = 0;
-
-	cout << "WEIGHTS" << endl;
-	while( i < MixtureNumber )
+	if( Selected != NULL )
 	{
-		cout << (*weights)[i++] << " ";
+		return Selected->averageLogL( &frames[0], frames.size() / Dimension, VectorsIgnored );
 	}
-	cout << endl;
 
-	i = 0;
-	cout << "MEANS" << endl;
-	while( i < MixtureNumber )
-	{
-		j = 0;
-		cout << i << ": ";
-		while( j < Dimension )
-		{
-			cout << (*(*means)[i])[j++] << " ";
-		}
-		cout << endl;
-		i++;
-	}
-	cout << endl;
+	return averageLogL( *model, &frames[0], frames.size() / Dimension, dataParm, PR, VectorsIgnored );
+}
 
-	i = 0;
-	cout << "VARS" << endl;
-	while( i < MixtureNumber )
+//! Log-likelihood of a single feature vector.
+/*!	\param feature vector (Dimension values).
+	\param log-likelihood of the vector.
+	\return false if a mixture underflows and the vector has to be ignored.
+*/
+
+bool GMM::frameLogL( const double *x, double &value )
+{
+	if( Partial != NULL )
 	{
-		j = 0;
-		cout << i << ": ";
-		while( j < Dimension )
-		{
-			cout << (*(*variances)[i])[j++] << " ";
-		}
-		cout << endl;
-		i++;
+		return Partial->frameLogL( x, value );
 	}
-	cout << endl;
 
-	i = 0;
-	cout << "GLOBAL VARS" << endl;
-	while( i < Dimension )
+	if( Selected != NULL )
 	{
-		cout << (*globalvars)[i++] << " ";
+		return Selected->frameLogL( x, value );
 	}
-	cout << endl;
-
 
+	return ::frameLogL( *model, x, PR, value );
 }
 
-GMM::~GMM()
+//! Score with partial distance elimination, see PartialModel.
+/*!	\param pruning beam (natural log), 0 for exact scoring.
+*/
+
+void GMM::setBeam( double beam )
 {
-	int i = 0;
+	delete Partial;
+	Partial = beam > 0.0 ? new PartialModel( *model, beam ) : NULL;
+}
+
+//! Score over the mixtures a Gaussian selection tree picks, see SelectedModel.
+/*!	\param selection tree with one leaf per mixture, NULL for exact scoring. Not copied.
+	\param nodes kept per tree level.
+*/
 
-	while( i < MixtureNumber )
+void GMM::setTree( const GaussianTree *tree, unsigned int width )
+{
+	if( tree != NULL && tree->LeafNumber != MixtureNumber )
 	{
-		delete (*means)[i];
-		delete (*variances)[i++];
+		InClassError( this, "SetTree(): The leaf number of the selection tree does not match mixture number.", -306 );
 	}
 
-	i = 0;
+	delete Selected;
+	Selected = tree != NULL ? new SelectedModel( *model, *tree, width ) : NULL;
+}
 
-	while( i < MaxDataNumber )
-	{
-		delete (*dataParm)[i++];
-	}
+void GMM::printModel()
+{
+	model->printModel();
+}
 
-	delete weights;
-	delete means;
-	delete variances;
-	delete globalvars;
-	delete dataParm;
-	delete distance;
-	delete PR;
+GMM::~GMM()
+{
+	delete Partial;
+	delete Selected;
+	delete model;
 }
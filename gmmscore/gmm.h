@@ -7,7 +7,6 @@
 
 #include <iostream>
 #include <sstream>
-#include <valarray>
 #include <vector>
 #include <fstream>
 #include <string>
@@ -15,74 +14,53 @@
 #include <cmath>
 #include <getopt.h>
 
-using std::ios_base;
-using std::cout;
-using std::endl;
-using std::vector;
-using std::valarray;
-using std::ifstream;
-using std::ofstream;
-using std::string;
-using std::stringstream;
-
-//! HTK Binary File header.
-//! This is defined in the HTKBook.
-
-typedef struct {
-	unsigned int	nSamples,	//!< number of samples in ﬁle (4-byte integer)
-			sampPeriod;	//!< sample period in 100ns units (4-byte integer)
-	unsigned short	sampSize,	//!< number of bytes per sample (2-byte integer)
-			parmKind;	//!< a code indicating the sample kind (2-byte integer)
-}HTKHeader;
-
-//! Model header format
-
-typedef struct {
-	unsigned int	MixtureNumber,	//!< mixture number.
-			Dimension;	//!< feature vector dimension
-	double		vFloor;		//!< global variance flooring value.
-}ModelHeader;
-
-//! Speaker object.
-//! Handles model initialization, training or adapting and saving.
+#include "model.h"
+#include "htk.h"
+#include "score.h"
+#include "partial.h"
+#include "tree.h"
+#include "sidecar.h"
+
+//! Scoring model.
+//! Loads a model through libgmm and scores data lists or feature vectors with it.
 
 class GMM {
 	public:
 		//! Constructor.
-		/*!	\param Model name.
-			\param Initialization file name.
+		/*!	\param Initialization file name.
 			\param Initialization file type.
 			\param Model mixture number.
 			\param Feature vector dimension.
 			\param Variance minimizing factor.
+			\param Number of feature vectors to load.
+			\param Base model file (delta models only).
+			\param Share the model through POSIX shared memory (model and VQ files only).
 		*/
-		GMM( string =0, unsigned int =0, unsigned int =0, unsigned int =0, double =0.0, unsigned int =0 );
+		GMM( string =0, unsigned int =0, unsigned int =0, unsigned int =0, double =0.0, unsigned int =0, string ="", bool =false );
 
 		double LogL( string );
+		double LogL( const vector<float> & );
+		bool frameLogL( const double *, double & );
+		void setBeam( double );
+		void setTree( const GaussianTree *, unsigned int );
 		void printModel();
 
+		unsigned int getDimension() { return Dimension; }	//!< The dimension of the feature vector.
+		unsigned int getMixtureNumber() { return MixtureNumber; }	//!< The mixture number of the model.
+		const Model &getModel() const { return *model; }	//!< The model parameters.
+
 		~GMM();
 
 	private:
 
-		void loadModel( string );	// HTK binary format file : type = 1
-		void loadVQ( string );		// VQ Text file format : type = 2
-
-		void Score( unsigned int );
-
-		ofstream Fmodel;	//!< Model file stream handle.
-		ifstream Finit;		//!< Initial model file stream handle.
-		ifstream Flist;		//!< Data list file stream handle.
-		ifstream Fdata;		//!< Data file stream handle.
-
-		vector< valarray<double> * > *means;		//!< Model means container.
-		vector< valarray<double> * > *variances;	//!< Model variances container.
-		vector< valarray<double> * > *dataParm;		//!< Data vector container
+		Model *model;		//!< Model parameters.
+		PartialModel *Partial;	//!< Bounded-error scorer, NULL for exact scoring.
+		SelectedModel *Selected;	//!< Tree selection scorer, NULL for exact scoring.
+		HTKReader Reader;	//!< Data file reader.
 
-		valarray<double> *weights;	//!< Model weights container.
-		valarray<double> *globalvars;	//!< Global variances container
-		valarray<double> *distance;
-		valarray<double> *PR;
+		Arena Memory;		//!< Model, statistics and data buffers.
+		double *dataParm;	//!< Data vector block (MaxDataNumber*Dimension).
+		double *PR;		//!< Weighted mixture likelihoods.
 
 		unsigned int MixtureNumber;	//!< The mixture number of the model.
 		unsigned int Dimension;		//!< The dimension of the feature vector.
@@ -92,9 +70,6 @@ class GMM {
 
 		double vFloor;		//!< Value multiplied by global variance values to give minimum variances values.
 		double LL;
-
-		HTKHeader Htk;
-		ModelHeader Hmodel;
 };
 
 //! This function is called if a error occurs within the speaker class.
@@ -105,4 +80,12 @@ class GMM {
 
 void InClassError( GMM *, string, int );
 
+//! This function is called if a error occurs while scoring several models (cohort, trial
+//! list, identification, segments), where no single model is to blame.
+/*!	\param error message string.
+	\param exit code.
+*/
+
+void ScoreError( string, int );
+
 #endif
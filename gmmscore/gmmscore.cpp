@@ -3,6 +3,217 @@
 #endif
 
 #include "gmm.h"
+#include "protocol.h"
+#include "scorer.h"
+#include "cohort.h"
+#include "trials.h"
+#include "identify.h"
+#include "segment.h"
+
+#include <climits>
+#include <unistd.h>
+#include <sys/stat.h>
+
+//! Score a HTK feature stream read from stdin.
+//! The header sample count is ignored, feature vectors are scored as they arrive until the stream ends.
+/*!	\param streaming scorer.
+	\param feature vector dimension.
+	\param print the running score every this many feature vectors, 0 for never.
+*/
+
+void streamScore( Scorer &scorer, unsigned int dimension, unsigned int update )
+{
+	HTKHeader Htk;
+	vector<float> frame( dimension );
+
+	if( fread( &Htk, sizeof( HTKHeader ), 1, stdin ) != 1 )
+	{
+		cout << "Cannot read HTK header from stdin" << endl;
+		exit( -1 );
+	}
+
+	if( Htk.sampSize != sizeof( float )*dimension )
+	{
+		cout << "HTK stream sample size does not match feature vector dimension" << endl;
+		exit( -1 );
+	}
+
+	while( scorer.Decision() == 0 && fread( &frame[0], sizeof( float ), dimension, stdin ) == dimension )
+	{
+		profileCount( COUNT_FRAMES, 1 );
+		profileCount( COUNT_BYTES, sizeof( float )*dimension );
+		scorer.push( &frame[0] );
+
+		if( update != 0 && scorer.Frames() % update == 0 )
+		{
+			cout << "Frames\t" << scorer.Frames() << "\tIgnored\t" << scorer.Ignored() << "\tScore\t" << scorer.LLR() << endl;
+		}
+	}
+
+	cout << "VectorProcessNumber\t" << scorer.Frames() << endl;
+	cout << "VectorsIgnored\t\t" << scorer.Ignored() << endl;
+}
+
+//! Score the files of a data list frame synchronously, stopping once the scorer reaches a decision.
+/*!	\param streaming scorer.
+	\param data list file.
+	\param feature vector dimension.
+	\param number of feature vectors to read at a time.
+*/
+
+void listScore( Scorer &scorer, string dataList, unsigned int dimension, unsigned int vectorNum )
+{
+	vector<string> files;
+
+	if( !readList( dataList, files ) )
+	{
+		cout << "Cannot open data list file " << dataList << endl;
+		exit( -1 );
+	}
+
+	HTKReader reader;
+	vector<float> frames( vectorNum*dimension );
+	unsigned int f = 0, number;
+
+	while( f < files.size() && scorer.Decision() == 0 )
+	{
+		if( !reader.open( files[f] ) )
+		{
+			cout << "Cannot open data file " << files[f] << endl;
+			exit( -1 );
+		}
+
+		while( scorer.Decision() == 0 && ( number = reader.read( &frames[0], vectorNum, dimension ) ) > 0 )
+		{
+			scorer.push( &frames[0], number );
+		}
+
+		reader.close();
+		f++;
+	}
+
+	cout << "VectorProcessNumber\t" << scorer.Frames() << endl;
+	cout << "VectorsIgnored\t\t" << scorer.Ignored() << endl;
+}
+
+//! Report an early decision.
+
+void printDecision( Scorer &scorer, ofstream &Fresult )
+{
+	string decision = "undecided";
+
+	if( scorer.Decision() > 0 )
+	{
+		decision = "accept";
+	}
+	else if( scorer.Decision() < 0 )
+	{
+		decision = "reject";
+	}
+
+	cout << "Decision: " << decision << endl;
+	cout << "Frames Consumed: " << scorer.Frames() << endl;
+	Fresult << "\t" << scorer.Frames() << "\t" << decision;
+}
+
+//! Write the score of a segment.
+/*!	\param segment scores.
+	\param segment.
+	\param results file.
+	\param tag written before the line, empty for none.
+	\param write a SegmentRecord instead of a text line.
+*/
+
+void writeSegment( const SegmentScores &scores, const Segment &segment, ofstream &Fresult, const string &tag, bool binary )
+{
+	unsigned int scored;
+	double LLR = scores.LLR( segment.Start, segment.End, scored );
+
+	if( binary )
+	{
+		SegmentRecord record = { segment.Start, segment.End, scored, (float)LLR };
+		Fresult.write( reinterpret_cast<char *>( &record ), sizeof( SegmentRecord ) );
+		return;
+	}
+
+	if( ! tag.empty() )
+	{
+		Fresult << tag << "\t";
+	}
+
+	Fresult << segment.Start << "\t" << segment.End << "\t";
+
+	if( ! segment.Label.empty() )
+	{
+		Fresult << segment.Label << "\t";
+	}
+
+	Fresult << scored << "\t" << LLR << endl;
+}
+
+//! Z-norm statistics of models, loaded from next to the models or computed and stored there.
+/*!	\param scorer over the UBM.
+	\param models.
+	\param model files.
+	\param impostor data files.
+	\param statistics key shared by all models: UBM and impostor list hashes and top mixture number.
+	\param statistics of every model.
+	\return false if the impostor scores of a model do not vary (stored statistics that do not
+	vary are computed again).
+*/
+
+bool normStats( Cohort &scorer, const vector<GMM *> &models, const vector<string> &modelFiles, const vector<string> &impostors, const string &shared, vector<NormStats> &stats )
+{
+	vector<unsigned int> missing;
+	vector<NormStats> computed;
+	vector<string> keys( models.size() );
+	char hash[32];
+	unsigned int k = 0;
+
+	stats.resize( models.size() );
+	scorer.clear();
+
+	while( k < models.size() )
+	{
+		snprintf( hash, sizeof( hash ), "%016llx-", fileHash( modelFiles[k] ) );
+		keys[k] = hash + shared;
+
+		if( !loadNorm( modelFiles[k], keys[k], stats[k] ) || !( stats[k].Deviation > NORM_MIN_DEVIATION ) )
+		{
+			missing.push_back( k );
+			scorer.add( models[k] );
+		}
+		k++;
+	}
+
+	if( missing.empty() )
+	{
+		return true;
+	}
+
+	cout << "Z-norm statistics of " << missing.size() << " models" << endl;
+	scorer.impostorStats( impostors, computed );
+
+	k = 0;
+	while( k < missing.size() )
+	{
+		stats[missing[k]] = computed[k];
+
+		if( !( computed[k].Deviation > NORM_MIN_DEVIATION ) )
+		{
+			cout << "Z-norm impostor scores of " << modelFiles[missing[k]] << " do not vary (deviation " << computed[k].Deviation << ")" << endl;
+			return false;
+		}
+
+		if( !saveNorm( modelFiles[missing[k]], keys[missing[k]], computed[k] ) )
+		{
+			cout << "Warning: cannot store Z-norm statistics of " << modelFiles[missing[k]] << endl;
+		}
+		k++;
+	}
+
+	return true;
+}
 
 void printUsage( void )
 {
@@ -11,8 +222,8 @@ void printUsage( void )
 	cout << "-h,  --help\t\tThis message" << endl;
 	cout << "-i,  --input\t\tInput model file or VQ codebook" << endl;
 	cout << "-w,  --world\t\tNormalize score with this model" << endl;
-	cout << "-l,  --list\t\tFile containing data file list" << endl;
-	cout << "-t,  --modeltype\tInput init file type 1 = model, 2 = VQ codebook" << endl;
+	cout << "-l,  --list\t\tFile containing data file list, - reads a HTK feature stream from stdin" << endl;
+	cout << "-t,  --modeltype\tInput init file type 1 = model, 2 = VQ codebook, 3 = delta model (relative to world model)" << endl;
 	cout << "-b,  --worldtype\tInput init file type 1 = model, 2 = VQ codebook" << endl;
 	cout << "-m,  --mixture\t\tMixture number" << endl;
 	cout << "-d,  --dimension\tFeature vector dimension" << endl;
@@ -20,6 +231,33 @@ void printUsage( void )
 	cout << "-n,  --number\t\tNumber of feature vectors to load" << endl;
 	cout << "-r,  --results\t\tOutput results file" << endl;
 	cout << "-g,  --tag\t\tAdd 'tag' before score" << endl;
+	cout << "-s,  --server\t\tScore with the gmmserve server listening on this socket" << endl;
+	cout << "-u,  --update\t\tPrint the running score every N feature vectors (stdin only)" << endl;
+	cout << "-A,  --accept\t\tStop early once the mean frame LLR is confidently above this value" << endl;
+	cout << "-R,  --reject\t\tStop early once the mean frame LLR is confidently below this value" << endl;
+	cout << "-z,  --confidence\tEarly decision confidence interval in standard errors (default 3)" << endl;
+	cout << "-F,  --minframes\tMinimum number of feature vectors before an early decision or -E pruning (default 100)" << endl;
+	cout << "-S,  --shared\t\tShare model and VQ files with other processes through shared memory" << endl;
+	cout << "-T,  --timing\t\tWrite per-phase timers and counters as JSON to this file (- for stderr)" << endl;
+	cout << "-H,  --hardware\t\tAdd cycles, instructions, cache and branch misses per phase to the timing file" << endl;
+	cout << "-P,  --progress\t\tPrint frames/s and ETA to stderr every this many seconds" << endl;
+	cout << "-B,  --beam\t\tPartial distance elimination: drop mixtures this far (log) below the best one" << endl;
+	cout << "-G,  --tree\t\tScore only the mixtures this Gaussian selection tree (gmmtree) picks" << endl;
+	cout << "-W,  --width\t\tTree nodes kept per level (default 8)" << endl;
+	cout << "-C,  --top\t\tScore the model only over the C best world (UBM) mixtures of every feature vector" << endl;
+	cout << "-K,  --cache\t\tKeep the world scores and top mixtures of every data file in this directory (with -C)" << endl;
+	cout << "-Z,  --znorm\t\tZ-norm against this impostor data list, one trial per file (with -C, statistics kept in <model>.znorm)" << endl;
+	cout << "-O,  --cohort\t\tT-norm against the models in this list, scored in the same pass (with -C, same type as -t)" << endl;
+	cout << "-X,  --trials\t\tScore the trials in this list instead of -i and -l: model file, data file and optional key per line" << endl;
+	cout << "-Q,  --modelcache\tMemory budget of the trial model cache in MB (default 256)" << endl;
+	cout << "-U,  --featurecache\tMemory budget of the trial feature cache in MB (default 512)" << endl;
+	cout << "-I,  --identify\t\tIdentify the speaker of -l among the models in this list instead of -i (with -C, same type as -t)" << endl;
+	cout << "-N,  --nbest\t\tNumber of best models -I reports (default 10)" << endl;
+	cout << "-J,  --window\t\tScore sliding windows of this many feature vectors over the data list" << endl;
+	cout << "-L,  --shift\t\tFeature vectors between the starts of two windows (default -J)" << endl;
+	cout << "-Y,  --segments\t\tScore the segments in this list: first and last + 1 feature vector and optional label per line" << endl;
+	cout << "-M,  --binary\t\tWrite -J and -Y scores as binary records (start, end, frames, LLR)" << endl;
+	cout << "-E,  --prune\t\tDrop -I candidates whose summed LLR falls this far (log) below the N-th best (default 0, no pruning)" << endl;
 
 	exit( -1 );
 }
@@ -28,7 +266,7 @@ int main( int argc, char *argv[] )
 {
 	int nextOption;
 
-	const char * shortOptions = "hi:w:l:t:b:m:d:v:n:r:g:";
+	const char * shortOptions = "hi:w:l:t:b:m:d:v:n:r:g:s:Su:A:R:z:F:T:P:HB:G:W:C:K:Z:O:X:Q:U:I:N:E:J:L:Y:M";
 
 	const struct option longOptions[] = {
 	{ "help", 0, NULL, 'h' },
@@ -43,13 +281,41 @@ int main( int argc, char *argv[] )
 	{ "number", 1, NULL, 'n' },
 	{ "results", 1, NULL, 'r' },
 	{ "tag", 1, NULL, 'g' },
+	{ "server", 1, NULL, 's' },
+	{ "shared", 0, NULL, 'S' },
+	{ "update", 1, NULL, 'u' },
+	{ "accept", 1, NULL, 'A' },
+	{ "reject", 1, NULL, 'R' },
+	{ "confidence", 1, NULL, 'z' },
+	{ "minframes", 1, NULL, 'F' },
+	{ "timing", 1, NULL, 'T' },
+	{ "hardware", 0, NULL, 'H' },
+	{ "progress", 1, NULL, 'P' },
+	{ "beam", 1, NULL, 'B' },
+	{ "tree", 1, NULL, 'G' },
+	{ "width", 1, NULL, 'W' },
+	{ "top", 1, NULL, 'C' },
+	{ "cache", 1, NULL, 'K' },
+	{ "znorm", 1, NULL, 'Z' },
+	{ "cohort", 1, NULL, 'O' },
+	{ "trials", 1, NULL, 'X' },
+	{ "modelcache", 1, NULL, 'Q' },
+	{ "featurecache", 1, NULL, 'U' },
+	{ "identify", 1, NULL, 'I' },
+	{ "nbest", 1, NULL, 'N' },
+	{ "prune", 1, NULL, 'E' },
+	{ "window", 1, NULL, 'J' },
+	{ "shift", 1, NULL, 'L' },
+	{ "segments", 1, NULL, 'Y' },
+	{ "binary", 0, NULL, 'M' },
 	{ NULL, 0, NULL, 0 }
 	};
 
-	string modelFile, listFile, worldFile, resFile, tag;
-	unsigned int modeltype, worldtype, mixture, dimension, vectorNum = 1000;
-	double vfloor = 0.1;
+	string modelFile, listFile, worldFile, resFile, tag, serverFile, timingFile, treeFile, cacheDir, znormList, cohortList, trialFile, identifyList, segmentFile;
+	unsigned int modeltype = 0, worldtype = 0, mixture = 0, dimension = 0, vectorNum = 1000, update = 0, minFrames = 100, width = 8, top = 0, nbest = 10, window = 0, shift = 0;
+	double vfloor = 0.1, accept = HUGE_VAL, reject = -HUGE_VAL, confidence = 3.0, progress = 0.0, beam = 0.0, modelCache = 256.0, featureCache = 512.0, prune = 0.0;
 	unsigned int check = 0;
+	bool shared = false, early = false, hardware = false, binary = false;
 
 	do {
 		nextOption = getopt_long( argc, argv, shortOptions, longOptions, NULL );
@@ -108,6 +374,116 @@ int main( int argc, char *argv[] )
 				tag = optarg;
 				break;
 
+			case 's':
+				serverFile = optarg;
+				break;
+
+			case 'S':
+				shared = true;
+				break;
+
+			case 'T':
+				timingFile = optarg;
+				break;
+
+			case 'H':
+				hardware = true;
+				break;
+
+			case 'P':
+				progress = atof( optarg );
+				break;
+
+			case 'B':
+				beam = atof( optarg );
+				break;
+
+			case 'G':
+				treeFile = optarg;
+				break;
+
+			case 'W':
+				width = atoi( optarg );
+				break;
+
+			case 'C':
+				top = atoi( optarg );
+				break;
+
+			case 'K':
+				cacheDir = optarg;
+				break;
+
+			case 'Z':
+				znormList = optarg;
+				break;
+
+			case 'O':
+				cohortList = optarg;
+				break;
+
+			case 'X':
+				trialFile = optarg;
+				break;
+
+			case 'Q':
+				modelCache = atof( optarg );
+				break;
+
+			case 'U':
+				featureCache = atof( optarg );
+				break;
+
+			case 'I':
+				identifyList = optarg;
+				break;
+
+			case 'N':
+				nbest = atoi( optarg );
+				break;
+
+			case 'E':
+				prune = atof( optarg );
+				break;
+
+			case 'J':
+				window = atoi( optarg );
+				break;
+
+			case 'L':
+				shift = atoi( optarg );
+				break;
+
+			case 'Y':
+				segmentFile = optarg;
+				break;
+
+			case 'M':
+				binary = true;
+				break;
+
+			case 'u':
+				update = atoi( optarg );
+				break;
+
+			case 'A':
+				accept = atof( optarg );
+				early = true;
+				break;
+
+			case 'R':
+				reject = atof( optarg );
+				early = true;
+				break;
+
+			case 'z':
+				confidence = atof( optarg );
+				break;
+
+			case 'F':
+				minFrames = atoi( optarg );
+				break;
+
 			case 'h':
 				printUsage();
 
@@ -126,13 +502,13 @@ int main( int argc, char *argv[] )
 	bool testTransaction = false;
 
 	{
-		if( ! (check & 1) )
+		if( ! (check & 1) && trialFile.empty() && identifyList.empty() )
 		{
 			cout << "-i, --input not set" << endl;
 			testTransaction = true;
 		}
 
-		if( ! (check & 2) )
+		if( ! (check & 2) && trialFile.empty() )
 		{
 			cout << "-l, --list not set" << endl;
 			testTransaction = true;
@@ -144,13 +520,13 @@ int main( int argc, char *argv[] )
 			testTransaction = true;
 		}
 
-		if( ! (check & 8) )
+		if( ! (check & 8) && serverFile.empty() )
 		{
 			cout << "-m, --mixture not set" << endl;
 			testTransaction = true;
 		}
 
-		if( ! (check & 16) )
+		if( ! (check & 16) && serverFile.empty() )
 		{
 			cout << "-d, --dimension not set" << endl;
 			testTransaction = true;
@@ -171,38 +547,534 @@ int main( int argc, char *argv[] )
 			testTransaction = true;
 		}
 
+		if( (check & 4) && modeltype == 3 && serverFile.empty() )
+		{
+			if( ! (check & 32) || ! (check & 64) || worldtype != 1 )
+			{
+				cout << "-t, --modeltype delta models require a world model file (-w, -b 1)" << endl;
+				testTransaction = true;
+			}
+		}
+
+		if( early && ! (check & 32) )
+		{
+			cout << "-A, -R early decisions need a world model (-w)" << endl;
+			testTransaction = true;
+		}
+
+		if( early && ! serverFile.empty() )
+		{
+			cout << "-A, -R early decisions cannot be made by the server (-s)" << endl;
+			testTransaction = true;
+		}
+
+		if( beam > 0.0 && ! serverFile.empty() )
+		{
+			cout << "-B, --beam is not used by the server (-s)" << endl;
+			testTransaction = true;
+		}
+
+		if( ! treeFile.empty() && ! serverFile.empty() )
+		{
+			cout << "-G, --tree is not used by the server (-s)" << endl;
+			testTransaction = true;
+		}
+
+		if( ! treeFile.empty() && beam > 0.0 )
+		{
+			cout << "-G, --tree and -B, --beam cannot be combined" << endl;
+			testTransaction = true;
+		}
+
+		if( ! treeFile.empty() && width == 0 )
+		{
+			cout << "-W, --width must be at least 1" << endl;
+			testTransaction = true;
+		}
+
+		if( top > 0 && ( ! (check & 32) || ! serverFile.empty() || listFile == "-" || early || beam > 0.0 || ! treeFile.empty() ) )
+		{
+			cout << "-C, --top needs a world model (-w) and a data list, without -s, -A, -R, -B and -G" << endl;
+			testTransaction = true;
+		}
+
+		if( ( ! cacheDir.empty() || ! znormList.empty() || ! cohortList.empty() ) && top == 0 )
+		{
+			cout << "-K, -Z and -O are only used with -C, --top" << endl;
+			testTransaction = true;
+		}
+
+		if( ! trialFile.empty() && ( (check & 1) || (check & 2) || ! serverFile.empty() || early || beam > 0.0 || ! treeFile.empty() || ! znormList.empty() || ! cohortList.empty() ) )
+		{
+			cout << "-X, --trials replaces -i and -l, without -s, -A, -R, -B, -G, -Z and -O" << endl;
+			testTransaction = true;
+		}
+
+		if( ! identifyList.empty() && ( (check & 1) || top == 0 || ! trialFile.empty() || ! znormList.empty() || ! cohortList.empty() || nbest == 0 ) )
+		{
+			cout << "-I, --identify replaces -i, needs -C and at least one best model (-N), without -X, -Z and -O" << endl;
+			testTransaction = true;
+		}
+
+		if( ( window > 0 || ! segmentFile.empty() ) && ( listFile == "-" || ! serverFile.empty() || early || ! trialFile.empty() || ! identifyList.empty() || ! znormList.empty() || ! cohortList.empty() ) )
+		{
+			cout << "-J, -Y segment scores need a data list, without -s, -A, -R, -X, -I, -Z and -O" << endl;
+			testTransaction = true;
+		}
+
+		if( ( shift > 0 || binary ) && window == 0 && segmentFile.empty() )
+		{
+			cout << "-L, -M are only used with -J, --window or -Y, --segments" << endl;
+			testTransaction = true;
+		}
+
 		if( testTransaction == true )
 		{
 			printUsage();
 		}
 	}
 
+	if( progress > 0.0 )
+	{
+		// Without early decisions the world model scores the list a second time
+		profileProgress( progress, listFile == "-" || ! trialFile.empty() ? 0 : listFrames( listFile )*( worldFile.empty() || early ? 1 : 2 ) );
+	}
+
+	if( ( progress > 0.0 || !timingFile.empty() ) && serverFile.empty() )
+	{
+		string error;
+
+		if( hardware && !profileHardware( error ) )
+		{
+			cout << "Warning: hardware counters not available (" << error << ")" << endl;
+		}
+
+		profileEnable();
+	}
+
+	// One tree for the model and the world, it only indexes mixtures
+	GaussianTree tree;
+	const GaussianTree *selection = NULL;
+
+	if( ! treeFile.empty() )
+	{
+		if( tree.load( treeFile, dimension ) != 0 )
+		{
+			cout << tree.Error << endl;
+			return -1;
+		}
+		selection = &tree;
+	}
+
 	double LL = 0.0;
 
 	ofstream Fresult( resFile.c_str(), ios_base::app );
 
-	if( ! tag.empty() )
+	if( ! tag.empty() && trialFile.empty() && window == 0 && segmentFile.empty() )
 	{
 		Fresult << tag << "\t";
 	}
 
-	if( worldFile.empty() )
+	if( ! trialFile.empty() )
+	{
+		TrialList trials( modeltype, mixture, dimension, vfloor, worldFile, worldtype, (size_t)( modelCache*1048576.0 ), (size_t)( featureCache*1048576.0 ), vectorNum );
+
+		trials.load( trialFile );
+
+		if( top > 0 )
+		{
+			if( ! cacheDir.empty() )
+			{
+				mkdir( cacheDir.c_str(), 0755 );
+			}
+			trials.setTop( top, cacheDir );
+		}
+
+		trials.score();
+		trials.write( Fresult, tag );
+
+		cout << "Trials\t\t\t" << trials.size() << endl;
+		cout << "ModelsLoaded\t\t" << trials.ModelsLoaded << "/" << trials.models() << endl;
+		cout << "UtterancesDecoded\t" << trials.UtterancesDecoded << "/" << trials.utterances() << endl;
+	}
+	else if( ! serverFile.empty() )
+	{
+		// The server resolves file names relative to its own working directory
+		char path[PATH_MAX];
+		stringstream request;
+		string reply;
+		double WL = 0.0;
+
+		request << ( realpath( modelFile.c_str(), path ) ? path : modelFile.c_str() ) << " " << modeltype << " ";
+		request << ( realpath( listFile.c_str(), path ) ? path : listFile.c_str() );
+
+		int fd = connectServer( serverFile );
+
+		if( fd < 0 || !writeFrame( fd, request.str() ) || !readFrame( fd, reply ) )
+		{
+			cout << "Cannot reach server on " << serverFile << endl;
+			return -1;
+		}
+
+		close( fd );
+
+		stringstream fields( reply );
+
+		if( !( fields >> LL >> LL >> WL ) )
+		{
+			cout << "Server: " << reply << endl;
+			return -1;
+		}
+
+		cout << "Model Score: " << LL << endl;
+		cout << "World Score: " << WL << endl;
+		cout << "Final Score: " << LL-WL << endl;
+		Fresult << LL-WL << endl;
+	}
+	else if( listFile == "-" || early )
+	{
+		GMM model( modelFile, modeltype, mixture, dimension, vfloor, vectorNum, worldFile, shared );
+		GMM *world = NULL;
+
+		model.setBeam( beam );
+		model.setTree( selection, width );
+
+		if( ! worldFile.empty() )
+		{
+			world = new GMM( worldFile, worldtype, mixture, dimension, vfloor, vectorNum, "", shared );
+			world->setBeam( beam );
+			world->setTree( selection, width );
+		}
+
+		Scorer scorer( &model, world );
+
+		if( early )
+		{
+			scorer.setDecision( accept, reject, confidence, minFrames );
+		}
+
+		if( listFile == "-" )
+		{
+			streamScore( scorer, dimension, update );
+		}
+		else
+		{
+			listScore( scorer, listFile, dimension, vectorNum );
+		}
+
+		if( !scorer.Scored() )
+		{
+			cout << "No feature vector of the data could be scored" << endl;
+			delete world;
+			return -1;
+		}
+		LL = scorer.LLR();
+
+		cout << "Model Score: " << scorer.modelLL() << endl;
+		if( world != NULL )
+		{
+			cout << "World Score: " << scorer.worldLL() << endl;
+		}
+		cout << "Final Score: " << LL << endl;
+		Fresult << LL;
+
+		if( early )
+		{
+			printDecision( scorer, Fresult );
+		}
+		Fresult << endl;
+
+		delete world;
+	}
+	else if( window > 0 || ! segmentFile.empty() )
 	{
-		GMM model( modelFile, modeltype, mixture, dimension, vfloor, vectorNum );
+		vector<string> files;
+		vector<Segment> segments;
+		SegmentScores scores;
+
+		if( !readList( listFile, files ) || ( ! segmentFile.empty() && !readSegments( segmentFile, segments ) ) )
+		{
+			cout << "Cannot open data list or segment list" << endl;
+			return -1;
+		}
+
+		GMM model( modelFile, modeltype, mixture, dimension, vfloor, vectorNum, worldFile, shared );
+		GMM *world = NULL;
+
+		model.setBeam( beam );
+		model.setTree( selection, width );
+
+		if( ! worldFile.empty() )
+		{
+			world = new GMM( worldFile, worldtype, mixture, dimension, vfloor, vectorNum, "", shared );
+			world->setBeam( beam );
+			world->setTree( selection, width );
+		}
+
+		if( top > 0 )
+		{
+			unsigned long long worldHash = fileHash( worldFile );
+
+			if( worldHash == 0 )
+			{
+				cout << "Cannot open world model file " << worldFile << endl;
+				return -1;
+			}
+
+			if( ! cacheDir.empty() )
+			{
+				mkdir( cacheDir.c_str(), 0755 );
+			}
+
+			scores.score( model, *world, worldHash, top, cacheDir, files, vectorNum );
+		}
+		else
+		{
+			scores.score( model, world, files, vectorNum );
+		}
+
+		unsigned int k = 0, written = 0;
+		Segment segment;
+
+		// Full windows only
+		while( window > 0 && k + window <= scores.Frames )
+		{
+			segment.Start = k;
+			segment.End = k + window;
+			writeSegment( scores, segment, Fresult, tag, binary );
+			written++;
+			k += shift > 0 ? shift : window;
+		}
+
+		k = 0;
+		while( k < segments.size() )
+		{
+			if( segments[k].Start >= segments[k].End || segments[k].End > scores.Frames )
+			{
+				cout << "Segment " << segments[k].Start << " " << segments[k].End << " is outside the data list (" << scores.Frames << " feature vectors)" << endl;
+				return -1;
+			}
+
+			writeSegment( scores, segments[k], Fresult, tag, binary );
+			written++;
+			k++;
+		}
+
+		cout << "VectorProcessNumber\t" << scores.Frames << endl;
+		cout << "Segments\t\t" << written << endl;
+
+		delete world;
+	}
+	else if( worldFile.empty() )
+	{
+		GMM model( modelFile, modeltype, mixture, dimension, vfloor, vectorNum, "", shared );
+		model.setBeam( beam );
+		model.setTree( selection, width );
 		LL = model.LogL( listFile );
 
 		cout << "Model Score: " << LL << endl;
 		cout << "Final Score: " << LL << endl;
 		Fresult << LL << endl;
 	}
+	else if( ! identifyList.empty() )
+	{
+		unsigned long long worldHash = fileHash( worldFile );
+		vector<string> files, modelFiles;
+
+		if( worldHash == 0 )
+		{
+			cout << "Cannot open world model file " << worldFile << endl;
+			return -1;
+		}
+
+		if( !readList( listFile, files ) || !readList( identifyList, modelFiles ) || modelFiles.empty() )
+		{
+			cout << "Cannot open data or model list" << endl;
+			return -1;
+		}
+
+		if( ! cacheDir.empty() )
+		{
+			mkdir( cacheDir.c_str(), 0755 );
+		}
+
+		GMM world( worldFile, worldtype, mixture, dimension, vfloor, vectorNum, "", shared );
+		Identifier scorer( world.getModel(), worldHash, top, cacheDir, vectorNum );
+
+		scorer.load( modelFiles, modeltype, worldFile );
+		scorer.identify( files, nbest, prune, minFrames );
+
+		cout << "VectorProcessNumber\t" << scorer.Frames << endl;
+		cout << "SidecarsCached\t\t" << scorer.Cached << "/" << files.size() << endl;
+		cout << "Candidates\t\t" << scorer.size() << endl;
+		cout << "Evaluations\t\t" << scorer.Evaluations << "/" << (unsigned long long)scorer.Frames*scorer.size() << endl;
+
+		unsigned int k = 0;
+
+		while( k < scorer.Best.size() )
+		{
+			cout << "Rank " << k + 1 << ": " << modelFiles[scorer.Best[k]] << " " << scorer.Score[scorer.Best[k]] << endl;
+
+			if( k > 0 && ! tag.empty() )
+			{
+				Fresult << tag << "\t";
+			}
+			Fresult << k + 1 << "\t" << modelFiles[scorer.Best[k]] << "\t" << scorer.Score[scorer.Best[k]] << endl;
+			k++;
+		}
+	}
+	else if( top > 0 )
+	{
+		double WL = 0.0;
+		unsigned long long worldHash = fileHash( worldFile );
+
+		if( worldHash == 0 )
+		{
+			cout << "Cannot open world model file " << worldFile << endl;
+			return -1;
+		}
+
+		if( ! cacheDir.empty() )
+		{
+			mkdir( cacheDir.c_str(), 0755 );
+		}
+
+		vector<string> files, impostors, modelFiles;
+
+		if( !readList( listFile, files ) || ( ! znormList.empty() && !readList( znormList, impostors ) ) || ( ! cohortList.empty() && !readList( cohortList, modelFiles ) ) )
+		{
+			cout << "Cannot open data, impostor or cohort list" << endl;
+			return -1;
+		}
+
+		modelFiles.insert( modelFiles.begin(), modelFile );
+
+		if( ! cohortList.empty() && modelFiles.size() < 3 )
+		{
+			cout << "-O, --cohort T-norm needs at least two cohort models" << endl;
+			return -1;
+		}
+
+		// The target is model 0, cohort models only need the parameters and a scratch buffer
+		GMM model( modelFile, modeltype, mixture, dimension, vfloor, vectorNum, worldFile, shared );
+		GMM world( worldFile, worldtype, mixture, dimension, vfloor, vectorNum, "", shared );
+		vector<GMM *> models( 1, &model );
+		vector<NormStats> stats;
+		unsigned int k = 1;
+
+		while( k < modelFiles.size() )
+		{
+			models.push_back( new GMM( modelFiles[k], modeltype, mixture, dimension, vfloor, 1, worldFile, shared ) );
+			k++;
+		}
+
+		Cohort scorer( world, worldHash, top, cacheDir, vectorNum );
+
+		if( ! znormList.empty() )
+		{
+			stringstream key;
+			key << std::hex << worldHash << "-" << fileHash( znormList ) << "-" << std::dec << top;
+			if( !normStats( scorer, models, modelFiles, impostors, key.str(), stats ) )
+			{
+				return -1;
+			}
+		}
+
+		scorer.clear();
+		k = 0;
+		while( k < models.size() )
+		{
+			scorer.add( models[k++] );
+		}
+
+		scorer.score( files );
+
+		LL = scorer.ModelLL[0];
+		WL = scorer.WorldLL;
+
+		cout << "LogL()" << endl;
+		cout << "VectorProcessNumber\t" << scorer.Processed[0] << endl;
+		cout << "VectorsIgnored\t\t" << scorer.Frames - scorer.Processed[0] << endl;
+		cout << "SidecarsCached\t\t" << scorer.Cached << "/" << files.size() << endl;
+
+		// Z-norm every score with the statistics of its model, then T-norm over the cohort
+		vector<double> scores( models.size() );
+		double score, mean = 0.0, square = 0.0, diff;
+
+		k = 0;
+		while( k < models.size() )
+		{
+			scores[k] = scorer.ModelLL[k] - WL;
+			if( ! znormList.empty() )
+			{
+				scores[k] = ( scores[k] - stats[k].Mean ) / stats[k].Deviation;
+			}
+			k++;
+		}
+
+		score = scores[0];
+
+		if( models.size() > 1 )
+		{
+			k = 1;
+			while( k < models.size() )
+			{
+				mean += scores[k++];
+			}
+			mean /= (double)( models.size() - 1 );
+
+			// Squares around the mean, a second pass instead of the cancelling sum of squares
+			k = 1;
+			while( k < models.size() )
+			{
+				diff = scores[k++] - mean;
+				square += diff*diff;
+			}
+			square /= (double)( models.size() - 2 );
+
+			if( !( sqrt( square ) > NORM_MIN_DEVIATION ) )
+			{
+				cout << "Cohort scores do not vary (deviation " << sqrt( square ) << "), T-norm is undefined" << endl;
+				return -1;
+			}
+
+			score = ( score - mean ) / sqrt( square );
+		}
+
+		cout << "Model Score: " << LL << endl;
+		cout << "World Score: " << WL << endl;
+
+		if( ! znormList.empty() || models.size() > 1 )
+		{
+			cout << "Raw Score: " << LL-WL << endl;
+		}
+
+		if( models.size() > 1 )
+		{
+			cout << "Cohort Mean: " << mean << endl;
+			cout << "Cohort Deviation: " << sqrt( square ) << endl;
+		}
+		cout << "Final Score: " << score << endl;
+		Fresult << score << endl;
+
+		k = 1;
+		while( k < models.size() )
+		{
+			delete models[k++];
+		}
+	}
 	else
 	{
 		double WL = 0.0;
 
-		GMM model( modelFile, modeltype, mixture, dimension, vfloor, vectorNum );
+		GMM model( modelFile, modeltype, mixture, dimension, vfloor, vectorNum, worldFile, shared );
+		model.setBeam( beam );
+		model.setTree( selection, width );
 		LL = model.LogL( listFile );
 
-		GMM world( worldFile, worldtype, mixture, dimension, vfloor, vectorNum );
+		GMM world( worldFile, worldtype, mixture, dimension, vfloor, vectorNum, "", shared );
+		world.setBeam( beam );
+		world.setTree( selection, width );
 		WL = world.LogL( listFile );
 
 		cout << "Model Score: " << LL << endl;
@@ -212,5 +1084,11 @@ int main( int argc, char *argv[] )
 	}
 
 	Fresult.close();
+
+	if( !profileReport( timingFile ) )
+	{
+		cout << "Cannot write timing file " << timingFile << endl;
+	}
+
 	return 0;
 }
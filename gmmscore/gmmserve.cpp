@@ -0,0 +1,600 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gmm.h"
+#include "protocol.h"
+#include "profile.h"
+
+#include <list>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using std::list;
+using std::map;
+using std::pair;
+
+//! Scoring request waiting to be batched.
+
+typedef struct {
+	int		client;		//!< client socket descriptor.
+	string		model;		//!< speaker model file.
+	unsigned int	type;		//!< speaker model file type.
+	string		list;		//!< data list file.
+}Request;
+
+static volatile sig_atomic_t running = 1;
+
+static void stopServer( int )
+{
+	running = 0;
+}
+
+static bool requestOrder( const Request &a, const Request &b )
+{
+	if( a.list != b.list )
+	{
+		return a.list < b.list;
+	}
+	if( a.model != b.model )
+	{
+		return a.model < b.model;
+	}
+	return a.type < b.type;
+}
+
+//! Resident speaker models.
+//! Keeps the most recently used models loaded, the least recently used model is dropped first.
+
+class ModelCache {
+	public:
+		//! Constructor.
+		/*!	\param Maximum number of resident models.
+			\param Base (UBM) model file for delta models.
+			\param Model mixture number.
+			\param Feature vector dimension.
+			\param Variance minimizing factor.
+			\param Share model and VQ files through shared memory.
+		*/
+		ModelCache( unsigned int, string, unsigned int, unsigned int, double, bool );
+
+		Model *fetch( string, unsigned int, string & );
+
+		unsigned int Loads;	//!< The number of models loaded since startup.
+
+		~ModelCache();
+
+	private:
+
+		typedef list< pair< string, Model * > > Resident;
+
+		Resident models;			//!< Most recently used model first.
+		map< string, Resident::iterator > index;
+
+		unsigned int Size;
+		string BaseFile;
+		unsigned int MixtureNumber;
+		unsigned int Dimension;
+		double vFloor;
+		bool Shared;
+};
+
+ModelCache::ModelCache( unsigned int size, string baseFile, unsigned int mixtures, unsigned int length, double floor, bool shared )
+{
+	Size = size;
+	BaseFile = baseFile;
+	MixtureNumber = mixtures;
+	Dimension = length;
+	vFloor = floor;
+	Shared = shared;
+	Loads = 0;
+}
+
+Model *ModelCache::fetch( string modelFile, unsigned int type, string &error )
+{
+	stringstream key;
+	key << type << ":" << modelFile;
+
+	map< string, Resident::iterator >::iterator found = index.find( key.str() );
+
+	if( found != index.end() )
+	{
+		models.splice( models.begin(), models, found->second );
+		return models.front().second;
+	}
+
+	Model *model = new Model( MixtureNumber, Dimension, vFloor );
+
+	if( model->load( modelFile, type, BaseFile, Shared ) != 0 )
+	{
+		error = model->Error;
+		delete model;
+		return NULL;
+	}
+	Loads++;
+
+	if( models.size() >= Size )
+	{
+		index.erase( models.back().first );
+		delete models.back().second;
+		models.pop_back();
+	}
+
+	models.push_front( pair< string, Model * >( key.str(), model ) );
+	index[ key.str() ] = models.begin();
+
+	return model;
+}
+
+ModelCache::~ModelCache()
+{
+	while( !models.empty() )
+	{
+		delete models.back().second;
+		models.pop_back();
+	}
+}
+
+//! Read all feature vectors of the files in a data list.
+
+static bool loadFeatures( string dataList, unsigned int Dimension, vector<float> &frames, string &error )
+{
+	vector<string> files;
+	HTKReader Reader;
+	unsigned int f = 0;
+	size_t start;
+
+	if( !readList( dataList, files ) )
+	{
+		error = "Cannot open data list file " + dataList;
+		return false;
+	}
+
+	frames.clear();
+
+	while( f < files.size() )
+	{
+		if( !Reader.open( files[f] ) )
+		{
+			error = "Cannot open data file " + files[f];
+			return false;
+		}
+
+		start = frames.size();
+		frames.resize( start + (size_t)Reader.Htk.nSamples*Dimension );
+
+		if( Reader.read( &frames[start], Reader.Htk.nSamples, Dimension ) != Reader.Htk.nSamples )
+		{
+			error = "Data file " + files[f] + " is truncated";
+			return false;
+		}
+
+		Reader.close();
+		f++;
+	}
+
+	return true;
+}
+
+//! Score a batch of requests.
+//! Requests are grouped by data list so the features and the world score of an utterance
+//! are computed once, and by model so every model is fetched once per utterance.
+
+static void processBatch( vector<Request> &batch, Model &world, ModelCache &cache, unsigned int Dimension )
+{
+	std::stable_sort( batch.begin(), batch.end(), requestOrder );
+
+	vector<float> frames;
+	vector<double> frame( Dimension ), PR( world.MixtureNumber );
+	stringstream reply;
+	string error, currentList;
+	bool listOK = false;
+	double WL = 0.0, LL = 0.0;
+	unsigned int i = 0, utterances = 0, loads = cache.Loads, ignored;
+	Model *model = NULL;
+
+	reply.precision( 10 );
+
+	while( i < batch.size() )
+	{
+		if( i == 0 || batch[i].list != currentList )
+		{
+			currentList = batch[i].list;
+			error.clear();
+			listOK = loadFeatures( currentList, Dimension, frames, error ) && frames.size() > 0;
+
+			if( listOK )
+			{
+				WL = averageLogL( world, &frames[0], frames.size()/Dimension, &frame[0], &PR[0], ignored );
+			}
+			else if( error.empty() )
+			{
+				error = "No feature vectors in " + currentList;
+			}
+			utterances++;
+		}
+
+		reply.str( "" );
+
+		if( listOK )
+		{
+			if( i == 0 || batch[i].model != batch[i-1].model || batch[i].type != batch[i-1].type || batch[i].list != batch[i-1].list )
+			{
+				error.clear();
+				model = cache.fetch( batch[i].model, batch[i].type, error );
+
+				if( model != NULL )
+				{
+					LL = averageLogL( *model, &frames[0], frames.size()/Dimension, &frame[0], &PR[0], ignored );
+				}
+			}
+
+			if( model != NULL )
+			{
+				reply << LL-WL << " " << LL << " " << WL;
+			}
+			else
+			{
+				reply << "ERROR " << error;
+			}
+		}
+		else
+		{
+			reply << "ERROR " << error;
+		}
+
+		{
+			ProfileTimer timer( PHASE_OUTPUT );
+			writeFrame( batch[i].client, reply.str() );
+		}
+		i++;
+	}
+
+	cout << "Batch\t" << batch.size() << " requests\t" << utterances << " utterances\t" << cache.Loads - loads << " model loads" << endl;
+
+	batch.clear();
+}
+
+void printUsage( void )
+{
+	cout << "gmmserve: help" << endl;
+	cout << endl;
+	cout << "-h,  --help\t\tThis message" << endl;
+	cout << "-w,  --world\t\tResident world model (UBM)" << endl;
+	cout << "-b,  --worldtype\tWorld model file type 1 = model, 2 = VQ codebook" << endl;
+	cout << "-m,  --mixture\t\tMixture number" << endl;
+	cout << "-d,  --dimension\tFeature vector dimension" << endl;
+	cout << "-v,  --vfloor\t\tVariance flooring constant" << endl;
+	cout << "-s,  --socket\t\tUnix domain socket path" << endl;
+	cout << "-c,  --cache\t\tNumber of resident speaker models" << endl;
+	cout << "-S,  --shared\t\tShare model and VQ files with other processes through shared memory" << endl;
+	cout << "-T,  --timing\t\tWrite per-phase timers and counters as JSON to this file on shutdown (- for stderr)" << endl;
+	cout << "-H,  --hardware\t\tAdd cycles, instructions, cache and branch misses per phase to the timing file" << endl;
+
+	exit( -1 );
+}
+
+int main( int argc, char *argv[] )
+{
+	int nextOption;
+
+	const char * shortOptions = "hw:b:m:d:v:s:c:ST:H";
+
+	const struct option longOptions[] = {
+	{ "help", 0, NULL, 'h' },
+	{ "world", 1, NULL, 'w' },
+	{ "worldtype", 1, NULL, 'b' },
+	{ "mixture", 1, NULL, 'm' },
+	{ "dimension", 1, NULL, 'd' },
+	{ "vfloor", 1, NULL, 'v' },
+	{ "socket", 1, NULL, 's' },
+	{ "cache", 1, NULL, 'c' },
+	{ "shared", 0, NULL, 'S' },
+	{ "timing", 1, NULL, 'T' },
+	{ "hardware", 0, NULL, 'H' },
+	{ NULL, 0, NULL, 0 }
+	};
+
+	string worldFile, socketFile, timingFile;
+	unsigned int worldtype = 0, mixture = 0, dimension = 0, cacheSize = 64;
+	double vfloor = 0.1;
+	unsigned int check = 0;
+	bool shared = false, hardware = false;
+
+	do {
+		nextOption = getopt_long( argc, argv, shortOptions, longOptions, NULL );
+
+		switch( nextOption )
+		{
+			case 'w':
+				worldFile = optarg;
+				check += 1;
+				break;
+
+			case 'b':
+				worldtype = atoi( optarg );
+				check += 2;
+				break;
+
+			case 'm':
+				mixture = atoi( optarg );
+				check += 4;
+				break;
+
+			case 'd':
+				dimension = atoi( optarg );
+				check += 8;
+				break;
+
+			case 'v':
+				vfloor = atof( optarg );
+				break;
+
+			case 'T':
+				timingFile = optarg;
+				break;
+
+			case 'H':
+				hardware = true;
+				break;
+
+			case 's':
+				socketFile = optarg;
+				check += 16;
+				break;
+
+			case 'c':
+				cacheSize = atoi( optarg );
+				break;
+
+			case 'S':
+				shared = true;
+				break;
+
+			case 'h':
+				printUsage();
+
+			case '?':
+				printUsage();
+
+			case -1:
+				break;
+
+			default:
+				abort();
+		}
+
+	} while( nextOption != -1 );
+
+	bool testTransaction = false;
+
+	{
+		if( ! (check & 1) )
+		{
+			cout << "-w, --world not set" << endl;
+			testTransaction = true;
+		}
+
+		if( ! (check & 2) )
+		{
+			cout << "-b, --worldtype not set" << endl;
+			testTransaction = true;
+		}
+
+		if( ! (check & 4) )
+		{
+			cout << "-m, --mixture not set" << endl;
+			testTransaction = true;
+		}
+
+		if( ! (check & 8) )
+		{
+			cout << "-d, --dimension not set" << endl;
+			testTransaction = true;
+		}
+
+		if( ! (check & 16) )
+		{
+			cout << "-s, --socket not set" << endl;
+			testTransaction = true;
+		}
+
+		if( cacheSize == 0 )
+		{
+			cout << "-c, --cache must be at least 1" << endl;
+			testTransaction = true;
+		}
+
+		if( testTransaction == true )
+		{
+			printUsage();
+		}
+	}
+
+	struct sockaddr_un address;
+
+	if( socketFile.size() >= sizeof( address.sun_path ) )
+	{
+		cout << "Socket path too long " << socketFile << endl;
+		return -1;
+	}
+
+	Model world( mixture, dimension, vfloor );
+
+	if( world.load( worldFile, worldtype, "", shared ) != 0 )
+	{
+		cout << world.Error << endl;
+		return -1;
+	}
+
+	ModelCache cache( cacheSize, worldFile, mixture, dimension, vfloor, shared );
+
+	int listener = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+	memset( &address, 0, sizeof( address ) );
+	address.sun_family = AF_UNIX;
+	strcpy( address.sun_path, socketFile.c_str() );
+	unlink( socketFile.c_str() );
+
+	if( listener < 0 || bind( listener, (struct sockaddr *)&address, sizeof( address ) ) < 0 || listen( listener, 64 ) < 0 )
+	{
+		cout << "Cannot listen on socket " << socketFile << ": " << strerror( errno ) << endl;
+		return -1;
+	}
+
+	fcntl( listener, F_SETFL, O_NONBLOCK );
+
+	if( !timingFile.empty() )
+	{
+		string error;
+
+		if( hardware && !profileHardware( error ) )
+		{
+			cout << "Warning: hardware counters not available (" << error << ")" << endl;
+		}
+
+		profileEnable();
+	}
+
+	signal( SIGPIPE, SIG_IGN );
+	signal( SIGINT, stopServer );
+	signal( SIGTERM, stopServer );
+
+	cout << "Listening on " << socketFile << endl;
+
+	map< int, string > clients;	// client socket -> receive buffer
+	map< int, string >::iterator c;
+	vector<struct pollfd> fds;
+	vector<Request> batch;
+	vector<int> closed;
+	struct pollfd entry;
+	char data[4096];
+	ssize_t count;
+	string payload;
+	Request request;
+	unsigned int i;
+	int fd, status;
+
+	while( running )
+	{
+		fds.clear();
+		entry.fd = listener;
+		entry.events = POLLIN;
+		entry.revents = 0;
+		fds.push_back( entry );
+
+		for( c = clients.begin(); c != clients.end(); c++ )
+		{
+			entry.fd = c->first;
+			fds.push_back( entry );
+		}
+
+		if( poll( &fds[0], fds.size(), 1000 ) <= 0 )
+		{
+			continue;
+		}
+
+		if( fds[0].revents & POLLIN )
+		{
+			while( ( fd = accept( listener, NULL, NULL ) ) >= 0 )
+			{
+				clients[fd] = "";
+			}
+		}
+
+		i = 1;
+		while( i < fds.size() )
+		{
+			if( fds[i].revents & ( POLLIN | POLLHUP | POLLERR ) )
+			{
+				fd = fds[i].fd;
+				count = read( fd, data, sizeof( data ) );
+
+				if( count <= 0 )
+				{
+					closed.push_back( fd );
+				}
+				else
+				{
+					clients[fd].append( data, count );
+
+					while( ( status = parseFrame( clients[fd], payload ) ) == 1 )
+					{
+						stringstream fields( payload );
+
+						request.client = fd;
+						request.type = 0;
+						fields >> request.model >> request.type >> request.list;
+
+						if( !fields )
+						{
+							writeFrame( fd, "ERROR malformed request" );
+						}
+						else
+						{
+							batch.push_back( request );
+						}
+					}
+
+					if( status < 0 )
+					{
+						writeFrame( fd, "ERROR frame too long" );
+						closed.push_back( fd );
+					}
+				}
+			}
+			i++;
+		}
+
+		// Drop requests of clients that went away before they could be answered
+		while( !closed.empty() )
+		{
+			fd = closed.back();
+			closed.pop_back();
+
+			i = 0;
+			while( i < batch.size() )
+			{
+				if( batch[i].client == fd )
+				{
+					batch.erase( batch.begin() + i );
+				}
+				else
+				{
+					i++;
+				}
+			}
+
+			clients.erase( fd );
+			close( fd );
+		}
+
+		if( !batch.empty() )
+		{
+			processBatch( batch, world, cache, dimension );
+		}
+	}
+
+	for( c = clients.begin(); c != clients.end(); c++ )
+	{
+		close( c->first );
+	}
+
+	close( listener );
+	unlink( socketFile.c_str() );
+
+	if( !profileReport( timingFile ) )
+	{
+		cout << "Cannot write timing file " << timingFile << endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,246 @@
+#include "identify.h"
+#include "profile.h"
+
+#include <algorithm>
+
+//! Orders models by decreasing score, ties by model number.
+
+namespace {
+
+struct ScoreOrder {
+	ScoreOrder( const vector<double> &score ) : Score( score ) {}
+
+	bool operator()( unsigned int a, unsigned int b ) const { return Score[a] > Score[b] || ( Score[a] == Score[b] && a < b ); }
+
+	const vector<double> &Score;
+};
+
+}
+
+Identifier::Identifier( const Model &world, unsigned long long worldHash, unsigned int top, string cacheDir, unsigned int block ) : World( world )
+{
+	WorldHash = worldHash;
+	Top = top;
+	CacheDir = cacheDir;
+	Block = block;
+	Frames = 0;
+	Cached = 0;
+	Evaluations = 0;
+	WorldLL = 0.0;
+	WorldProcessed = 0;
+
+	frames.resize( (size_t)Block*World.Dimension );
+	PR.resize( Top );
+}
+
+Identifier::~Identifier()
+{
+	unsigned int k = 0;
+
+	while( k < Models.size() )
+	{
+		delete Models[k++];
+	}
+}
+
+//! Load the enrolled models, their parameters share one arena.
+/*!	\param model files.
+	\param model file type (1 model, 2 VQ codebook, 3 delta model).
+	\param base model file (delta models only).
+*/
+
+void Identifier::load( const vector<string> &files, unsigned int type, string baseFile )
+{
+	unsigned int k = 0;
+	int status;
+
+	Memory.reserve( files.size()*arenaSize( parameterNumber( World.MixtureNumber, World.Dimension ) ) );
+
+	while( k < files.size() )
+	{
+		Models.push_back( new Model( World.MixtureNumber, World.Dimension, World.vFloor, &Memory ) );
+
+		status = Models.back()->load( files[k], type, baseFile );
+
+		if( status != 0 )
+		{
+			ScoreError( Models.back()->Error, status );
+		}
+		k++;
+	}
+}
+
+//! Score a block of feature vectors with the UBM and every candidate.
+/*!	\param feature vectors.
+	\param sidecar of the data file.
+	\param sidecar position of the first feature vector.
+	\param number of feature vectors.
+*/
+
+void Identifier::scoreInterval( const double *x, const Sidecar &side, unsigned int offset, unsigned int number )
+{
+	ProfileTimer timer( PHASE_SCORE );
+	const unsigned int D = World.Dimension;
+	unsigned int T = 0, n = 0, k;
+	double value;
+
+	while( T < number )
+	{
+		if( side.LL[offset + T] != -HUGE_VAL )
+		{
+			WorldLL += side.LL[offset + T];
+			WorldProcessed++;
+		}
+		T++;
+	}
+
+	// Model after model, so the parameters of a model stay in cache over the interval
+	while( n < Alive.size() )
+	{
+		k = Alive[n++];
+		T = 0;
+
+		while( T < number )
+		{
+			if( side.LL[offset + T] != -HUGE_VAL && topLogL( *Models[k], x + (size_t)T*D, &side.Index[(size_t)( offset + T )*Top], Top, &PR[0], value ) )
+			{
+				ModelLL[k] += value;
+				Processed[k]++;
+			}
+			T++;
+		}
+	}
+
+	Evaluations += (unsigned long long)number*Alive.size();
+	profileWork( PHASE_SCORE, (unsigned long long)number*Top*Alive.size() );
+}
+
+//! Drop the candidates whose summed LLR is more than the beam below the one of the N-th best.
+
+void Identifier::prune( unsigned int nbest, double beam )
+{
+	vector<double> scores;
+	unsigned int n = 0, kept = 0, k;
+	double reference, world = WorldLL/(double)WorldProcessed;
+
+	while( n < Alive.size() )
+	{
+		k = Alive[n++];
+		Score[k] = Processed[k] > 0 ? ModelLL[k]/(double)Processed[k] - world : -HUGE_VAL;
+		scores.push_back( Score[k] );
+	}
+
+	std::nth_element( scores.begin(), scores.begin() + nbest - 1, scores.end(), std::greater<double>() );
+	reference = scores[nbest - 1];
+
+	n = 0;
+	while( n < Alive.size() )
+	{
+		k = Alive[n++];
+
+		if( ( reference - Score[k] )*(double)WorldProcessed > beam )
+		{
+			Dropped[k] = Frames;
+		}
+		else
+		{
+			Alive[kept++] = k;
+		}
+	}
+
+	Alive.resize( kept );
+}
+
+//! Identify the speaker of a data list, results in Best, Score and Dropped.
+/*!	\param data files.
+	\param number of best models to return.
+	\param beam on the summed LLR (natural log), 0 for no pruning.
+	\param feature vectors read before the first pruning step.
+*/
+
+void Identifier::identify( const vector<string> &files, unsigned int nbest, double beam, unsigned int minFrames )
+{
+	const unsigned int D = World.Dimension, N = Models.size();
+	unsigned int f = 0, number, offset, T, length, k;
+	int status;
+
+	nbest = nbest < N ? nbest : N;
+	Alive.resize( N );
+	k = 0;
+	while( k < N )
+	{
+		Alive[k] = k;
+		k++;
+	}
+
+	ModelLL.assign( N, 0.0 );
+	Processed.assign( N, 0 );
+	Score.assign( N, 0.0 );
+	Dropped.assign( N, 0 );
+	WorldLL = 0.0;
+	WorldProcessed = 0;
+	Frames = 0;
+	Cached = 0;
+	Evaluations = 0;
+
+	while( f < files.size() )
+	{
+		status = Side.prepare( World, WorldHash, Top, files[f], CacheDir, Block );
+
+		if( status != 0 )
+		{
+			ScoreError( Side.Error, status );
+		}
+
+		Cached += Side.Cached ? 1 : 0;
+
+		if( !Reader.open( files[f] ) )
+		{
+			ScoreError( "SetupData(): Cannot open data file " + files[f], -502 );
+		}
+
+		offset = 0;
+
+		while( ( number = Reader.read( &frames[0], Block, D ) ) > 0 )
+		{
+			if( offset + number > Side.Frames )
+			{
+				ScoreError( "Identify(): Sidecar of " + files[f] + " has too few feature vectors", -1006 );
+			}
+
+			T = 0;
+			while( T < number )
+			{
+				length = number - T < IDENTIFY_INTERVAL ? number - T : IDENTIFY_INTERVAL;
+				scoreInterval( &frames[(size_t)T*D], Side, offset + T, length );
+				Frames += length;
+				T += length;
+
+				if( beam > 0.0 && Frames >= minFrames && WorldProcessed > 0 && Alive.size() > nbest )
+				{
+					prune( nbest, beam );
+				}
+			}
+
+			offset += number;
+		}
+
+		Reader.close();
+		f++;
+	}
+
+	k = 0;
+	while( k < Alive.size() )
+	{
+		if( WorldProcessed == 0 || Processed[Alive[k]] == 0 )
+		{
+			ScoreError( "Identify(): No feature vector of the data list could be scored", -1007 );
+		}
+
+		Score[Alive[k]] = ModelLL[Alive[k]]/(double)Processed[Alive[k]] - WorldLL/(double)WorldProcessed;
+		k++;
+	}
+
+	std::sort( Alive.begin(), Alive.end(), ScoreOrder( Score ) );
+	Best.assign( Alive.begin(), Alive.begin() + ( nbest < Alive.size() ? nbest : Alive.size() ) );
+}
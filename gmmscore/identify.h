@@ -0,0 +1,72 @@
+#ifndef IDENTIFY_H
+#define IDENTIFY_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include "gmm.h"
+
+//! Feature vectors scored by every candidate between two pruning steps.
+
+#define IDENTIFY_INTERVAL 64
+
+//! Closed-set identification over models adapted from the same UBM (gmmscore -I).
+//! The test data is read once: the UBM scores and top mixtures come from the sidecar of
+//! every data file (see Sidecar), the candidate models are evaluated over the top mixtures
+//! frame synchronously, IDENTIFY_INTERVAL feature vectors at a time. After every interval a
+//! candidate is dropped when its running LLR, summed over the feature vectors seen so far,
+//! falls more than the beam below the running LLR of the N-th best candidate, so the N best
+//! always survive. Feature vectors the UBM ignores are ignored for all models.
+
+class Identifier {
+	public:
+		//! Constructor.
+		/*!	\param UBM (world model).
+			\param content hash of the UBM file.
+			\param UBM mixtures scored per feature vector.
+			\param sidecar cache directory, empty to compute the sidecars without storing them.
+			\param feature vectors read at a time.
+		*/
+		Identifier( const Model &, unsigned long long, unsigned int, string, unsigned int );
+
+		~Identifier();
+
+		void load( const vector<string> &, unsigned int, string );
+		void identify( const vector<string> &, unsigned int, double, unsigned int );
+
+		unsigned int size() { return Models.size(); }	//!< The number of enrolled models.
+
+		vector<unsigned int> Best;	//!< N best models, best first.
+		vector<double> Score;		//!< Average LLR of every model, up to the feature vector it was dropped at.
+		vector<unsigned int> Dropped;	//!< Feature vectors read when every model was dropped, 0 if it survived.
+		unsigned int Frames;		//!< Feature vectors read.
+		unsigned int Cached;		//!< Data files whose sidecar was cached.
+		unsigned long long Evaluations;	//!< Model x feature vector evaluations.
+
+	private:
+
+		void scoreInterval( const double *, const Sidecar &, unsigned int, unsigned int );
+		void prune( unsigned int, double );
+
+		const Model &World;		//!< UBM.
+		unsigned long long WorldHash;	//!< Content hash of the UBM file.
+		unsigned int Top;		//!< UBM mixtures scored per feature vector.
+		string CacheDir;		//!< Sidecar cache directory.
+		unsigned int Block;		//!< Feature vectors read at a time.
+
+		Arena Memory;			//!< Parameters of all models.
+		vector<Model *> Models;		//!< Enrolled models.
+		vector<unsigned int> Alive;	//!< Models not dropped yet.
+		vector<double> ModelLL;		//!< Log-likelihood sum of every model.
+		vector<unsigned int> Processed;	//!< Feature vectors scored by every model.
+		double WorldLL;			//!< UBM log-likelihood sum.
+		unsigned int WorldProcessed;	//!< Feature vectors scored by the UBM.
+
+		Sidecar Side;			//!< Sidecar of the current data file.
+		HTKReader Reader;		//!< Data file reader.
+		vector<double> frames;		//!< Feature vector block.
+		vector<double> PR;		//!< Top mixture likelihoods.
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "protocol.h"
+
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+
+bool writeFrame( int fd, const string &payload )
+{
+	string buffer( 4, '\0' );
+	uint32_t length = htonl( payload.size() );
+
+	memcpy( &buffer[0], &length, 4 );
+	buffer += payload;
+
+	size_t done = 0;
+	ssize_t count;
+
+	while( done < buffer.size() )
+	{
+		count = write( fd, buffer.data() + done, buffer.size() - done );
+
+		if( count <= 0 )
+		{
+			return false;
+		}
+		done += count;
+	}
+
+	return true;
+}
+
+bool readFrame( int fd, string &payload )
+{
+	string buffer;
+	char data[4096];
+	ssize_t count;
+	int status;
+
+	while( ( status = parseFrame( buffer, payload ) ) == 0 )
+	{
+		count = read( fd, data, sizeof( data ) );
+
+		if( count <= 0 )
+		{
+			return false;
+		}
+		buffer.append( data, count );
+	}
+
+	return status == 1;
+}
+
+int parseFrame( string &buffer, string &payload )
+{
+	if( buffer.size() < 4 )
+	{
+		return 0;
+	}
+
+	uint32_t length;
+
+	memcpy( &length, buffer.data(), 4 );
+	length = ntohl( length );
+
+	if( length > FRAME_MAX )
+	{
+		return -1;
+	}
+
+	if( buffer.size() < 4 + length )
+	{
+		return 0;
+	}
+
+	payload = buffer.substr( 4, length );
+	buffer.erase( 0, 4 + length );
+
+	return 1;
+}
+
+int connectServer( string path )
+{
+	struct sockaddr_un address;
+
+	if( path.size() >= sizeof( address.sun_path ) )
+	{
+		return -1;
+	}
+
+	int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+	if( fd < 0 )
+	{
+		return -1;
+	}
+
+	memset( &address, 0, sizeof( address ) );
+	address.sun_family = AF_UNIX;
+	strcpy( address.sun_path, path.c_str() );
+
+	if( connect( fd, (struct sockaddr *)&address, sizeof( address ) ) < 0 )
+	{
+		close( fd );
+		return -1;
+	}
+
+	return fd;
+}
@@ -0,0 +1,50 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include <string>
+
+using std::string;
+
+//! Scoring server framing.
+//! Every message is a 4-byte length (network byte order) followed by the payload.
+//! Request payload:	"<model file> <model type> <data list file>"
+//! Response payload:	"<LLR> <model LL> <world LL>" or "ERROR <message>"
+
+#define FRAME_MAX 65536
+
+//! Write one frame to a socket.
+/*!	\param socket descriptor.
+	\param payload.
+	\return false if the socket failed.
+*/
+
+bool writeFrame( int, const string & );
+
+//! Read one frame from a socket, blocking until it is complete.
+/*!	\param socket descriptor.
+	\param payload.
+	\return false if the socket failed or was closed.
+*/
+
+bool readFrame( int, string & );
+
+//! Extract one complete frame from a receive buffer.
+/*!	\param receive buffer, the frame is removed on success.
+	\param payload.
+	\return 1 if a frame was extracted, 0 if more data is needed, -1 on a framing error.
+*/
+
+int parseFrame( string &, string & );
+
+//! Connect to a scoring server.
+/*!	\param socket path.
+	\return socket descriptor or -1.
+*/
+
+int connectServer( string );
+
+#endif
@@ -0,0 +1,166 @@
+#include "scorer.h"
+
+Scorer::Scorer( GMM *model, GMM *world )
+{
+	Model = model;
+	World = world;
+	Dimension = Model->getDimension();
+	frame.resize( Dimension );
+	Early = false;
+
+	reset();
+}
+
+void Scorer::reset()
+{
+	ModelSum = 0.0;
+	WorldSum = 0.0;
+	ModelNumber = 0;
+	WorldNumber = 0;
+	FrameNumber = 0;
+	IgnoredNumber = 0;
+	Decided = 0;
+	RatioNumber = 0;
+	RatioMean = 0.0;
+	RatioM2 = 0.0;
+}
+
+//! Enable early decisions.
+/*!	\param accept threshold on the mean frame log-likelihood ratio.
+	\param reject threshold on the mean frame log-likelihood ratio.
+	\param confidence interval width in standard errors. Frames are correlated, so this
+		is a tuning knob rather than an exact significance level.
+	\param minimum number of frame ratios before deciding.
+*/
+
+void Scorer::setDecision( double accept, double reject, double confidence, unsigned int minFrames )
+{
+	Early = ( World != NULL );
+	Accept = accept;
+	Reject = reject;
+	Confidence = confidence;
+	MinFrames = minFrames < 2 ? 2 : minFrames;
+}
+
+//! Score feature vectors.
+/*!	\param feature vectors, one after the other.
+	\param number of feature vectors.
+	\return number of feature vectors consumed, less than given once an early decision is reached.
+*/
+
+unsigned int Scorer::push( const float *data, unsigned int number )
+{
+	ProfileTimer timer( PHASE_SCORE );
+	unsigned int T = 0, j, skipped = IgnoredNumber;
+	double value, ratio = 0.0, delta, error;
+	bool ignored;
+
+	while( T < number && Decided == 0 )
+	{
+		j = 0;
+		while( j < Dimension )
+		{
+			frame[j] = (double)data[T*Dimension + j];
+			j++;
+		}
+
+		ignored = false;
+
+		if( Model->frameLogL( &frame[0], value ) )
+		{
+			ratio = value;
+			ModelSum += value;
+			ModelNumber++;
+		}
+		else
+		{
+			ignored = true;
+		}
+
+		if( World != NULL )
+		{
+			if( World->frameLogL( &frame[0], value ) )
+			{
+				ratio -= value;
+				WorldSum += value;
+				WorldNumber++;
+			}
+			else
+			{
+				ignored = true;
+			}
+		}
+
+		if( ignored )
+		{
+			IgnoredNumber++;
+		}
+		else if( Early )
+		{
+			RatioNumber++;
+			delta = ratio - RatioMean;
+			RatioMean += delta/(double)RatioNumber;
+			RatioM2 += delta*( ratio - RatioMean );
+
+			if( RatioNumber >= MinFrames )
+			{
+				error = Confidence*sqrt( RatioM2/(double)( RatioNumber - 1 )/(double)RatioNumber );
+
+				if( RatioMean - error > Accept )
+				{
+					Decided = 1;
+				}
+				else if( RatioMean + error < Reject )
+				{
+					Decided = -1;
+				}
+			}
+		}
+
+		FrameNumber++;
+		T++;
+	}
+
+	profileCount( COUNT_SCORED, T - ( IgnoredNumber - skipped ) );
+	profileCount( COUNT_IGNORED, IgnoredNumber - skipped );
+	profileWork( PHASE_SCORE, (unsigned long long)T*( Model->getMixtureNumber() + ( World != NULL ? World->getMixtureNumber() : 0 ) ) );
+
+	return T;
+}
+
+//! The running average model log-likelihood, 0 before the model scored a feature vector.
+
+double Scorer::modelLL()
+{
+	if( ModelNumber == 0 )
+	{
+		return 0.0;
+	}
+
+	return ModelSum/(double)ModelNumber;
+}
+
+//! The running average world log-likelihood, 0 without a world model or before it scored a
+//! feature vector.
+
+double Scorer::worldLL()
+{
+	if( World == NULL || WorldNumber == 0 )
+	{
+		return 0.0;
+	}
+
+	return WorldSum/(double)WorldNumber;
+}
+
+//! The running score, 0 until both models scored a feature vector.
+
+double Scorer::LLR()
+{
+	if( !Scored() )
+	{
+		return 0.0;
+	}
+
+	return modelLL() - worldLL();
+}
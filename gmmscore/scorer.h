@@ -0,0 +1,70 @@
+#ifndef SCORER_H
+#define SCORER_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include "gmm.h"
+#include "profile.h"
+
+//! Streaming scorer.
+//! Feature vectors are pushed as they arrive and the running score can be queried at any time;
+//! it is 0 until both models have scored a feature vector (see Scored()).
+//! The score is the average model log-likelihood, normalized by the average world
+//! log-likelihood when a world model is given, exactly as GMM::LogL() computes it.
+//!
+//! With a world model the scorer can stop early: it tracks the mean and variance of the
+//! frame log-likelihood ratios and decides once the confidence interval of the mean lies
+//! above the accept or below the reject threshold.
+
+class Scorer {
+	public:
+		//! Constructor.
+		/*!	\param Speaker model.
+			\param World model, NULL for an unnormalized score.
+		*/
+		Scorer( GMM *, GMM * =NULL );
+
+		unsigned int push( const float *, unsigned int =1 );
+		void reset();
+
+		void setDecision( double, double, double, unsigned int );
+		int Decision() { return Decided; }	//!< 1 accepted, -1 rejected, 0 no decision yet.
+
+		double LLR();
+		double modelLL();
+		double worldLL();
+
+		unsigned int Frames() { return FrameNumber; }		//!< The number of feature vectors pushed.
+		unsigned int Ignored() { return IgnoredNumber; }	//!< The number of feature vectors ignored by either model.
+		bool Scored() { return ModelNumber > 0 && ( World == NULL || WorldNumber > 0 ); }	//!< False until both models scored a feature vector.
+
+	private:
+
+		GMM *Model;		//!< Speaker model.
+		GMM *World;		//!< World model.
+
+		vector<double> frame;	//!< Feature vector being scored.
+
+		double ModelSum;	//!< Sum of the model log-likelihoods.
+		double WorldSum;	//!< Sum of the world log-likelihoods.
+		unsigned int ModelNumber;	//!< The number of feature vectors scored by the model.
+		unsigned int WorldNumber;	//!< The number of feature vectors scored by the world model.
+		unsigned int FrameNumber;
+		unsigned int IgnoredNumber;
+		unsigned int Dimension;
+
+		bool Early;		//!< Stop once a decision is reached.
+		double Accept;		//!< Accept once the frame ratio mean is confidently above this.
+		double Reject;		//!< Reject once the frame ratio mean is confidently below this.
+		double Confidence;	//!< Confidence interval width in standard errors.
+		unsigned int MinFrames;	//!< Never decide on fewer frame ratios.
+		int Decided;
+
+		unsigned int RatioNumber;	//!< The number of frame ratios (frames scored by both models).
+		double RatioMean;	//!< Running mean of the frame ratios.
+		double RatioM2;		//!< Running sum of squared deviations of the frame ratios.
+};
+
+#endif
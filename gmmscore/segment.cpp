@@ -0,0 +1,179 @@
+#include "segment.h"
+#include "profile.h"
+
+SegmentScores::SegmentScores()
+{
+	Frames = 0;
+	Sum.assign( 1, 0.0 );
+	Count.assign( 1, 0 );
+}
+
+//! Append the LLR of the next feature vector.
+
+void SegmentScores::push( double value, bool scored )
+{
+	Sum.push_back( Sum.back() + ( scored ? value : 0.0 ) );
+	Count.push_back( Count.back() + ( scored ? 1 : 0 ) );
+	Frames++;
+}
+
+//! Score a data list feature vector by feature vector.
+/*!	\param model.
+	\param world model, NULL for model log-likelihoods.
+	\param data files.
+	\param feature vectors read at a time.
+*/
+
+void SegmentScores::score( GMM &model, GMM *world, const vector<string> &files, unsigned int block )
+{
+	const unsigned int D = model.getDimension();
+	vector<double> frames( (size_t)block*D );
+	HTKReader reader;
+	unsigned int f = 0, number, T;
+	double value = 0.0, worldValue = 0.0;
+	bool scored;
+
+	while( f < files.size() )
+	{
+		if( !reader.open( files[f] ) )
+		{
+			ScoreError( "SetupData(): Cannot open data file " + files[f], -502 );
+		}
+
+		while( ( number = reader.read( &frames[0], block, D ) ) > 0 )
+		{
+			ProfileTimer timer( PHASE_SCORE );
+			T = 0;
+
+			while( T < number )
+			{
+				scored = model.frameLogL( &frames[(size_t)T*D], value );
+				scored = ( world == NULL || world->frameLogL( &frames[(size_t)T*D], worldValue ) ) && scored;
+				push( value - worldValue, scored );
+				T++;
+			}
+
+			profileWork( PHASE_SCORE, (unsigned long long)number*model.getMixtureNumber()*( world == NULL ? 1 : 2 ) );
+		}
+
+		reader.close();
+		f++;
+	}
+}
+
+//! Score a data list over the top UBM mixtures of every feature vector (gmmscore -C).
+/*!	\param model adapted from the UBM.
+	\param UBM (world model).
+	\param content hash of the UBM file.
+	\param UBM mixtures scored per feature vector.
+	\param sidecar cache directory, empty to compute the sidecars without storing them.
+	\param data files.
+	\param feature vectors read at a time.
+*/
+
+void SegmentScores::score( GMM &model, const GMM &world, unsigned long long worldHash, unsigned int top, string cacheDir, const vector<string> &files, unsigned int block )
+{
+	const unsigned int D = model.getDimension();
+	vector<double> frames( (size_t)block*D ), PR( top );
+	HTKReader reader;
+	Sidecar side;
+	unsigned int f = 0, number, offset, T;
+	double value;
+	int status;
+
+	while( f < files.size() )
+	{
+		status = side.prepare( world.getModel(), worldHash, top, files[f], cacheDir, block );
+
+		if( status != 0 )
+		{
+			ScoreError( side.Error, status );
+		}
+
+		if( !reader.open( files[f] ) )
+		{
+			ScoreError( "SetupData(): Cannot open data file " + files[f], -502 );
+		}
+
+		offset = 0;
+
+		while( ( number = reader.read( &frames[0], block, D ) ) > 0 )
+		{
+			ProfileTimer timer( PHASE_SCORE );
+
+			if( offset + number > side.Frames )
+			{
+				ScoreError( "Score(): Sidecar of " + files[f] + " has too few feature vectors", -1006 );
+			}
+
+			T = 0;
+			while( T < number )
+			{
+				if( side.LL[offset + T] != -HUGE_VAL && topLogL( model.getModel(), &frames[(size_t)T*D], &side.Index[(size_t)( offset + T )*top], top, &PR[0], value ) )
+				{
+					push( value - side.LL[offset + T], true );
+				}
+				else
+				{
+					push( 0.0, false );
+				}
+				T++;
+			}
+
+			profileWork( PHASE_SCORE, (unsigned long long)number*top );
+			offset += number;
+		}
+
+		reader.close();
+		f++;
+	}
+}
+
+//! Average LLR of a segment.
+/*!	\param first feature vector.
+	\param feature vector after the last one (at most Frames).
+	\param number of scored feature vectors of the segment.
+	\return average LLR of the scored feature vectors, 0 if there are none.
+*/
+
+double SegmentScores::LLR( unsigned int start, unsigned int end, unsigned int &scored ) const
+{
+	scored = Count[end] - Count[start];
+
+	return scored > 0 ? ( Sum[end] - Sum[start] ) / (double)scored : 0.0;
+}
+
+bool readSegments( string segmentFile, vector<Segment> &segments )
+{
+	ifstream Fsegments( segmentFile.c_str() );
+	string line;
+	Segment segment;
+
+	if( !Fsegments )
+	{
+		return false;
+	}
+
+	segments.clear();
+
+	while( getline( Fsegments, line ) )
+	{
+		std::istringstream fields( line );
+
+		if( line.find_first_not_of( " \t\r" ) == string::npos )
+		{
+			continue;
+		}
+
+		if( !( fields >> segment.Start >> segment.End ) )
+		{
+			return false;
+		}
+
+		segment.Label.clear();
+		fields >> segment.Label;
+		segments.push_back( segment );
+	}
+
+	return true;
+}
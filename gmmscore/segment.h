@@ -0,0 +1,60 @@
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include "gmm.h"
+
+//! Segment of the feature vectors of a data list, frames numbered over all files of the list.
+
+typedef struct {
+	unsigned int	Start,		//!< first feature vector.
+			End;		//!< feature vector after the last one.
+	string		Label;		//!< optional label, written with the score.
+}Segment;
+
+//! Binary segment score record (gmmscore -M).
+
+typedef struct {
+	unsigned int	Start,		//!< first feature vector.
+			End,		//!< feature vector after the last one.
+			Frames;		//!< scored feature vectors.
+	float		LLR;		//!< average frame LLR.
+}SegmentRecord;
+
+//! Per feature vector LLRs of a data list kept as prefix sums (gmmscore -J, -Y).
+//! The data is scored once, afterwards the average LLR of any segment costs two
+//! subtractions. A feature vector contributes the difference of its model and world
+//! log-likelihoods (the model log-likelihood without a world model); when either of them
+//! ignores it, it is not counted.
+
+class SegmentScores {
+	public:
+		SegmentScores();
+
+		void score( GMM &, GMM *, const vector<string> &, unsigned int );
+		void score( GMM &, const GMM &, unsigned long long, unsigned int, string, const vector<string> &, unsigned int );
+
+		double LLR( unsigned int, unsigned int, unsigned int & ) const;
+
+		unsigned int Frames;		//!< Feature vectors of the data list.
+
+	private:
+
+		void push( double, bool );
+
+		vector<double> Sum;		//!< LLR sum of the feature vectors before every position (Frames + 1).
+		vector<unsigned int> Count;	//!< Scored feature vectors before every position (Frames + 1).
+};
+
+//! Read a segment list: one segment per line, first and last + 1 feature vector and an optional label.
+/*!	\param segment list file.
+	\param segments.
+	\return false if the list cannot be opened or holds a malformed line.
+*/
+
+bool readSegments( string, vector<Segment> & );
+
+#endif
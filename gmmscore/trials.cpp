@@ -0,0 +1,378 @@
+#include "trials.h"
+#include "gmm.h"
+#include "htk.h"
+#include "score.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+//! Orders trials by utterance, then by model.
+
+namespace {
+
+struct UtteranceOrder {
+	UtteranceOrder( const vector<Trial> &trials ) : Trials( trials ) {}
+
+	bool operator()( unsigned int a, unsigned int b ) const
+	{
+		if( Trials[a].Utterance != Trials[b].Utterance )
+		{
+			return Trials[a].Utterance < Trials[b].Utterance;
+		}
+		return Trials[a].Model < Trials[b].Model || ( Trials[a].Model == Trials[b].Model && a < b );
+	}
+
+	const vector<Trial> &Trials;
+};
+
+}
+
+//! Number of a name, new names are numbered in order of appearance.
+
+static unsigned int nameNumber( const string &name, std::map<string, unsigned int> &numbers, vector<string> &names )
+{
+	std::map<string, unsigned int>::iterator found = numbers.find( name );
+
+	if( found != numbers.end() )
+	{
+		return found->second;
+	}
+
+	numbers[name] = names.size();
+	names.push_back( name );
+
+	return names.size() - 1;
+}
+
+TrialList::TrialList( unsigned int modelType, unsigned int mixtures, unsigned int length, double floor, string worldFile, unsigned int worldType, size_t modelBudget, size_t featureBudget, unsigned int block ) : Models( modelBudget ), Utterances( featureBudget )
+{
+	ModelType = modelType;
+	MixtureNumber = mixtures;
+	Dimension = length;
+	vFloor = floor;
+	WorldFile = worldFile;
+	WorldType = worldType;
+	Top = 0;
+	WorldHash = 0;
+	World = NULL;
+	Block = block;
+	ModelsLoaded = 0;
+	UtterancesDecoded = 0;
+
+	PR.resize( MixtureNumber );
+
+	if( ! WorldFile.empty() )
+	{
+		World = new Model( MixtureNumber, Dimension, vFloor );
+
+		int status = World->load( WorldFile, WorldType );
+
+		if( status != 0 )
+		{
+			ScoreError( World->Error, status );
+		}
+	}
+}
+
+TrialList::~TrialList()
+{
+	delete World;
+}
+
+//! Read a trial list: one trial per line, model file, feature file and an optional key.
+/*!	\param trial list file.
+*/
+
+void TrialList::load( string trialFile )
+{
+	ifstream Ftrials( trialFile.c_str() );
+	std::map<string, unsigned int> modelNumbers, utteranceNumbers;
+	string line, modelFile, featureFile;
+	Trial trial;
+
+	if( !Ftrials )
+	{
+		ScoreError( "Trials(): Cannot open trial list file " + trialFile, -1200 );
+	}
+
+	Trials.clear();
+	ModelFiles.clear();
+	UtteranceFiles.clear();
+
+	while( getline( Ftrials, line ) )
+	{
+		std::istringstream fields( line );
+
+		if( !( fields >> modelFile ) )
+		{
+			continue;
+		}
+
+		if( !( fields >> featureFile ) )
+		{
+			ScoreError( "Trials(): Trial without feature file in " + trialFile + ": " + line, -1201 );
+		}
+
+		trial.Key.clear();
+		fields >> trial.Key;
+		trial.Model = nameNumber( modelFile, modelNumbers, ModelFiles );
+		trial.Utterance = nameNumber( featureFile, utteranceNumbers, UtteranceFiles );
+		trial.Score = 0.0;
+		Trials.push_back( trial );
+	}
+
+	WorldLL.assign( UtteranceFiles.size(), NAN );
+}
+
+//! Score the models only over the top world mixtures of every feature vector (gmmscore -C).
+/*!	\param world mixtures scored per feature vector.
+	\param sidecar cache directory, empty to compute the sidecars without storing them.
+*/
+
+void TrialList::setTop( unsigned int top, string cacheDir )
+{
+	Top = top;
+	CacheDir = cacheDir;
+	WorldHash = fileHash( WorldFile );
+
+	if( WorldHash == 0 )
+	{
+		ScoreError( "Trials(): Cannot open world model file " + WorldFile, -1202 );
+	}
+}
+
+//! Model of a model number, loaded if it is not in the model cache.
+
+Model *TrialList::getModel( unsigned int number )
+{
+	Model *model = Models.find( number );
+
+	if( model != NULL )
+	{
+		return model;
+	}
+
+	model = new Model( MixtureNumber, Dimension, vFloor );
+
+	int status = model->load( ModelFiles[number], ModelType, WorldFile );
+
+	if( status != 0 )
+	{
+		ScoreError( model->Error, status );
+	}
+
+	Models.insert( number, model, parameterNumber( MixtureNumber, Dimension )*sizeof( double ) );
+	ModelsLoaded++;
+
+	return model;
+}
+
+//! Utterance of an utterance number, decoded if it is not in the feature cache.
+
+Utterance *TrialList::getUtterance( unsigned int number )
+{
+	Utterance *utterance = Utterances.find( number );
+	HTKReader reader;
+	unsigned int read, total;
+
+	if( utterance != NULL )
+	{
+		return utterance;
+	}
+
+	if( !reader.open( UtteranceFiles[number] ) )
+	{
+		ScoreError( "SetupData(): Cannot open data file " + UtteranceFiles[number], -502 );
+	}
+
+	utterance = new Utterance;
+	utterance->Frames.resize( (size_t)reader.Remaining()*Dimension );
+	utterance->Number = 0;
+
+	// The reader widens samples in place, a read may not ask for more vectors than fit
+	while( ( total = reader.Remaining() ) > 0 && ( read = reader.read( &utterance->Frames[(size_t)utterance->Number*Dimension], total < Block ? total : Block, Dimension ) ) > 0 )
+	{
+		utterance->Number += read;
+	}
+
+	reader.close();
+	utterance->Frames.resize( (size_t)utterance->Number*Dimension );
+
+	if( Top > 0 )
+	{
+		int status = utterance->Side.prepare( *World, WorldHash, Top, UtteranceFiles[number], CacheDir, Block );
+
+		if( status != 0 )
+		{
+			ScoreError( utterance->Side.Error, status );
+		}
+
+		if( utterance->Side.Frames != utterance->Number )
+		{
+			ScoreError( "Trials(): Sidecar of " + UtteranceFiles[number] + " does not match its feature vectors", -1006 );
+		}
+	}
+
+	Utterances.insert( number, utterance, utterance->Frames.size()*sizeof( double ) + utterance->Side.LL.size()*sizeof( double ) + utterance->Side.Index.size()*sizeof( unsigned short ) );
+	UtterancesDecoded++;
+
+	return utterance;
+}
+
+//! Average log-likelihood of an utterance, as gmmscore scores a one-file data list.
+/*!	\param model.
+	\param utterance.
+	\param utterance number.
+*/
+
+double TrialList::modelLL( const Model &model, const Utterance &utterance, unsigned int number )
+{
+	const unsigned int D = Dimension;
+	unsigned int T = 0, length, processed = 0, ignored = 0;
+	double LL = 0.0, value;
+
+	if( Top == 0 )
+	{
+		// Blocks of the size gmmscore reads, so the sums are the same
+		while( T < utterance.Number )
+		{
+			length = utterance.Number - T < Block ? utterance.Number - T : Block;
+			blockLogL( model, &utterance.Frames[(size_t)T*D], length, &PR[0], LL, processed, ignored );
+			T += length;
+		}
+	}
+	else
+	{
+		ProfileTimer timer( PHASE_SCORE );
+
+		while( T < utterance.Number )
+		{
+			if( utterance.Side.LL[T] != -HUGE_VAL && topLogL( model, &utterance.Frames[(size_t)T*D], &utterance.Side.Index[(size_t)T*Top], Top, &PR[0], value ) )
+			{
+				LL += value;
+				processed++;
+			}
+			T++;
+		}
+
+		profileWork( PHASE_SCORE, (unsigned long long)utterance.Number*Top );
+	}
+
+	if( processed == 0 )
+	{
+		ScoreError( "Trials(): No feature vector of " + UtteranceFiles[number] + " could be scored", -1203 );
+	}
+
+	return LL/(double)processed;
+}
+
+//! Score all trials.
+//! The models are taken in blocks that fit the model cache, in order of appearance. The
+//! trials of a block are scored utterance by utterance, every other block visits the
+//! utterances in reverse so the ones decoded last are still in the feature cache.
+
+void TrialList::score()
+{
+	const size_t modelSize = parameterNumber( MixtureNumber, Dimension )*sizeof( double );
+	unsigned int first = 0, last, t, n, k;
+	unsigned int processed, ignored;
+	bool reverse = false;
+	vector<unsigned int> order;
+	Utterance *utterance;
+	Model *model;
+
+	while( first < ModelFiles.size() )
+	{
+		last = first + 1;
+		while( last < ModelFiles.size() && (size_t)( last + 1 - first )*modelSize <= Models.Budget )
+		{
+			last++;
+		}
+
+		order.clear();
+		t = 0;
+		while( t < Trials.size() )
+		{
+			if( Trials[t].Model >= first && Trials[t].Model < last )
+			{
+				order.push_back( t );
+			}
+			t++;
+		}
+
+		std::sort( order.begin(), order.end(), UtteranceOrder( Trials ) );
+
+		if( reverse )
+		{
+			// Utterance groups in reverse, models within a group stay in order
+			n = 0;
+			while( n < order.size() )
+			{
+				k = n;
+				while( k < order.size() && Trials[order[k]].Utterance == Trials[order[n]].Utterance )
+				{
+					k++;
+				}
+				std::reverse( order.begin() + n, order.begin() + k );
+				n = k;
+			}
+			std::reverse( order.begin(), order.end() );
+		}
+
+		n = 0;
+		while( n < order.size() )
+		{
+			Trial &trial = Trials[order[n]];
+			utterance = getUtterance( trial.Utterance );
+
+			if( World != NULL && std::isnan( WorldLL[trial.Utterance] ) )
+			{
+				processed = 0;
+				ignored = 0;
+				WorldLL[trial.Utterance] = Top > 0 ? utterance->Side.worldLL( processed, ignored ) / (double)processed : modelLL( *World, *utterance, trial.Utterance );
+
+				if( Top > 0 && processed == 0 )
+				{
+					ScoreError( "Trials(): No feature vector of " + UtteranceFiles[trial.Utterance] + " could be scored", -1203 );
+				}
+			}
+
+			model = getModel( trial.Model );
+			trial.Score = modelLL( *model, *utterance, trial.Utterance ) - ( World != NULL ? WorldLL[trial.Utterance] : 0.0 );
+			n++;
+		}
+
+		reverse = !reverse;
+		first = last;
+	}
+}
+
+//! Write one line per trial in list order: model, feature file, key (if given) and score.
+/*!	\param results file.
+	\param tag written before every line, empty for none.
+*/
+
+void TrialList::write( ofstream &Fresult, string tag )
+{
+	unsigned int t = 0;
+
+	while( t < Trials.size() )
+	{
+		if( ! tag.empty() )
+		{
+			Fresult << tag << "\t";
+		}
+
+		Fresult << ModelFiles[Trials[t].Model] << "\t" << UtteranceFiles[Trials[t].Utterance] << "\t";
+
+		if( ! Trials[t].Key.empty() )
+		{
+			Fresult << Trials[t].Key << "\t";
+		}
+
+		Fresult << Trials[t].Score << endl;
+		t++;
+	}
+}
@@ -0,0 +1,165 @@
+#ifndef TRIALS_H
+#define TRIALS_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include <list>
+#include <map>
+
+#include "model.h"
+#include "sidecar.h"
+
+//! Least recently used cache with a memory budget.
+//! Entries are owned by the cache and deleted when evicted. The entry just inserted is
+//! never evicted, so a single entry larger than the budget is still held.
+
+template<class T>
+class LRUCache {
+	public:
+		//! Constructor.
+		/*!	\param memory budget in bytes.
+		*/
+		LRUCache( size_t budget ) : Budget( budget ), Used( 0 ), Hits( 0 ), Misses( 0 ) {}
+
+		~LRUCache()
+		{
+			while( !Entries.empty() )
+			{
+				delete Entries.back().Value;
+				Entries.pop_back();
+			}
+		}
+
+		//! Entry of a key, NULL if it is not cached. A found entry becomes the most recently used.
+		T *find( unsigned int key )
+		{
+			typename std::map<unsigned int, typename std::list<Entry>::iterator>::iterator found = Index.find( key );
+
+			if( found == Index.end() )
+			{
+				Misses++;
+				return NULL;
+			}
+
+			Hits++;
+			Entries.splice( Entries.begin(), Entries, found->second );
+
+			return found->second->Value;
+		}
+
+		//! Add an entry as the most recently used one, evicting the least recently used ones
+		//! until the budget holds.
+		void insert( unsigned int key, T *value, size_t size )
+		{
+			Entry entry = { key, value, size };
+
+			while( !Entries.empty() && Used + size > Budget )
+			{
+				Used -= Entries.back().Size;
+				Index.erase( Entries.back().Key );
+				delete Entries.back().Value;
+				Entries.pop_back();
+			}
+
+			Entries.push_front( entry );
+			Index[key] = Entries.begin();
+			Used += size;
+		}
+
+		size_t Budget;			//!< Memory budget in bytes.
+		size_t Used;			//!< Memory held in bytes.
+		unsigned long long Hits;	//!< Lookups that found their entry.
+		unsigned long long Misses;	//!< Lookups that did not.
+
+	private:
+
+		struct Entry {
+			unsigned int Key;
+			T *Value;
+			size_t Size;
+		};
+
+		std::list<Entry> Entries;	//!< Most recently used first.
+		std::map<unsigned int, typename std::list<Entry>::iterator> Index;
+};
+
+//! One trial: a model scored against an utterance.
+
+typedef struct {
+	unsigned int	Model,		//!< model number.
+			Utterance;	//!< utterance number.
+	string		Key;		//!< optional key, written with the score.
+	double		Score;		//!< log-likelihood (ratio) of the trial.
+}Trial;
+
+//! Decoded utterance held in the feature cache.
+
+typedef struct {
+	vector<double>	Frames;		//!< Feature vectors (Number*Dimension).
+	unsigned int	Number;		//!< Number of feature vectors.
+	Sidecar		Side;		//!< UBM scores and top mixtures (top-C scoring only).
+}Utterance;
+
+//! Trial list scoring (gmmscore -X).
+//! A trial list holds one trial per line: model file, feature file and an optional key.
+//! Every trial is scored as gmmscore scores a model against a one-file data list. Work is
+//! scheduled in blocks of models that fit the model cache: the trials of a block are
+//! grouped by utterance, so every utterance is decoded (or found in the feature cache) once
+//! per block and scored against all of its models of the block, and every model is loaded
+//! once. The world model score of an utterance is computed once.
+
+class TrialList {
+	public:
+		//! Constructor.
+		/*!	\param model file type (1 model, 2 VQ codebook, 3 delta model).
+			\param mixture number.
+			\param feature vector dimension.
+			\param variance flooring constant.
+			\param world model file, empty for unnormalized scores.
+			\param world model file type.
+			\param model cache budget in bytes.
+			\param feature cache budget in bytes.
+			\param feature vectors read at a time.
+		*/
+		TrialList( unsigned int, unsigned int, unsigned int, double, string, unsigned int, size_t, size_t, unsigned int );
+
+		~TrialList();
+
+		void load( string );
+		void setTop( unsigned int, string );
+		void score();
+		void write( ofstream &, string );
+
+		unsigned int size() { return Trials.size(); }	//!< The number of trials.
+		unsigned int models() { return ModelFiles.size(); }	//!< The number of distinct models.
+		unsigned int utterances() { return UtteranceFiles.size(); }	//!< The number of distinct utterances.
+
+		unsigned int ModelsLoaded;	//!< Model files loaded (cache misses).
+		unsigned int UtterancesDecoded;	//!< Feature files decoded (cache misses).
+
+	private:
+
+		Model *getModel( unsigned int );
+		Utterance *getUtterance( unsigned int );
+		double modelLL( const Model &, const Utterance &, unsigned int );
+
+		unsigned int ModelType, MixtureNumber, Dimension, WorldType, Top, Block;
+		double vFloor;
+		string WorldFile;		//!< World model (UBM) file.
+		string CacheDir;		//!< Sidecar cache directory.
+		unsigned long long WorldHash;	//!< Content hash of the world model file.
+
+		Model *World;			//!< World model, NULL for unnormalized scores.
+		vector<Trial> Trials;		//!< Trials in list order.
+		vector<string> ModelFiles;	//!< Model file of every model number.
+		vector<string> UtteranceFiles;	//!< Feature file of every utterance number.
+		vector<double> WorldLL;		//!< World score of every utterance, NaN until computed.
+
+		LRUCache<Model> Models;		//!< Loaded models.
+		LRUCache<Utterance> Utterances;	//!< Decoded utterances.
+		vector<double> PR;		//!< Mixture scratch space.
+};
+
+#endif
@@ -0,0 +1,299 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+#include <getopt.h>
+#include <sys/stat.h>
+
+#include "htk.h"
+#include "random.h"
+
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::ios_base;
+using std::stringstream;
+
+//! Synthetic speaker population.
+//! Feature vectors are drawn from a shared set of Gaussian components, every speaker
+//! shifts the component means by its own offset.
+
+class Population {
+	public:
+		Population( unsigned int, unsigned int, unsigned long long );
+
+		void writeFile( string, unsigned int, unsigned int );
+
+	private:
+		Random Generator;
+		unsigned int Components;
+		unsigned int Dimension;
+		vector<double> means;
+		vector<double> deviations;
+};
+
+Population::Population( unsigned int components, unsigned int length, unsigned long long seed ) : Generator( seed )
+{
+	Components = components;
+	Dimension = length;
+	means.resize( Components*Dimension );
+	deviations.resize( Components*Dimension );
+
+	unsigned int i = 0;
+
+	while( i < Components*Dimension )
+	{
+		means[i] = 6.0*Generator.uniform() - 3.0;
+		deviations[i] = 0.5 + Generator.uniform();
+		i++;
+	}
+}
+
+//! Write a HTK feature file of one speaker.
+/*!	\param file name.
+	\param speaker number.
+	\param number of feature vectors.
+*/
+
+void Population::writeFile( string name, unsigned int speaker, unsigned int samples )
+{
+	ofstream Fdata( name.c_str(), ios_base::binary );
+
+	if( !Fdata )
+	{
+		cout << "Cannot open output file " << name << endl;
+		exit( -1 );
+	}
+
+	HTKHeader Htk;
+
+	Htk.nSamples = samples;
+	Htk.sampPeriod = 100000;
+	Htk.sampSize = sizeof( float )*Dimension;
+	Htk.parmKind = 9;	// USER
+
+	Fdata.write( reinterpret_cast<char *>( &Htk ), sizeof( HTKHeader ) );
+
+	Random Speaker( speaker + 1 );
+	vector<double> offset( Dimension );
+	vector<float> frame( Dimension );
+	unsigned int T = 0, c, j;
+
+	j = 0;
+	while( j < Dimension )
+	{
+		offset[j++] = 0.5*Speaker.gauss();
+	}
+
+	while( T < samples )
+	{
+		c = (unsigned int)( Generator.uniform()*Components );
+		j = 0;
+
+		while( j < Dimension )
+		{
+			frame[j] = (float)( means[c*Dimension + j] + offset[j] + deviations[c*Dimension + j]*Generator.gauss() );
+			j++;
+		}
+
+		Fdata.write( reinterpret_cast<char *>( &frame[0] ), sizeof( float )*Dimension );
+		T++;
+	}
+
+	Fdata.close();
+}
+
+//! Write one corpus file with a length drawn from a log-normal distribution.
+/*!	\param speaker population.
+	\param length generator.
+	\param output directory.
+	\param file name prefix.
+	\param file number.
+	\param speaker number.
+	\param mean length.
+	\param log-normal spread, 0 for fixed length files.
+	\return file name.
+*/
+
+string writeFile( Population &population, Random &lengths, string outDir, string prefix, unsigned int number, unsigned int speaker, unsigned int mean, double spread )
+{
+	stringstream name;
+	double samples = (double)mean;
+
+	if( spread > 0.0 )
+	{
+		samples *= exp( spread*lengths.gauss() - 0.5*spread*spread );
+	}
+
+	name << outDir << "/" << prefix << number << ".htk";
+	population.writeFile( name.str(), speaker, samples < 1.0 ? 1 : (unsigned int)( samples + 0.5 ) );
+
+	return name.str();
+}
+
+void printUsage( void )
+{
+	cout << "gmmsynth: help" << endl;
+	cout << endl;
+	cout << "Writes a synthetic corpus: ubm.list (background speakers), spk.list (target speaker" << endl;
+	cout << "enrollment), tgt.list and imp.list (target and impostor test) and kmeans.cfg" << endl;
+	cout << endl;
+	cout << "-h,  --help\t\tThis message" << endl;
+	cout << "-o,  --output\t\tOutput directory" << endl;
+	cout << "-d,  --dimension\tFeature vector dimension (default 20)" << endl;
+	cout << "-m,  --mixture\t\tMixture number written to kmeans.cfg (default 32)" << endl;
+	cout << "-c,  --components\tNumber of generating Gaussian components (default 64)" << endl;
+	cout << "-s,  --speakers\t\tNumber of background speakers (default 20)" << endl;
+	cout << "-l,  --length\t\tMean feature vectors per file (default 3000)" << endl;
+	cout << "-D,  --spread\t\tLog-normal spread of the file lengths, 0 = all files -l long (default 0)" << endl;
+	cout << "-t,  --tests\t\tTest files per test list (default 1)" << endl;
+	cout << "-r,  --seed\t\tRandom seed (default 1)" << endl;
+
+	exit( -1 );
+}
+
+int main( int argc, char *argv[] )
+{
+	int nextOption;
+
+	const char * shortOptions = "ho:d:m:c:s:l:D:t:r:";
+
+	const struct option longOptions[] = {
+	{ "help", 0, NULL, 'h' },
+	{ "output", 1, NULL, 'o' },
+	{ "dimension", 1, NULL, 'd' },
+	{ "mixture", 1, NULL, 'm' },
+	{ "components", 1, NULL, 'c' },
+	{ "speakers", 1, NULL, 's' },
+	{ "length", 1, NULL, 'l' },
+	{ "spread", 1, NULL, 'D' },
+	{ "tests", 1, NULL, 't' },
+	{ "seed", 1, NULL, 'r' },
+	{ NULL, 0, NULL, 0 }
+	};
+
+	string outDir;
+	unsigned int dimension = 20, mixture = 32, components = 64, speakers = 20, length = 3000, tests = 1, seed = 1;
+	double spread = 0.0;
+
+	do {
+		nextOption = getopt_long( argc, argv, shortOptions, longOptions, NULL );
+
+		switch( nextOption )
+		{
+			case 'o':
+				outDir = optarg;
+				break;
+
+			case 'd':
+				dimension = atoi( optarg );
+				break;
+
+			case 'm':
+				mixture = atoi( optarg );
+				break;
+
+			case 'c':
+				components = atoi( optarg );
+				break;
+
+			case 's':
+				speakers = atoi( optarg );
+				break;
+
+			case 'l':
+				length = atoi( optarg );
+				break;
+
+			case 'D':
+				spread = atof( optarg );
+				break;
+
+			case 't':
+				tests = atoi( optarg );
+				break;
+
+			case 'r':
+				seed = atoi( optarg );
+				break;
+
+			case 'h':
+				printUsage();
+
+			case '?':
+				printUsage();
+
+			case -1:
+				break;
+
+			default:
+				abort();
+		}
+
+	} while( nextOption != -1 );
+
+	if( outDir.empty() || dimension == 0 || components == 0 || speakers == 0 || length == 0 || tests == 0 )
+	{
+		cout << "-o, --output not set or zero sized corpus" << endl;
+		printUsage();
+	}
+
+	mkdir( outDir.c_str(), 0755 );
+
+	Population population( components, dimension, seed );
+	Random lengths( seed + 7919 );
+	ofstream Flist;
+	unsigned int i = 0;
+
+	Flist.open( ( outDir + "/ubm.list" ).c_str() );
+	while( i < speakers )
+	{
+		Flist << writeFile( population, lengths, outDir, "ubm", i, i, length, spread ) << endl;
+		i++;
+	}
+	Flist.close();
+
+	// Target speaker (enrollment and test) and impostor speakers are not in the background set
+	Flist.open( ( outDir + "/spk.list" ).c_str() );
+	Flist << writeFile( population, lengths, outDir, "spk", 0, speakers, length, spread ) << endl;
+	Flist << writeFile( population, lengths, outDir, "spk", 1, speakers, length, spread ) << endl;
+	Flist.close();
+
+	Flist.open( ( outDir + "/tgt.list" ).c_str() );
+	i = 0;
+	while( i < tests )
+	{
+		Flist << writeFile( population, lengths, outDir, "tgt", i, speakers, length, spread ) << endl;
+		i++;
+	}
+	Flist.close();
+
+	Flist.open( ( outDir + "/imp.list" ).c_str() );
+	i = 0;
+	while( i < tests )
+	{
+		Flist << writeFile( population, lengths, outDir, "imp", i, speakers + 1 + i, length, spread ) << endl;
+		i++;
+	}
+	Flist.close();
+
+	Flist.open( ( outDir + "/kmeans.cfg" ).c_str() );
+	Flist << "VECTOR 1000" << endl;
+	Flist << "DIMS " << dimension << endl;
+	Flist << "CLUSTER " << mixture << endl;
+	Flist << "LIST " << outDir << "/ubm.list" << endl;
+	Flist << "VQOUT " << outDir << "/ubm.vq" << endl;
+	Flist << "RESULT " << outDir << "/kmeans.res" << endl;
+	Flist.close();
+
+	cout << "Corpus written to " << outDir << endl;
+
+	return 0;
+}
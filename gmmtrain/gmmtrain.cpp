@@ -12,7 +12,7 @@ void printUsage( void )
 	cout << "-o,  --output\t\tOutput model file" << endl;
 	cout << "-i,  --input\t\tInput model file or VQ codebook" << endl;
 	cout << "-l,  --list\t\tFile containing data file list" << endl;
-	cout << "-t,  --inittype\t\tInput init file type 1 = model, 2 = VQ codebook" << endl;
+	cout << "-t,  --inittype\t\tInput init file type 1 = model, 2 = VQ codebook, 3 = none, grow from a single Gaussian by binary splitting (EM only)" << endl;
 	cout << "-e,  --traintype\tTraining type type 1 = EM, 2 = MAP " << endl;
 	cout << "-m,  --mixture\t\tMixture number" << endl;
 	cout << "-d,  --dimension\tFeature vector dimension" << endl;
@@ -23,6 +23,14 @@ void printUsage( void )
 	cout << "-p,  --percent\t\tTermination percent (NO 100% multiplier)" << endl;
 	cout << "-r,  --results\t\tOutput results to this file" << endl;
 	cout << "-c   --cycle\t\tIteration number" << endl;
+	cout << "-s,  --split\t\tEM iterations per intermediate mixture number when growing by splitting (default 2)" << endl;
+	cout << "-k,  --top\t\tAccumulate only this many largest posteriors per feature vector (default all)" << endl;
+	cout << "-q,  --prune\t\tDrop posteriors below this value in the E-step (default 0)" << endl;
+	cout << "-f,  --format\t\tOutput model format 1 = model, 2 = delta model relative to input model (MAP only)" << endl;
+	cout << "-x,  --threshold\tOnly store mixtures with an adaption factor above this value in delta models" << endl;
+	cout << "-T,  --timing\t\tWrite per-phase timers and counters as JSON to this file (- for stderr)" << endl;
+	cout << "-H,  --hardware\t\tAdd cycles, instructions, cache and branch misses per phase to the timing file" << endl;
+	cout << "-P,  --progress\t\tPrint frames/s and ETA to stderr every this many seconds" << endl;
 
 	exit( -1 );
 }
@@ -31,7 +39,7 @@ int main( int argc, char *argv[] )
 {
 	int nextOption;
 
-	const char * shortOptions = "ho:i:l:t:e:m:d:v:n:a:p:r:c:";
+	const char * shortOptions = "ho:i:l:t:e:m:d:v:n:a:p:r:c:s:k:q:f:x:T:P:H";
 
 	const struct option longOptions[] = {
 	{ "help", 0, NULL, 'h' },
@@ -48,14 +56,23 @@ int main( int argc, char *argv[] )
 	{ "percent", 1, NULL, 'p' },
 	{ "results", 1, NULL, 'r' },
 	{ "cycle", 1, NULL, 'c' },
+	{ "split", 1, NULL, 's' },
+	{ "top", 1, NULL, 'k' },
+	{ "prune", 1, NULL, 'q' },
+	{ "format", 1, NULL, 'f' },
+	{ "threshold", 1, NULL, 'x' },
+	{ "timing", 1, NULL, 'T' },
+	{ "hardware", 0, NULL, 'H' },
+	{ "progress", 1, NULL, 'P' },
 	{ NULL, 0, NULL, 0 }
 	};
 
-	string outModelFile, inFile, listFile, resultsFile;
-	unsigned int inittype, traintype, mixture, dimension, vectorNum = 1000, adaptOpt = 0, iteration = 20;
-	double vfloor = 0.1, percent = 0.005;
+	string outModelFile, inFile, listFile, resultsFile, timingFile;
+	unsigned int inittype = 0, traintype = 0, mixture = 0, dimension = 0, vectorNum = 1000, adaptOpt = 0, iteration = 20, format = 1, splitIteration = 2, top = 0;
+	double vfloor = 0.1, percent = 0.005, threshold = 0.0, progress = 0.0, prune = 0.0;
 
 	unsigned int check = 0;
+	bool hardware = false;
 
 	do {
 		nextOption = getopt_long( argc, argv, shortOptions, longOptions, NULL );
@@ -123,6 +140,38 @@ int main( int argc, char *argv[] )
 				iteration = atoi( optarg );
 				break;
 
+			case 's':
+				splitIteration = atoi( optarg );
+				break;
+
+			case 'k':
+				top = atoi( optarg );
+				break;
+
+			case 'q':
+				prune = atof( optarg );
+				break;
+
+			case 'f':
+				format = atoi( optarg );
+				break;
+
+			case 'x':
+				threshold = atof( optarg );
+				break;
+
+			case 'T':
+				timingFile = optarg;
+				break;
+
+			case 'H':
+				hardware = true;
+				break;
+
+			case 'P':
+				progress = atof( optarg );
+				break;
+
 			case 'h':
 				printUsage();
 
@@ -147,7 +196,7 @@ int main( int argc, char *argv[] )
 			testTransaction = true;
 		}
 
-		if( ! (check & 2) )
+		if( ! (check & 2) && inittype != 3 )
 		{
 			cout << "-i, --input not set" << endl;
 			testTransaction = true;
@@ -195,14 +244,72 @@ int main( int argc, char *argv[] )
 			testTransaction = true;
 		}
 
+		if( format == 2 && ( traintype != 2 || inittype != 1 ) )
+		{
+			cout << "-f, --format delta models require MAP adaption (-e 2) of a model file (-t 1)" << endl;
+			testTransaction = true;
+		}
+
+		if( inittype == 3 && traintype != 1 )
+		{
+			cout << "-t, --inittype growing by splitting requires EM training (-e 1)" << endl;
+			testTransaction = true;
+		}
+
+		if( format != 1 && format != 2 )
+		{
+			cout << "-f, --format unknown output format" << endl;
+			testTransaction = true;
+		}
+
 		if( testTransaction == true )
 		{
 			printUsage();
 		}
 	}
 
+	if( progress > 0.0 )
+	{
+		// Every iteration reads the list twice: E-step and log-likelihood
+		unsigned long long passes = 2*iteration;
+
+		if( inittype == 3 )
+		{
+			// Global Gaussian, then the EM iterations of every intermediate mixture number
+			unsigned int size = 2;
+
+			passes++;
+			while( size < mixture )
+			{
+				passes += splitIteration;
+				size *= 2;
+			}
+		}
+
+		profileProgress( progress, passes*listFrames( listFile ) );
+	}
+
+	if( progress > 0.0 || !timingFile.empty() )
+	{
+		string error;
+
+		if( hardware && !profileHardware( error ) )
+		{
+			cout << "Warning: hardware counters not available (" << error << ")" << endl;
+		}
+
+		profileEnable();
+	}
+
 	Speaker person( outModelFile, inFile, inittype, mixture, dimension, vfloor, vectorNum, resultsFile );
 
+	person.prune( top, prune );
+
+	if( inittype == 3 )
+	{
+		person.grow( listFile, splitIteration );
+	}
+
 	double oldLL = 0.0, newLL = 0.0;
 	unsigned int total = 0;
 
@@ -222,7 +329,19 @@ int main( int argc, char *argv[] )
 		}
 	} while( fabs((newLL-oldLL)/(newLL)) > percent );
 
-	person.saveModel();
+	if( format == 2 )
+	{
+		person.saveDelta( adaptOpt, threshold );
+	}
+	else
+	{
+		person.saveModel();
+	}
+
+	if( !profileReport( timingFile ) )
+	{
+		cout << "Cannot write timing file " << timingFile << endl;
+	}
 
 	return 0;
 }
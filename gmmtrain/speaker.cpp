@@ -5,56 +5,46 @@ Speaker::Speaker( string modelName, string modelInitFile, unsigned int initType,
 	MixtureNumber = mixtures;
 	Dimension = length;
 	ModelName = modelName;
+	InitName = modelInitFile;
+	InitType = initType;
 	vFloor = floor;
 	MaxDataNumber = dataSize;
+	TopNumber = 0;
+	Threshold = 0.0;
 
-	means = new vector< valarray<double> * > (MixtureNumber);
-	variances = new vector< valarray<double> * > (MixtureNumber);
-	CPmeans = new vector< valarray<double> * > (MixtureNumber);
-	CPvariances = new vector< valarray<double> * > (MixtureNumber);
-	dataParm = new vector< valarray<double> * >(MaxDataNumber);
-	EX = new vector< valarray<double> * >( MixtureNumber );
-	EX2 = new vector< valarray<double> * >( MixtureNumber );
-	
-	weights = new valarray<double>( 0.0, MixtureNumber );
-	CPweights = new valarray<double>( 0.0, MixtureNumber );
-	globalvars = new valarray<double>( 0.0, Dimension );
-	distance = new valarray<double>( 0.0, Dimension );
-	PR = new valarray<double>( 0.0, MixtureNumber );
-	N = new valarray<double>( 0.0, MixtureNumber );
-	DDA = new valarray<double>( 0.0, MixtureNumber );
-
-	unsigned int i = 0;
-
-	while( i < MixtureNumber )
-	{
-		(*means)[i] = new valarray<double>( 0.0, Dimension );
-		(*variances)[i] = new valarray<double>( 0.0, Dimension );
-		(*CPmeans)[i] = new valarray<double>( 0.0, Dimension );
-		(*CPvariances)[i] = new valarray<double>( 0.0, Dimension );
-		(*EX)[i] = new valarray<double>( 0.0, Dimension );
-		(*EX2)[i++] = new valarray<double>( 0.0, Dimension );
-	}
+	// One region for everything the E-step touches
+	Memory.reserve( arenaSize( parameterNumber( MixtureNumber, Dimension ) ) + statsSize( MixtureNumber, Dimension )
+		+ arenaSize( (size_t)MaxDataNumber*Dimension ) + arenaSize( MixtureNumber ) );
 
-	i = 0;
-	while( i < MaxDataNumber )
-	{
-		(*dataParm)[i++] = new valarray<double>( 0.0, Dimension );
-	}
+	model = new Model( MixtureNumber, Dimension, vFloor, &Memory );
+	stats = new Stats( MixtureNumber, Dimension, &Memory );
+	dataParm = Memory.doubles( (size_t)MaxDataNumber*Dimension );
+	PR = Memory.doubles( MixtureNumber );
+
+	int status = 0;
 
 	if( initType == 1 )
 	{
-		loadModel( modelInitFile );
+		status = model->loadModel( modelInitFile );
 	}
 	else if( initType == 2 )
 	{
-		loadVQ( modelInitFile );
+		status = model->loadVQ( modelInitFile, true );
+	}
+	else if( initType == 3 )
+	{
+		// Parameters are estimated by grow()
 	}
 	else
 	{
 		InClassError( this, "Speaker(): InitType error value specified not known.", -100 );
 	}
 
+	if( status != 0 )
+	{
+		InClassError( this, model->Error, status );
+	}
+
 	Fresult.open( resFile.c_str() );
 
 	if( !Fresult )
@@ -63,229 +53,48 @@ Speaker::Speaker( string modelName, string modelInitFile, unsigned int initType,
 	}
 }
 
-void Speaker::loadModel( string modelFile )
+void Speaker::saveModel( void )
 {
-	Finit.open( modelFile.c_str(), ios_base::binary );
-
-	Finit.read( reinterpret_cast <char *>( &Hmodel ), sizeof( ModelHeader ) );
-
-	if( !Finit )
-	{
-		InClassError( this, "LoadModel(): Cannot open model file " + modelFile + " .", -300 );
-	}
+	int status = model->saveModel( ModelName );
 
-	if( Hmodel.MixtureNumber != MixtureNumber )
+	if( status != 0 )
 	{
-		InClassError( this, "LoadModel(): Model file reports non-equal mixture number", -301 );
-	}
-
-	if( Hmodel.Dimension != Dimension )
-	{
-		InClassError( this, "LoadModel(): Model file reports non-equal feature vector dimension", -302 );
-	}
-
-	int i = 0;
-	double value;
-
-	while( i < Dimension )
-	{
-		Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
-		(*globalvars)[i++] = value;
-	}
-
-	int j = 0;
-	i = 0;
-
-	while( i < MixtureNumber )
-	{
-		Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
-		(*weights)[i] = value;
-
-		while( j < Dimension )
-		{
-			Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
-			(*(*means)[i])[j] = value;
-
-			Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
-			(*(*variances)[i])[j++] = value;
-		}
-		j = 0;
-		i++;
+		InClassError( this, model->Error, status );
 	}
-	
-	Finit.close();
 }
 
-void Speaker::loadVQ( string dataFile )
+void Speaker::saveDelta( unsigned int flags, double threshold )
 {
-	Finit.open( dataFile.c_str() );
-
-	if( !Finit )
-	{
-		InClassError( this, "LoadVQ(): Cannot open VQcodebook file " + dataFile + " .", -200 );
-	}
-
-	int SkipNumber = 6*Dimension*Dimension;
-
-	// Ignore headers and mean data
-	Finit.ignore( SkipNumber, '\n' );
-	Finit.ignore( SkipNumber, '\n' );
-	Finit.ignore( SkipNumber, '\n' );
-	Finit.ignore( SkipNumber, '\n' );
-
-	int i = 0;
-	double value;
-
-	while( i < Dimension )
+	if( InitType != 1 )
 	{
-		Finit >> value;
-		(*globalvars)[i++] = value;
+		InClassError( this, "SaveDelta(): Delta models can only be saved relative to a model file (type 1).",  -800 );
 	}
 
-//	(*globalvars) = pow( (*globalvars), -1.0 );
-	(*globalvars) *= vFloor;
-
-	int type = 0;
-	Finit >> type;	// magic
-	Finit >> type; // type
+	int status = model->saveDelta( ModelName, InitName, flags, stats->DDA, threshold );
 
-	if( type != 0 )
+	if( status != 0 )
 	{
-		InClassError( this, "LoadVQ(): Cannot read in tree-structed VQ codebook.", -201 );
+		InClassError( this, model->Error, status );
 	}
-
-	int covkind = 0;
-	Finit >> covkind;
-
-	if( covkind != 1 )
-	{
-		InClassError( this, "LoadVQ(): File contains non-diagonal covariance values.", -202 );
-	}
-
-	int clusterNumber = 0;
-	Finit >> clusterNumber;
-
-	if( clusterNumber != MixtureNumber )
-	{
-		InClassError( this, "LoadVQ(): The cluster number does not match mixture number.", -203 );
-	}
-
-	int streamNumber = 0;
-	Finit >> streamNumber;
-
-	if( streamNumber != 1 )
-	{
-		InClassError( this, "LoadVQ(): More than one stream in file.", -204 );
-	}
-
-	int streamWidth = 0;
-	Finit >> streamWidth;
-
-	if( streamWidth != Dimension )
-	{
-		InClassError( this, "LoadVQ(): Stream width not equal to feature vector dimension.", -205 );
-	}
-
-	// Readout cluster header
-	Finit.ignore( 40, '\n' );
-	Finit.ignore( 40, '\n' );
-
-	// Read cluster data
-	int j;
-	i = 0;
-
-	while( i < MixtureNumber )
-	{
-		j = 0;
-
-		while( j < Dimension )
-		{
-			Finit >> value;
-			(*(*means)[i])[j++] = value;
-		}
-
-		j = 0;
-
-		while( j < Dimension )
-		{
-			Finit >> value;
-			//value = pow( value, -1.0 );
-
-			if( value < (*globalvars)[j] )
-			{
-				(*(*variances)[i])[j] = (*globalvars)[j];
-			}
-			else 
-			{
-				(*(*variances)[i])[j] = value;
-			}
-			j++;
-		}
-		i++;
-
-		// Readout next header
-		Finit.ignore( 40, '\n' );
-		Finit.ignore( 40, '\n' );
-		Finit.ignore( 40, '\n' );
-	}
-
-	i = 0;
-
-	while( i < MixtureNumber )
-	{
-		(*weights)[i++] = 1.0/(double)MixtureNumber;
-	}
-
-	Finit.close();
 }
 
-void Speaker::saveModel( void )
-{
-	Fmodel.open( ModelName.c_str(), ios_base::binary );
-
-	if( !Fmodel )
-	{
-		InClassError( this, "SaveModel(): Cannot open output model file " + ModelName,  -400 );
-	}
-
-	Hmodel.MixtureNumber = MixtureNumber;
-	Hmodel.Dimension = Dimension;
-	Hmodel.vFloor = vFloor;
-
-	Fmodel.write( reinterpret_cast< char * > ( &Hmodel ), sizeof( ModelHeader ) );
-
-	int i = 0;
-
-	while( i < Dimension )
-	{
-		Fmodel.write( reinterpret_cast <char *>( &(*globalvars)[i++] ), sizeof(double) );
-	}
-
-	int j = 0;
-	i = 0;
-
-	while( i < MixtureNumber )
-	{
-		Fmodel.write( reinterpret_cast <char *>( &(*weights)[i] ), sizeof(double) );
-
-		while( j < Dimension )
-		{
-			Fmodel.write( reinterpret_cast <char *>( &(*(*means)[i])[j] ), sizeof(double) );
-			Fmodel.write( reinterpret_cast <char *>( &(*(*variances)[i])[j++] ), sizeof(double) );
-		}
+//! Accumulate only the largest posteriors in the E-step, see Stats::prune().
+/*!	\param number of posteriors kept per feature vector, 0 for all.
+	\param posterior threshold, 0 for none.
+*/
 
-		j = 0;
-		i++;
-	}
-	
-	Fmodel.close();
+void Speaker::prune( unsigned int top, double threshold )
+{
+	TopNumber = top;
+	Threshold = threshold;
+	stats->prune( TopNumber, Threshold );
 }
 
 void Speaker::modifyModel( string dataList, int task, unsigned int flags )
 {
-	Flist.open( dataList.c_str() );
+	vector<string> files;
 
-	if( !Flist )
+	if( !readList( dataList, files ) )
 	{
 		saveModel();
 		InClassError( this, "SetupData(): Cannot open data list file " + dataList,  -500 );
@@ -297,76 +106,32 @@ void Speaker::modifyModel( string dataList, int task, unsigned int flags )
 		InClassError( this, "SetupData(): Unknown task given",  -501 );
 	}
 
-	string dataFile;
-	float htkData = 0.0f;
-	unsigned int i, j;
-	VectorProcessNumber = 0;
-	VectorsIgnored = 0;
-
-	Flist >> dataFile;
+	unsigned int f = 0, number;
 
 	cout << "ModifyModel()" << endl;
-	while( !Flist.eof() )
+	while( f < files.size() )
 	{
-		Fdata.clear();
-		Fdata.open( dataFile.c_str(), ios_base::binary );
-
-		if( !Fdata )
+		if( !Reader.open( files[f] ) )
 		{
-			InClassError( this, "SetupData(): Cannot open data file " + dataFile,  -502 );
+			InClassError( this, "SetupData(): Cannot open data file " + files[f],  -502 );
 		}
 
-		Fdata.read( reinterpret_cast<char *> ( &Htk ), sizeof( Htk ) );
-
-		Fresult << dataFile << endl;
-		unsigned int tmpSamples = Htk.nSamples;
+		Fresult << files[f] << endl;
 		SpeakerIgnored = 0;
 
-		if( Htk.nSamples > MaxDataNumber )
+		while( ( number = Reader.read( dataParm, MaxDataNumber, Dimension ) ) > 0 )
 		{
-			while( tmpSamples > MaxDataNumber )
-			{
-
-				i = 0;
-
-				while( i < MaxDataNumber )
-				{
-					j = 0;
-					while( j < Dimension )
-					{
-						Fdata.read(  reinterpret_cast<char *> ( &htkData ), sizeof( float ));
-						(*(*dataParm)[i])[j++] = (double)htkData;
-					}
-					i++;
-				}
-
-				ExpectStep( MaxDataNumber );
-
-				tmpSamples -= MaxDataNumber;
-			}
-		}
-
-// process rest of samples
-		i = 0;
-
-		while( i < tmpSamples )
-		{
-			j = 0;
-			while( j < Dimension )
-			{
-				Fdata.read(  reinterpret_cast<char *> ( &htkData ), sizeof( float ));
-				(*(*dataParm)[i])[j++] = (double)htkData;
-			}
-			i++;
+			ExpectStep( number );
 		}
 
-		ExpectStep( tmpSamples );
-
-		Fdata.close();
-		Flist >> dataFile;
-		Fresult << SpeakerIgnored << " " <<  Htk.nSamples << endl;
+		Reader.close();
+		Fresult << SpeakerIgnored << " " <<  Reader.Htk.nSamples << endl;
+		f++;
 	}
 
+	VectorProcessNumber = stats->VectorProcessNumber;
+	VectorsIgnored = stats->VectorsIgnored;
+
 	cout << "VectorProcessNumber\t" << VectorProcessNumber << endl;
 	cout << "VectorsIgnored\t\t" << VectorsIgnored << endl;
 
@@ -374,431 +139,206 @@ void Speaker::modifyModel( string dataList, int task, unsigned int flags )
 	Fresult << "VectorProcessNumber\t" << VectorProcessNumber << endl;
 	Fresult << "VectorsIgnored\t\t" << VectorsIgnored << endl;
 	Fresult << "Percent \t\t" << (float) ((float)VectorsIgnored)/ ((float)VectorProcessNumber) * 100.0f << endl;
-	Fresult << endl;
-
-	i = 0;
 
-	while( i < MixtureNumber )
+	if( TopNumber > 0 || Threshold > 0.0 )
 	{
-		(*(*EX)[i]) /= (*N)[i];
-		(*(*EX2)[i]) /= (*N)[i];
-		i++;
+		cout << "DiscardedMass\t\t" << stats->DiscardedMass/(double)VectorProcessNumber << endl;
+		Fresult << "DiscardedMass\t\t" << stats->DiscardedMass/(double)VectorProcessNumber << endl;
 	}
+	Fresult << endl;
 
 	if( task == 1 )
 	{
-		Train();
+		stats->train( *model );
 	}
 	else if( task == 2 )
 	{
-		Adapt( flags );
+		stats->adapt( *model, flags );
 	}
 
-	Flist.close();
-	Flist.clear();
-
-	(*N) = 0.0;
-	i = 0;
-	while( i < MixtureNumber )
-	{
-		(*(*EX)[i]) = 0.0;
-		(*(*EX2)[i]) = 0.0;
-		i++;
-	}
+	stats->reset();
 }
 
 inline void Speaker::ExpectStep( unsigned int VectorNumber )
 {
-	double value = 0.0, enorm = 0.0;
-	int T = 0, i, j;
-	bool overflow;
+	ProfileTimer timer( PHASE_ESTEP );
+	unsigned int T = 0, ignored = SpeakerIgnored;
 
 	while( T < VectorNumber )
 	{
-		i = 0;
-		overflow = false;
-
-		while( i < MixtureNumber )
+		if( !stats->accumulate( *model, &dataParm[(size_t)T*Dimension] ) )
 		{
-			*distance = *((*dataParm)[T]) - *((*means)[i]);
-			*distance = pow( *distance, 2.0 );
-			*distance /= *((*variances)[i]);
-			value = (*distance).sum();
-			value *= -0.5;
+			cout << "Warning: value to small, vector ignored" << endl;
+			SpeakerIgnored++;
+		}
 
-			if( value < -700.0 )
-			{
-				cout << "Warning: value to small " << value << endl;
-				SpeakerIgnored++;
-				overflow = true;
-				VectorsIgnored++;
-				break;
-			}
+		T++;
+	}
 
-			enorm = 1.0;
-			j = 0;
+	profileCount( COUNT_SCORED, VectorNumber - ( SpeakerIgnored - ignored ) );
+	profileCount( COUNT_IGNORED, SpeakerIgnored - ignored );
+	profileWork( PHASE_ESTEP, (unsigned long long)VectorNumber*model->MixtureNumber );
+}
 
-			while( j < Dimension )
-			{
-				enorm *= (*(*variances)[i])[j++];
-			}
+//! Single Gaussian of the training data: global mean and variance.
+//! Global variances are the data variances times the variance flooring constant, as for
+//! VQ codebooks.
 
-			enorm = sqrt( enorm );
-			enorm *= pow( 2.0*M_PI, (double)Dimension / 2.0 );
-			enorm = pow( enorm, -1.0 );
-			(*PR)[i] = exp(value)*enorm*(*weights)[i];
+void Speaker::globalGaussian( string dataList )
+{
+	vector<string> files;
+	vector<double> sum( Dimension ), sum2( Dimension );
+	unsigned long long total = 0;
+	unsigned int f = 0, number, j;
+	size_t i;
 
-			i++;
-		}
+	if( !readList( dataList, files ) )
+	{
+		InClassError( this, "GlobalGaussian(): Cannot open data list file " + dataList,  -700 );
+	}
 
-		if( overflow != true )
+	while( f < files.size() )
+	{
+		if( !Reader.open( files[f] ) )
 		{
-			VectorProcessNumber++;
-			(*PR) /= (*PR).sum();
-			(*N) += (*PR);
+			InClassError( this, "GlobalGaussian(): Cannot open data file " + files[f],  -701 );
+		}
 
+		while( ( number = Reader.read( dataParm, MaxDataNumber, Dimension ) ) > 0 )
+		{
 			i = 0;
-
-			while( i < MixtureNumber )
+			while( i < (size_t)number*Dimension )
 			{
-				(*(*EX)[i]) += (*PR)[i] * (*(*dataParm)[T]);
-				(*(*EX2)[i]) += (*PR)[i] * pow( (*(*dataParm)[T]), 2.0 );
+				sum[i % Dimension] += dataParm[i];
+				sum2[i % Dimension] += dataParm[i]*dataParm[i];
 				i++;
 			}
+			total += number;
 		}
 
-		T++;
+		Reader.close();
+		f++;
 	}
-}
 
-void Speaker::Train()
-{
-	int i = 0, j;
-
-	(*N) /= VectorProcessNumber;
-
-	while( i < MixtureNumber )
+	if( total == 0 )
 	{
-		//(*(*EX2)[i]) -= pow( (*(*means)[i]), 2.0 );
-		(*(*EX2)[i]) -= pow( (*(*EX)[i]), 2.0 );
-		i++;
+		InClassError( this, "GlobalGaussian(): No feature vectors in " + dataList,  -702 );
 	}
 
-	i = 0;
+	model->weights[0] = 1.0;
+	j = 0;
 
-	while( i < MixtureNumber )
+	while( j < Dimension )
 	{
-		j = 0;
-		while( j < Dimension )
+		model->means[j] = sum[j]/(double)total;
+		model->variances[j] = sum2[j]/(double)total - model->means[j]*model->means[j];
+		model->globalvars[j] = model->variances[j]*vFloor;
+
+		if( model->variances[j] < model->globalvars[j] )
 		{
-			if( (*(*EX2)[i])[j] < (*globalvars)[j] )
-			{
-				//cout << (*(*EX2)[i])[j] << " " << i << " " << j << endl;
-				(*(*EX2)[i])[j] = (*globalvars)[j];
-			}
-			j++;
+			model->variances[j] = model->globalvars[j];
 		}
-		i++;
-	}
-
-	(*weights) = (*N);
-	i = 0;
-
-	while( i < MixtureNumber )
-	{
-		(*(*means)[i]) = (*(*EX)[i]);
-		(*(*variances)[i]) = (*(*EX2)[i]);
-		i++;
+		j++;
 	}
 }
 
-void Speaker::Adapt( unsigned int flag )
+//! Grow the model from a single Gaussian by binary splitting (LBG).
+//! Every intermediate model is trained with a number of EM iterations before it is split
+//! again, the model at the full mixture number is left for the caller to train.
+/*!	\param data list.
+	\param EM iterations per intermediate mixture number.
+*/
+
+void Speaker::grow( string dataList, unsigned int iterations )
 {
-	int i;
-	(*DDA) = (*N) / ( (*N) + 16.0 );
-	(*N) /= VectorProcessNumber;
+	Model *target = model, *larger;
+	Stats *targetStats = stats;
+	unsigned int size = 1, cycle;
 
-	if( flag & 2 || flag & 4 )
-	{
-		i = 0;
-		while( i < MixtureNumber )
-		{
-			(*(*CPmeans)[i]) = (*(*means)[i]);
-			(*(*CPvariances)[i]) = (*(*variances)[i]);
-			i++;
-		}
-	}
+	model = new Model( 1, Dimension, vFloor, &Memory );
+	stats = new Stats( 1, Dimension, &Memory );
+	stats->prune( TopNumber, Threshold );
+	globalGaussian( dataList );
 
-	if( flag & 1 )
+	while( model != target )
 	{
-		(*CPweights) = (*weights);
-		(*weights) = (*DDA)*(*N) + ( 1.0 - (*DDA) )*(*CPweights);
-		(*weights) /= (*weights).sum();
-	}
+		// A single Gaussian is already the maximum likelihood estimate
+		cycle = size > 1 ? 0 : iterations;
 
-	if( flag & 2 )
-	{
-		i = 0;
-		while( i < MixtureNumber )
+		// No log-likelihood pass, intermediate models run a fixed number of iterations
+		while( cycle < iterations )
 		{
-			(*(*means)[i]) = (*DDA)[i]*(*(*EX)[i]) + ( 1.0 - (*DDA)[i] ) * (*(*CPmeans)[i]);
-			i++;
+			modifyModel( dataList, 1, 0 );
+			cycle++;
 		}
-	}
 
-	if( flag & 4 )
-	{
-		i = 0;
-		while( i < MixtureNumber )
-		{
-			(*(*variances)[i]) = (*DDA)[i]*(*(*EX2)[i]) + ( 1.0 - (*DDA)[i] ) * ( pow( (*(*CPmeans)[i]), 2.0 ) + (*(*CPvariances)[i]) ) - pow( (*(*means)[i]), 2.0 );
-			i++;
-		}
+		size = 2*size < MixtureNumber ? 2*size : MixtureNumber;
+		larger = size == MixtureNumber ? target : new Model( size, Dimension, vFloor, &Memory );
+
+		int status = larger->split( *model );
 
-		int j;
-		i = 0;
-		while( i < MixtureNumber )
+		if( status != 0 )
 		{
-			j = 0;
-			while( j < Dimension )
-			{
-				if( (*(*variances)[i])[j] < (*globalvars)[j] )
-				{
-					//cout << (*(*EX2)[i])[j] << " " << i << " " << j << endl;
-					(*(*variances)[i])[j] = (*globalvars)[j];
-				}
-				j++;
-			}
-			i++;
+			InClassError( this, larger->Error, status );
 		}
+
+		delete model;
+		delete stats;
+		model = larger;
+		stats = size == MixtureNumber ? targetStats : new Stats( size, Dimension, &Memory );
+		stats->prune( TopNumber, Threshold );
+
+		cout << "Split\t" << size << endl;
+		Fresult << "Split\t" << size << endl;
 	}
 }
 
 double Speaker::LogL( string dataList )
 {
-	Flist.open( dataList.c_str() );
+	vector<string> files;
 
-	if( !Flist )
+	if( !readList( dataList, files ) )
 	{
 		InClassError( this, "LogL(): Cannot open data list file " + dataList,  -600 );
 	}
 
-	string dataFile;
-	float htkData = 0.0f;
-	unsigned int i, j;
+	unsigned int f = 0, number;
 	VectorProcessNumber = 0;
 	VectorsIgnored = 0;
 	LL = 0.0;
 
-	Flist >> dataFile;
-
 	cout << "LogL()" << endl;
-	while( !Flist.eof() )
+	while( f < files.size() )
 	{
-		Fdata.clear();
-		Fdata.open( dataFile.c_str(), ios_base::binary );
-
-		if( !Fdata )
+		if( !Reader.open( files[f] ) )
 		{
-			InClassError( this, "LogL(): Cannot open data file " + dataFile,  -601 );
+			InClassError( this, "LogL(): Cannot open data file " + files[f],  -601 );
 		}
 
-		Fdata.read( reinterpret_cast<char *> ( &Htk ), sizeof( Htk ) );
-
-		unsigned int tmpSamples = Htk.nSamples;
-
-		if( Htk.nSamples > MaxDataNumber )
+		while( ( number = Reader.read( dataParm, MaxDataNumber, Dimension ) ) > 0 )
 		{
-			while( tmpSamples >= MaxDataNumber )
-			{
-
-				i = 0;
-
-				while( i < MaxDataNumber )
-				{
-					j = 0;
-					while( j < Dimension )
-					{
-						Fdata.read(  reinterpret_cast<char *> ( &htkData ), sizeof( float ));
-						(*(*dataParm)[i])[j++] = (double)htkData;
-					}
-					i++;
-				}
-
-				Score( MaxDataNumber );
-
-				tmpSamples -= MaxDataNumber;
-			}
+			blockLogL( *model, dataParm, number, PR, LL, VectorProcessNumber, VectorsIgnored );
 		}
 
-// process rest of samples
-		i = 0;
-
-		while( i < tmpSamples )
-		{
-			j = 0;
-			while( j < Dimension )
-			{
-				Fdata.read(  reinterpret_cast<char *> ( &htkData ), sizeof( float ));
-				(*(*dataParm)[i])[j++] = (double)htkData;
-			}
-			i++;
-		}
-
-		Score( tmpSamples );
-
-		Fdata.close();
-		Flist >> dataFile;
+		Reader.close();
+		f++;
 	}
 
 	Fresult << "LL\t\t" << LL/(double)VectorProcessNumber << endl;
 	Fresult << endl;
 
-	Flist.close();
-	Flist.clear();
-
 	return LL/(double)VectorProcessNumber;
 }
 
-inline void Speaker::Score( unsigned int VectorNumber )
-{
-	double value = 0.0, enorm = 0.0;
-	int T = 0, i, j;
-	bool overflow;
-
-	while( T < VectorNumber )
-	{
-		i = 0;
-		overflow = false;
-
-		while( i < MixtureNumber )
-		{
-			*distance = *((*dataParm)[T]) - *((*means)[i]);
-			*distance = pow( *distance, 2.0 );
-			*distance /= *((*variances)[i]);
-			value = (*distance).sum();
-			value *= -0.5;
-
-			if( value < -700.0 )
-			{
-				overflow = true;
-				VectorsIgnored++;
-				break;
-			}
-
-			enorm = 1.0;
-			j = 0;
-
-			while( j < Dimension )
-			{
-				enorm *= (*(*variances)[i])[j++];
-			}
-
-			enorm = sqrt( enorm );
-			enorm *= pow( 2.0*M_PI, (double)Dimension / 2.0 );
-			enorm = pow( enorm, -1.0 );
-			(*PR)[i] = exp(value)*enorm*(*weights)[i];
-
-			i++;
-		}
-
-		if( overflow != true )
-		{
-			VectorProcessNumber++;
-			LL += log( (*PR).sum() );
-		}
-
-		T++;
-	}
-}
-
 void Speaker::printModel()
 {
-	int i = 0, j = 0;
-
-	cout << "WEIGHTS" << endl;
-	while( i < MixtureNumber )
-	{
-		cout << (*weights)[i++] << " ";
-	}
-	cout << endl;
-
-	i = 0;
-	cout << "MEANS" << endl;
-	while( i < MixtureNumber )
-	{
-		j = 0;
-		cout << i << ": ";
-		while( j < Dimension )
-		{
-			cout << (*(*means)[i])[j++] << " ";
-		}
-		cout << endl;
-		i++;
-	}
-	cout << endl;
-
-	i = 0;
-	cout << "VARS" << endl;
-	while( i < MixtureNumber )
-	{
-		j = 0;
-		cout << i << ": ";
-		while( j < Dimension )
-		{
-			cout << (*(*variances)[i])[j++] << " ";
-		}
-		cout << endl;
-		i++;
-	}
-	cout << endl;
-
-	i = 0;
-	cout << "GLOBAL VARS" << endl;
-	while( i < Dimension )
-	{
-		cout << (*globalvars)[i++] << " ";
-	}
-	cout << endl;
-
-
+	model->printModel();
 }
 
 Speaker::~Speaker()
 {
-	int i = 0;
-
 	Fresult.close();
 
-	while( i < MixtureNumber )
-	{
-		delete (*means)[i];
-		delete (*variances)[i];
-		delete (*CPmeans)[i];
-		delete (*CPvariances)[i];
-		delete (*EX)[i];
-		delete (*EX2)[i++];
-	}
-
-	i = 0;
-
-	while( i < MaxDataNumber )
-	{
-		delete (*dataParm)[i++];
-	}
-
-	delete weights;
-	delete CPweights;
-	delete means;
-	delete variances;
-	delete CPmeans;
-	delete CPvariances;
-	delete globalvars;
-	delete dataParm;
-	delete distance;
-	delete PR;
-	delete N;
-	delete EX;
-	delete EX2;
-	delete DDA;
+	delete model;
+	delete stats;
 }
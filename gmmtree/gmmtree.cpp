@@ -0,0 +1,131 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <getopt.h>
+
+#include "model.h"
+#include "tree.h"
+
+using std::cout;
+using std::endl;
+
+void printUsage( void )
+{
+	cout << "gmmtree: help" << endl;
+	cout << endl;
+	cout << "Builds the Gaussian selection tree of a model (UBM) and writes it as tree-structured" << endl;
+	cout << "VQ codebook, used by gmmscore -G" << endl;
+	cout << endl;
+	cout << "-h,  --help\t\tThis message" << endl;
+	cout << "-i,  --input\t\tModel file" << endl;
+	cout << "-t,  --type\t\tModel file type: 1 = model (default), 2 = VQ codebook" << endl;
+	cout << "-m,  --mixture\t\tMixture number" << endl;
+	cout << "-d,  --dimension\tFeature vector dimension" << endl;
+	cout << "-v,  --vfloor\t\tVariance floor factor (default 0.01)" << endl;
+	cout << "-o,  --output\t\tOutput tree codebook file" << endl;
+
+	exit( -1 );
+}
+
+int main( int argc, char *argv[] )
+{
+	int nextOption;
+
+	const char * shortOptions = "hi:t:m:d:v:o:";
+
+	const struct option longOptions[] = {
+	{ "help", 0, NULL, 'h' },
+	{ "input", 1, NULL, 'i' },
+	{ "type", 1, NULL, 't' },
+	{ "mixture", 1, NULL, 'm' },
+	{ "dimension", 1, NULL, 'd' },
+	{ "vfloor", 1, NULL, 'v' },
+	{ "output", 1, NULL, 'o' },
+	{ NULL, 0, NULL, 0 }
+	};
+
+	string modelFile, treeFile;
+	unsigned int type = MODEL_FILE, mixture = 0, dimension = 0;
+	double vFloor = 0.01;
+
+	do {
+		nextOption = getopt_long( argc, argv, shortOptions, longOptions, NULL );
+
+		switch( nextOption )
+		{
+			case 'i':
+				modelFile = optarg;
+				break;
+
+			case 't':
+				type = atoi( optarg );
+				break;
+
+			case 'm':
+				mixture = atoi( optarg );
+				break;
+
+			case 'd':
+				dimension = atoi( optarg );
+				break;
+
+			case 'v':
+				vFloor = atof( optarg );
+				break;
+
+			case 'o':
+				treeFile = optarg;
+				break;
+
+			case 'h':
+				printUsage();
+
+			case '?':
+				printUsage();
+
+			case -1:
+				break;
+
+			default:
+				abort();
+		}
+
+	} while( nextOption != -1 );
+
+	if( modelFile.empty() || treeFile.empty() || mixture == 0 || dimension == 0 )
+	{
+		cout << "-i, -o, -m or -d not set" << endl;
+		printUsage();
+	}
+
+	if( type != MODEL_FILE && type != MODEL_VQ )
+	{
+		cout << "-t, --type must be 1 (model) or 2 (VQ codebook)" << endl;
+		printUsage();
+	}
+
+	Model model( mixture, dimension, vFloor );
+
+	if( model.load( modelFile, type ) != 0 )
+	{
+		cout << model.Error << endl;
+		return -1;
+	}
+
+	GaussianTree tree;
+
+	if( tree.build( model ) != 0 || tree.save( treeFile ) != 0 )
+	{
+		cout << tree.Error << endl;
+		return -1;
+	}
+
+	cout << "Nodes: " << tree.NodeNumber << endl;
+	cout << "Depth: " << tree.depth() << endl;
+
+	return 0;
+}
@@ -7,12 +7,13 @@
 #include <math.h>
 #include <string.h>
 
-typedef struct {
-	unsigned int	nSamples,	//!< number of samples in ﬁle (4-byte integer)
-			sampPeriod;	//!< sample period in 100ns units (4-byte integer)
-	unsigned short	sampSize,	//!< number of bytes per sample (2-byte integer)
-			parmKind;	//!< a code indicating the sample kind (2-byte integer)
-}HTKHeader;
+#include "gmmapi.h"
+
+// bisecting mode: distance of the two children from the mean of a split node, in standard deviations
+#define TREE_PERTURB 0.2
+
+// bisecting mode: most passes over the data per tree level
+#define TREE_PASSES 20
 
 static float **data;
 static double **old_mean, **new_mean, *sum_num, *score, *global_mean;
@@ -20,19 +21,33 @@ static double **var, *global_var, old_error, new_error;
 static int dims, cluster_size, vector_num;
 static char *data_list, *out_file, *res_file;
 static unsigned int total;
+static int partial;
+static gmm_codebook *codebook;
+static int tree, node_num, first_node, *left, *right;
+static double **node_mean, **node_sum, **node_var, *node_count, *node_error;
 
 void init( void );
 void assign_mean( int );
 void assign_var( int );
-int findmin( double * );
 void cluster( void );
 void alloc_mem( void );
 void free_mem( void );
-void get_data( FILE *, int );
+void get_data( gmm_htk *, int );
 void print( int );
 void output_cluster( void );
 void calculate_var( void );
 void load_parms( char *);
+void open_codebook( void );
+void close_codebook( void );
+int find_nearest( float * );
+void grow_tree( void );
+int split_leaves( int );
+void tree_cluster( int );
+void assign_tree_mean( int );
+void assign_tree_var( int );
+int nearer_child( int, float *, double * );
+void tree_var( void );
+void output_tree( void );
 
 int main( int argc, char *argv[] )
 {
@@ -53,17 +68,25 @@ int main( int argc, char *argv[] )
 	alloc_mem();
 	init();
 
-	do {
-		cluster();
+	if( tree )
+	{
+		grow_tree();
+		output_tree();
+	}
+	else
+	{
+		do {
+			cluster();
 
-		diff = fabs( old_error-new_error );
-		diff /= new_error;
-		old_error = new_error;
-		printf( "Error %f\n", old_error );
+			diff = fabs( old_error-new_error );
+			diff /= new_error;
+			old_error = new_error;
+			printf( "Error %f\n", old_error );
 
-	} while( diff > 0.001 );
+		} while( diff > 0.001 );
 
-	output_cluster();
+		output_cluster();
+	}
 
 	fres = fopen( res_file, "w" );
 
@@ -113,6 +136,8 @@ void load_parms( char *file_name )
 	data_list = malloc( sizeof(char) * 256 );
 	out_file = malloc( sizeof(char) * 256 );
 	res_file = malloc( sizeof(char) * 256 );
+	partial = 0;
+	tree = 0;
 	i = 0;
 
 	fscanf( fin, "%s", string );
@@ -154,6 +179,16 @@ void load_parms( char *file_name )
 			fscanf( fin, "%s", string );
 			strcpy( res_file, string );
 		}
+		else if( strcmp( "PARTIAL", string ) == 0 ) // optional
+		{
+			fscanf( fin, "%s", string );
+			partial = atoi( string );
+		}
+		else if( strcmp( "TREE", string ) == 0 ) // optional
+		{
+			fscanf( fin, "%s", string );
+			tree = atoi( string );
+		}
 
 		fscanf( fin, "%s", string );
 	}
@@ -194,6 +229,27 @@ void alloc_mem( void )
 	global_var = malloc( sizeof( double )*dims );
 	score = malloc( sizeof( double )*cluster_size );
 	sum_num = malloc( sizeof( double )*cluster_size );
+
+	if( tree )
+	{
+		node_num = 2*cluster_size - 1;
+		left = malloc( sizeof( int )*node_num );
+		right = malloc( sizeof( int )*node_num );
+		node_mean = malloc( sizeof( double * )*node_num );
+		node_sum = malloc( sizeof( double * )*node_num );
+		node_var = malloc( sizeof( double * )*node_num );
+		node_count = malloc( sizeof( double )*node_num );
+		node_error = malloc( sizeof( double )*node_num );
+
+		i = 0;
+		while( i < node_num )
+		{
+			node_mean[i] = malloc( sizeof( double )*dims );
+			node_sum[i] = malloc( sizeof( double )*dims );
+			node_var[i] = malloc( sizeof( double )*dims );
+			i++;
+		}
+	}
 }
 
 void free_mem( void )
@@ -224,14 +280,34 @@ void free_mem( void )
 	free( data_list );
 	free( out_file );
 	free( res_file );
+
+	if( tree )
+	{
+		i = 0;
+		while( i < 2*cluster_size - 1 )
+		{
+			free( node_mean[i] );
+			free( node_sum[i] );
+			free( node_var[i] );
+			i++;
+		}
+
+		free( left );
+		free( right );
+		free( node_mean );
+		free( node_sum );
+		free( node_var );
+		free( node_count );
+		free( node_error );
+	}
 }
 
 void init( void )
 {
-	FILE *flist, *fdata;
+	FILE *flist;
+	gmm_htk *fdata;
 	int i, j, k, sum;
 	char string[256];
-	HTKHeader htk;
 	double dev;
 
 //clean out global variables
@@ -254,17 +330,15 @@ void init( void )
 	sum = 0;
 	while( !feof( flist ) )
 	{
-		fdata = fopen( string, "rb" );
+		fdata = gmm_htk_open( string );
 		if( fdata == NULL )
 		{
 			printf( "init(): Cannot open data file %s\n", string );
 			exit(-1);
 		}
 
-		fread( &htk, sizeof( HTKHeader ), 1, fdata );
-
-		i = htk.nSamples;
-		if( htk.nSamples > vector_num )
+		i = gmm_htk_samples( fdata );
+		if( i > vector_num )
 		{
 			while( i >= vector_num )
 			{
@@ -291,7 +365,7 @@ void init( void )
 		}
 		sum += i;
 
-		fclose( fdata );
+		gmm_htk_close( fdata );
 		fscanf( flist, "%s", string );
 	}
 
@@ -304,17 +378,15 @@ void init( void )
 	sum = 0;
 	while( !feof( flist ) )
 	{
-		fdata = fopen( string, "rb" );
+		fdata = gmm_htk_open( string );
 		if( fdata == NULL )
 		{
 			printf( "init(): Cannot open data file %s\n", string );
 			exit(-1);
 		}
 	
-		fread( &htk, sizeof( HTKHeader ), 1, fdata );
-
-		i = htk.nSamples;
-		if( htk.nSamples > vector_num )
+		i = gmm_htk_samples( fdata );
+		if( i > vector_num )
 		{
 			while( i >= vector_num )
 			{
@@ -339,7 +411,7 @@ void init( void )
 		}
 		sum += i;
 
-		fclose( fdata );
+		gmm_htk_close( fdata );
 		fscanf( flist, "%s", string );
 	}
 
@@ -363,13 +435,14 @@ void init( void )
 
 void cluster( void )
 {
-	FILE *flist, *fdata;
+	FILE *flist;
+	gmm_htk *fdata;
 	int i, j;
 	char string[256];
-	HTKHeader htk;
 
 	new_error = 0.0;
 	total = 0;
+	open_codebook();
 
 	for( i = 0; i < cluster_size; i++ )
 	{
@@ -392,17 +465,15 @@ void cluster( void )
 //calculate mean
 	while( !feof( flist ) )
 	{
-		fdata = fopen( string, "rb" );
+		fdata = gmm_htk_open( string );
 		if( fdata == NULL )
 		{
 			printf( "cluster(): Cannot open data file %s\n", string );
 			exit(-1);
 		}
 	
-		fread( &htk, sizeof( HTKHeader ), 1, fdata );
-
-		i = htk.nSamples;
-		if( htk.nSamples > vector_num )
+		i = gmm_htk_samples( fdata );
+		if( i > vector_num )
 		{
 			while( i >= vector_num )
 			{
@@ -417,11 +488,12 @@ void cluster( void )
 		assign_mean( i );
 		total += i;
 
-		fclose( fdata );
+		gmm_htk_close( fdata );
 		fscanf( flist, "%s", string );
 	}
 
 	fclose( flist );
+	close_codebook();
 
 	for( i = 0; i < cluster_size; i++ )
 	{
@@ -442,16 +514,7 @@ void assign_mean( int size )
 
 	for( i = 0; i < size; i++ )
 	{
-		for( j = 0; j < cluster_size; j++ )
-		{
-			score[j] = 0.0;
-			for( k = 0; k < dims; k++ )
-			{
-				score[j] += pow( ( data[i][k] - old_mean[j][k] ), 2.0 );
-			}
-		}
-
-		j = findmin( score );
+		j = find_nearest( data[i] );
 		new_error += score[j]/(double)dims;
 
 		for( k = 0; k < dims; k++ )
@@ -468,16 +531,7 @@ void assign_var( int size )
 
 	for( i = 0; i < size; i++ )
 	{
-		for( j = 0; j < cluster_size; j++ )
-		{
-			score[j] = 0.0;
-			for( k = 0; k < dims; k++ )
-			{
-				score[j] += pow( ( data[i][k] - old_mean[j][k] ), 2.0 );
-			}
-		}
-
-		j = findmin( score );
+		j = find_nearest( data[i] );
 
 		for( k = 0; k < dims; k++ )
 		{
@@ -487,32 +541,47 @@ void assign_var( int size )
 	}
 }
 
-void get_data( FILE *fin, int number )
-{
-	int i;
+// partial distance elimination: the codebook copies old_mean, it is rebuilt every pass
 
-	for( i = 0; i < number; i++ )
+void open_codebook( void )
+{
+	if( partial )
 	{
-		fread( data[i], sizeof( float )*dims, 1, fin );
+		codebook = gmm_codebook_open( (const double *const *)old_mean, cluster_size, dims );
+		if( codebook == NULL )
+		{
+			printf( "open_codebook(): %s, searching all centroids\n", gmm_error() );
+		}
 	}
 }
 
-int findmin( double *data )
+void close_codebook( void )
 {
-	int i, j;
-	double var = data[0];
-	j = 0;
+	if( codebook != NULL )
+	{
+		gmm_codebook_close( codebook );
+		codebook = NULL;
+	}
+}
 
-	for( i = 1; i < cluster_size; i++ )
+int find_nearest( float *x )
+{
+	if( codebook != NULL )
 	{
-		if( data[i] < var )
-		{
-			var = data[i];
-			j = i;
-		}
+		return gmm_codebook_nearest( codebook, x, score );
 	}
 
-	return j;
+	return gmm_nearest( (const double *const *)old_mean, cluster_size, dims, x, score );
+}
+
+void get_data( gmm_htk *fin, int number )
+{
+	int i;
+
+	for( i = 0; i < number; i++ )
+	{
+		gmm_htk_read( fin, data[i], 1, dims );
+	}
 }
 
 void print( int flag )
@@ -630,10 +699,10 @@ void output_cluster( void )
 
 void calculate_var( void )
 {
-	FILE *flist, *fdata;
+	FILE *flist;
+	gmm_htk *fdata;
 	int i, j;
 	char string[256];
-	HTKHeader htk;
 
 	for( i = 0; i < cluster_size; i++ )
 	{
@@ -650,23 +719,22 @@ void calculate_var( void )
 		printf( "calculate_var(): Cannot open datalist file %s\n", string );
 		exit(-1);
 	}
+	open_codebook();
 
 	fscanf( flist, "%s", string );
 
 //calculate var
 	while( !feof( flist ) )
 	{
-		fdata = fopen( string, "rb" );
+		fdata = gmm_htk_open( string );
 		if( fdata == NULL )
 		{
 			printf( "calculate_var(): Cannot open data file %s\n", string );
 			exit(-1);
 		}
 	
-		fread( &htk, sizeof( HTKHeader ), 1, fdata );
-
-		i = htk.nSamples;
-		if( htk.nSamples > vector_num )
+		i = gmm_htk_samples( fdata );
+		if( i > vector_num )
 		{
 			while( i >= vector_num )
 			{
@@ -679,11 +747,12 @@ void calculate_var( void )
 		get_data( fdata, i );
 		assign_var( i );
 
-		fclose( fdata );
+		gmm_htk_close( fdata );
 		fscanf( flist, "%s", string );
 	}
 
 	fclose( flist );
+	close_codebook();
 
 	for( i = 0; i < cluster_size; i++ )
 	{
@@ -696,3 +765,432 @@ void calculate_var( void )
 		}
 	}
 }
+
+// Bisecting mode: the clusters are the leaves of a binary tree grown level by level.
+// Every level splits the leaves with the largest error in two (mean -/+ TREE_PERTURB
+// standard deviations) and runs 2-means on the new children until the error settles.
+// A feature vector reaches its leaf by descending to the nearer child of every node, so a
+// pass costs two distances per tree level instead of one per cluster. Nodes are numbered
+// in creation order, the root is node 0 and 0 also means no child.
+
+void grow_tree( void )
+{
+	double diff;
+	int leaves, first, passes, j;
+
+	node_num = 1;
+	left[0] = 0;
+	right[0] = 0;
+	node_error[0] = 0.0;
+
+	for( j = 0; j < dims; j++ )
+	{
+		node_mean[0][j] = global_mean[j];
+		node_var[0][j] = global_var[j];
+	}
+
+	leaves = 1;
+	while( leaves < cluster_size )
+	{
+		first = node_num;
+		leaves += split_leaves( cluster_size - leaves );
+
+		old_error = 0.0;
+		passes = 0;
+
+		do {
+			tree_cluster( first );
+
+			diff = fabs( old_error-new_error );
+			diff /= new_error;
+			old_error = new_error;
+			passes++;
+
+		} while( diff > 0.001 && passes < TREE_PASSES );
+
+		printf( "Clusters %d Error %f\n", leaves, old_error );
+	}
+
+	tree_var();
+}
+
+static int compare_error( const void *a, const void *b )
+{
+	int x = *(const int *)a, y = *(const int *)b;
+
+	if( node_error[x] != node_error[y] )
+	{
+		return node_error[x] > node_error[y] ? -1 : 1;
+	}
+
+	return x - y;
+}
+
+// split at most 'most' leaves, largest error first; returns the number of leaves split
+
+int split_leaves( int most )
+{
+	int *order, count, n, i, j, c;
+	double dev;
+
+	order = malloc( sizeof( int )*node_num );
+	count = 0;
+
+	for( n = 0; n < node_num; n++ )
+	{
+		if( left[n] == 0 )
+		{
+			order[count++] = n;
+		}
+	}
+
+	qsort( order, count, sizeof( int ), compare_error );
+
+	if( count > most )
+	{
+		count = most;
+	}
+
+	for( i = 0; i < count; i++ )
+	{
+		n = order[i];
+		c = node_num;
+		left[n] = c;
+		right[n] = c + 1;
+
+		for( j = 0; j < dims; j++ )
+		{
+			dev = TREE_PERTURB*sqrt( node_var[n][j] );
+			node_mean[c][j] = node_mean[n][j] - dev;
+			node_mean[c + 1][j] = node_mean[n][j] + dev;
+			node_var[c][j] = node_var[n][j];
+			node_var[c + 1][j] = node_var[n][j];
+		}
+
+		left[c] = right[c] = 0;
+		left[c + 1] = right[c + 1] = 0;
+		node_error[c] = node_error[c + 1] = 0.0;
+		node_num += 2;
+	}
+
+	free( order );
+
+	return count;
+}
+
+// one 2-means pass, only the nodes from 'first' on (the new children) move
+
+void tree_cluster( int first )
+{
+	FILE *flist;
+	gmm_htk *fdata;
+	int i, j;
+	char string[256];
+	double value;
+
+	new_error = 0.0;
+	total = 0;
+	first_node = first;
+
+	for( i = 0; i < node_num; i++ )
+	{
+		for( j = 0; j < dims; j++ )
+		{
+			node_sum[i][j] = 0.0;
+		}
+		node_count[i] = 0.0;
+		node_error[i] = 0.0;
+	}
+
+	for( i = first; i < node_num; i++ )
+	{
+		for( j = 0; j < dims; j++ )
+		{
+			node_var[i][j] = 0.0;
+		}
+	}
+
+	flist = fopen( data_list, "r" );
+	if( flist == NULL )
+	{
+		printf( "tree_cluster(): Cannot open datalist file %s\n", data_list );
+		exit(-1);
+	}
+
+	fscanf( flist, "%s", string );
+
+	while( !feof( flist ) )
+	{
+		fdata = gmm_htk_open( string );
+		if( fdata == NULL )
+		{
+			printf( "tree_cluster(): Cannot open data file %s\n", string );
+			exit(-1);
+		}
+
+		i = gmm_htk_samples( fdata );
+		if( i > vector_num )
+		{
+			while( i >= vector_num )
+			{
+				get_data( fdata, vector_num );
+				assign_tree_mean( vector_num );
+				i -= vector_num;
+				total += vector_num;
+			}
+		}
+
+		get_data( fdata, i );
+		assign_tree_mean( i );
+		total += i;
+
+		gmm_htk_close( fdata );
+		fscanf( flist, "%s", string );
+	}
+
+	fclose( flist );
+
+	for( i = first; i < node_num; i++ )
+	{
+		if( node_count[i] != 0.0 )
+		{
+			for( j = 0; j < dims; j++ )
+			{
+				node_mean[i][j] = node_sum[i][j] / node_count[i];
+				value = node_var[i][j] / node_count[i] - node_mean[i][j]*node_mean[i][j];
+				node_var[i][j] = value > 0.0 ? value : 0.0;
+			}
+		}
+	}
+
+	// empty children keep their mean and the variance of their parent
+	for( i = 0; i < first; i++ )
+	{
+		if( left[i] >= first )
+		{
+			for( j = 0; j < dims; j++ )
+			{
+				if( node_count[left[i]] == 0.0 )
+				{
+					node_var[left[i]][j] = node_var[i][j];
+				}
+				if( node_count[right[i]] == 0.0 )
+				{
+					node_var[right[i]][j] = node_var[i][j];
+				}
+			}
+		}
+	}
+	new_error /= (double)total;
+}
+
+// distance of a feature vector to the nearer child of an internal node
+
+int nearer_child( int n, float *x, double *distance )
+{
+	double diff, dl, dr;
+	int j;
+
+	dl = 0.0;
+	dr = 0.0;
+
+	for( j = 0; j < dims; j++ )
+	{
+		diff = x[j] - node_mean[left[n]][j];
+		dl += diff*diff;
+		diff = x[j] - node_mean[right[n]][j];
+		dr += diff*diff;
+	}
+
+	*distance = dr < dl ? dr : dl;
+
+	return dr < dl ? right[n] : left[n];
+}
+
+void assign_tree_mean( int size )
+{
+	int i, j, k;
+	double distance;
+
+	for( i = 0; i < size; i++ )
+	{
+		j = 0;
+		distance = 0.0;
+
+		while( left[j] != 0 )
+		{
+			j = nearer_child( j, data[i], &distance );
+		}
+
+		node_error[j] += distance;
+		new_error += distance/(double)dims;
+
+		for( k = 0; k < dims; k++ )
+		{
+			node_sum[j][k] += data[i][k];
+		}
+
+		// squares only for the new children, the other leaves keep their variance
+		if( j >= first_node )
+		{
+			for( k = 0; k < dims; k++ )
+			{
+				node_var[j][k] += data[i][k]*data[i][k];
+			}
+		}
+		node_count[j]++;
+	}
+}
+
+// variances of every node around its mean, as calculate_var() does for the flat codebook
+
+void tree_var( void )
+{
+	FILE *flist;
+	gmm_htk *fdata;
+	int i, j, k;
+	char string[256];
+
+	for( i = 0; i < node_num; i++ )
+	{
+		for( j = 0; j < dims; j++ )
+		{
+			node_var[i][j] = global_var[j];
+		}
+		node_count[i] = 0.0;
+	}
+
+	flist = fopen( data_list, "r" );
+	if( flist == NULL )
+	{
+		printf( "tree_var(): Cannot open datalist file %s\n", data_list );
+		exit(-1);
+	}
+
+	fscanf( flist, "%s", string );
+
+	while( !feof( flist ) )
+	{
+		fdata = gmm_htk_open( string );
+		if( fdata == NULL )
+		{
+			printf( "tree_var(): Cannot open data file %s\n", string );
+			exit(-1);
+		}
+
+		i = gmm_htk_samples( fdata );
+		if( i > vector_num )
+		{
+			while( i >= vector_num )
+			{
+				get_data( fdata, vector_num );
+				assign_tree_var( vector_num );
+				i -= vector_num;
+			}
+		}
+
+		get_data( fdata, i );
+		assign_tree_var( i );
+
+		gmm_htk_close( fdata );
+		fscanf( flist, "%s", string );
+	}
+
+	fclose( flist );
+
+	k = 0;
+	for( i = 0; i < node_num; i++ )
+	{
+		if( node_count[i] != 0.0 )
+		{
+			for( j = 0; j < dims; j++ )
+			{
+				node_var[i][j] /= node_count[i];
+			}
+		}
+
+		// leaves are the clusters of the RESULT file
+		if( left[i] == 0 )
+		{
+			sum_num[k++] = node_count[i];
+		}
+	}
+}
+
+void assign_tree_var( int size )
+{
+	int i, j, k;
+	double distance;
+
+	for( i = 0; i < size; i++ )
+	{
+		j = 0;
+
+		while( 1 )
+		{
+			for( k = 0; k < dims; k++ )
+			{
+				node_var[j][k] += pow( node_mean[j][k] - data[i][k], 2.0 );
+			}
+			node_count[j]++;
+
+			if( left[j] == 0 )
+			{
+				break;
+			}
+			j = nearer_child( j, data[i], &distance );
+		}
+	}
+}
+
+// tree-structured codebook (type 1): leaves carry the cluster number, internal nodes 0
+
+void output_tree( void )
+{
+	FILE *fout;
+	int i, j, k;
+
+	fout = fopen( out_file, "w" );
+
+	if( fout == NULL )
+	{
+		printf( "Output_tree(): Cannot open file %s\n", out_file );
+		exit(-1);
+	}
+
+	fprintf( fout, "Global mean:\n\n" );
+
+	for( j = 0; j < dims; j++ )
+	{
+		fprintf( fout, "%f\t", global_mean[j] );
+	}
+
+	fprintf( fout, "\nGlobal variance:\n" );
+
+	for( j = 0; j < dims; j++ )
+	{
+		fprintf( fout, "%f\t", global_var[j] );
+	}
+
+	fprintf( fout, "\n262 1 1 %d 1 %d\n", node_num, dims );
+
+	k = 0;
+	for( i = 0; i < node_num; i++ )
+	{
+		fprintf( fout, "1 %d %d %d %d\n", left[i] == 0 ? ++k : 0, i+1, left[i] == 0 ? 0 : left[i]+1, left[i] == 0 ? 0 : right[i]+1 );
+
+		for( j = 0; j < dims; j++ )
+		{
+			fprintf( fout, "%f ", node_mean[i][j] );
+		}
+		fprintf( fout, "\n" );
+
+		for( j = 0; j < dims; j++ )
+		{
+			fprintf( fout, "%f ", node_var[i][j] );
+		}
+		fprintf( fout, "\n\n" );
+	}
+
+	fclose( fout );
+}
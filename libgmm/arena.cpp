@@ -0,0 +1,124 @@
+#include "arena.h"
+
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+Arena::Arena()
+{
+	Base = NULL;
+	Size = 0;
+	Used = 0;
+	ReservedSize = 0;
+}
+
+//! Add a new region. Regions of at least one huge page are huge page aligned anonymous
+//! mappings advised to use huge pages, smaller ones come from the heap.
+/*!	\param minimum region size.
+	\return false if there is no memory.
+*/
+
+bool Arena::map( size_t size )
+{
+	void *start;
+
+	if( size < ARENA_HUGE_PAGE )
+	{
+		size = ( size + ARENA_ALIGN - 1 ) & ~(size_t)( ARENA_ALIGN - 1 );
+
+		if( posix_memalign( &start, ARENA_ALIGN, size ) != 0 )
+		{
+			return false;
+		}
+		memset( start, 0, size );
+	}
+	else
+	{
+		char *block;
+
+		size = ( size + ARENA_HUGE_PAGE - 1 ) & ~( ARENA_HUGE_PAGE - 1 );
+
+		// Over-map by one huge page and trim, mmap only guarantees page alignment
+		block = static_cast< char * >( mmap( NULL, size + ARENA_HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 ) );
+
+		if( block == MAP_FAILED )
+		{
+			return false;
+		}
+
+		start = reinterpret_cast< void * >( ( reinterpret_cast< size_t >( block ) + ARENA_HUGE_PAGE - 1 ) & ~( ARENA_HUGE_PAGE - 1 ) );
+
+		if( static_cast< char * >( start ) > block )
+		{
+			munmap( block, static_cast< char * >( start ) - block );
+		}
+		munmap( static_cast< char * >( start ) + size, block + ARENA_HUGE_PAGE - static_cast< char * >( start ) );
+
+#ifdef MADV_HUGEPAGE
+		madvise( start, size, MADV_HUGEPAGE );
+#endif
+	}
+
+	Regions.push_back( std::make_pair( start, size ) );
+	ReservedSize += size;
+	Base = static_cast< char * >( start );
+	Size = size;
+	Used = 0;
+
+	return true;
+}
+
+//! Make sure the following allocations up to a number of bytes come from one region.
+/*!	\param bytes, see arenaSize().
+*/
+
+void Arena::reserve( size_t bytes )
+{
+	if( Size - Used < bytes && !map( bytes ) )
+	{
+		throw std::bad_alloc();
+	}
+}
+
+//! Zeroed, cache line aligned buffer.
+/*!	\param bytes.
+	\return buffer, valid until the arena is destroyed.
+*/
+
+void *Arena::allocate( size_t bytes )
+{
+	void *buffer;
+
+	bytes = ( bytes + ARENA_ALIGN - 1 ) & ~(size_t)( ARENA_ALIGN - 1 );
+
+	// Regions grow geometrically so many small buffers end up in a few regions
+	if( Size - Used < bytes && !map( bytes > 2*Size ? bytes : 2*Size ) )
+	{
+		throw std::bad_alloc();
+	}
+
+	buffer = Base + Used;
+	Used += bytes;
+
+	return buffer;
+}
+
+Arena::~Arena()
+{
+	unsigned int i = 0;
+
+	while( i < Regions.size() )
+	{
+		if( Regions[i].second < ARENA_HUGE_PAGE )
+		{
+			free( Regions[i].first );
+		}
+		else
+		{
+			munmap( Regions[i].first, Regions[i].second );
+		}
+		i++;
+	}
+}
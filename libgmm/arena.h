@@ -0,0 +1,66 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+//! Alignment of every arena buffer (one cache line).
+
+#define ARENA_ALIGN 64
+
+//! Huge page size. Regions of at least this size are huge page aligned mappings advised to
+//! use huge pages, smaller ones come from the heap.
+
+#define ARENA_HUGE_PAGE ( (size_t)2 << 20 )
+
+//! Region allocator for model, statistics and frame buffers.
+//! Buffers are carved one after the other from a few regions, every buffer is zeroed and
+//! cache line aligned. Buffers are never freed one by one, all regions are released when
+//! the arena is destroyed.
+
+class Arena {
+	public:
+		Arena();
+
+		void reserve( size_t );
+		void *allocate( size_t );
+
+		double *doubles( size_t number ) { return static_cast< double * >( allocate( number*sizeof( double ) ) ); }	//!< Buffer of doubles.
+
+		size_t Reserved() { return ReservedSize; }	//!< Bytes held by all regions.
+
+		~Arena();
+
+	private:
+
+		Arena( const Arena & );		// not copyable
+		Arena &operator=( const Arena & );
+
+		bool map( size_t );
+
+		char *Base;		//!< Current region.
+		size_t Size;		//!< Size of the current region.
+		size_t Used;		//!< Bytes handed out from the current region.
+		size_t ReservedSize;	//!< Bytes held by all regions.
+
+		vector< std::pair< void *, size_t > > Regions;	//!< Regions (address, size).
+};
+
+//! Bytes an arena buffer takes, including alignment.
+/*!	\param number of elements.
+	\param element size.
+	\return bytes.
+*/
+
+inline size_t arenaSize( size_t number, size_t size =sizeof( double ) )
+{
+	return ( number*size + ARENA_ALIGN - 1 ) & ~(size_t)( ARENA_ALIGN - 1 );
+}
+
+#endif
@@ -0,0 +1,175 @@
+#include "gmmapi.h"
+#include "model.h"
+#include "htk.h"
+#include "score.h"
+#include "partial.h"
+
+#include <new>
+
+struct gmm_model {
+	Arena memory;		//!< Model parameters and scratch space.
+	Model *model;
+	double *PR;		//!< Mixture scratch space.
+	double *frame;		//!< Feature vector scratch space.
+};
+
+struct gmm_htk {
+	HTKReader reader;
+};
+
+struct gmm_codebook {
+	gmm_codebook( const double *const *centroids, unsigned int number, unsigned int dims ) : codebook( centroids, number, dims ) {}
+
+	PartialCodebook codebook;
+};
+
+static thread_local string LastError;
+
+//! Error code of a failed allocation; std::bad_alloc must not leave the C interface.
+
+#define GMMAPI_NO_MEMORY -1300
+
+gmm_model *gmm_model_open( const char *file, unsigned int type, unsigned int mixtures, unsigned int dimension, double vfloor, const char *base, int shared, int *status )
+{
+	gmm_model *handle = NULL;
+	int code;
+
+	try
+	{
+		handle = new gmm_model;
+		handle->model = NULL;
+		handle->memory.reserve( arenaSize( parameterNumber( mixtures, dimension ) ) + arenaSize( mixtures ) + arenaSize( dimension ) );
+		handle->model = new Model( mixtures, dimension, vfloor, &handle->memory );
+		handle->PR = handle->memory.doubles( mixtures );
+		handle->frame = handle->memory.doubles( dimension );
+
+		code = handle->model->load( file, type, base != NULL ? base : "", shared != 0 );
+	}
+	catch( const std::bad_alloc & )
+	{
+		LastError = "gmm_model_open(): Out of memory";
+		code = GMMAPI_NO_MEMORY;
+	}
+
+	if( status != NULL )
+	{
+		*status = code;
+	}
+
+	if( code != 0 )
+	{
+		if( code != GMMAPI_NO_MEMORY )
+		{
+			LastError = handle->model->Error;
+		}
+		gmm_model_close( handle );
+		return NULL;
+	}
+
+	return handle;
+}
+
+void gmm_model_close( gmm_model *handle )
+{
+	if( handle != NULL )
+	{
+		delete handle->model;
+		delete handle;
+	}
+}
+
+unsigned int gmm_model_mixtures( const gmm_model *handle )
+{
+	return handle->model->MixtureNumber;
+}
+
+unsigned int gmm_model_dimension( const gmm_model *handle )
+{
+	return handle->model->Dimension;
+}
+
+int gmm_model_frame_logl( gmm_model *handle, const double *x, double *value )
+{
+	return frameLogL( *handle->model, x, handle->PR, *value ) ? 1 : 0;
+}
+
+double gmm_model_logl( gmm_model *handle, const float *frames, unsigned int number, unsigned int *ignored )
+{
+	unsigned int count = 0;
+	double LL = averageLogL( *handle->model, frames, number, handle->frame, handle->PR, count );
+
+	if( ignored != NULL )
+	{
+		*ignored = count;
+	}
+
+	return LL;
+}
+
+gmm_htk *gmm_htk_open( const char *file )
+{
+	gmm_htk *handle = new (std::nothrow) gmm_htk;
+
+	if( handle == NULL )
+	{
+		LastError = "gmm_htk_open(): Out of memory";
+		return NULL;
+	}
+
+	if( !handle->reader.open( file ) )
+	{
+		LastError = string( "Cannot open data file " ) + file;
+		delete handle;
+		return NULL;
+	}
+
+	return handle;
+}
+
+void gmm_htk_close( gmm_htk *handle )
+{
+	delete handle;
+}
+
+unsigned int gmm_htk_samples( const gmm_htk *handle )
+{
+	return handle->reader.Htk.nSamples;
+}
+
+unsigned int gmm_htk_read( gmm_htk *handle, float *frames, unsigned int number, unsigned int dimension )
+{
+	return handle->reader.read( frames, number, dimension );
+}
+
+unsigned int gmm_nearest( const double *const *centroids, unsigned int number, unsigned int dims, const float *x, double *score )
+{
+	return nearest( centroids, number, dims, x, score );
+}
+
+gmm_codebook *gmm_codebook_open( const double *const *centroids, unsigned int number, unsigned int dims )
+{
+	try
+	{
+		return new gmm_codebook( centroids, number, dims );
+	}
+	catch( const std::bad_alloc & )
+	{
+		LastError = "gmm_codebook_open(): Out of memory";
+		return NULL;
+	}
+}
+
+void gmm_codebook_close( gmm_codebook *handle )
+{
+	delete handle;
+}
+
+unsigned int gmm_codebook_nearest( gmm_codebook *handle, const float *x, double *score )
+{
+	return handle->codebook.nearest( x, score );
+}
+
+const char *gmm_error( void )
+{
+	return LastError.c_str();
+}
@@ -0,0 +1,95 @@
+#ifndef GMMAPI_H
+#define GMMAPI_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+/* C interface to libgmm.
+ * Functions that can fail return 0 (or a handle) on success and a negative error code
+ * (or NULL) on failure, gmm_error() then describes the last failure of the calling thread.
+ * Running out of memory is such a failure (error code -1300), no C++ exception escapes.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct gmm_model gmm_model;	/*!< GMM handle. */
+typedef struct gmm_htk gmm_htk;		/*!< HTK feature file reader handle. */
+typedef struct gmm_codebook gmm_codebook;	/*!< Partial distance nearest centroid search handle. */
+
+/*! Load a model.
+	\param model file name.
+	\param model file type 1 = model, 2 = VQ codebook, 3 = delta model.
+	\param mixture number.
+	\param feature vector dimension.
+	\param variance flooring constant.
+	\param base model file for delta models, otherwise NULL.
+	\param non-zero to share the model through POSIX shared memory.
+	\param error code, may be NULL.
+	\return model handle or NULL.
+*/
+gmm_model *gmm_model_open( const char *, unsigned int, unsigned int, unsigned int, double, const char *, int, int * );
+void gmm_model_close( gmm_model * );
+
+unsigned int gmm_model_mixtures( const gmm_model * );
+unsigned int gmm_model_dimension( const gmm_model * );
+
+/*! Log-likelihood of one feature vector.
+	\return 1 if scored, 0 if the vector underflows and has to be ignored.
+*/
+int gmm_model_frame_logl( gmm_model *, const double *, double * );
+
+/*! Average log-likelihood of feature vectors held in memory.
+	\param model handle.
+	\param feature vectors, one after the other.
+	\param number of feature vectors.
+	\param number of ignored feature vectors, may be NULL.
+*/
+double gmm_model_logl( gmm_model *, const float *, unsigned int, unsigned int * );
+
+/*! Open a HTK feature file.
+	\return reader handle or NULL.
+*/
+gmm_htk *gmm_htk_open( const char * );
+void gmm_htk_close( gmm_htk * );
+
+unsigned int gmm_htk_samples( const gmm_htk * );
+unsigned int gmm_htk_read( gmm_htk *, float *, unsigned int, unsigned int );
+
+/*! Nearest centroid (squared euclidean distance).
+	\param centroids.
+	\param number of centroids.
+	\param feature vector dimension.
+	\param feature vector.
+	\param distance to every centroid.
+	\return index of the first nearest centroid.
+*/
+unsigned int gmm_nearest( const double *const *, unsigned int, unsigned int, const float *, double * );
+
+/*! Copy centroids for nearest centroid search with partial distance elimination.
+	Same results as gmm_nearest(), the codebook has to be reopened when the centroids move.
+	\param centroids.
+	\param number of centroids.
+	\param feature vector dimension.
+	\return codebook handle or NULL.
+*/
+gmm_codebook *gmm_codebook_open( const double *const *, unsigned int, unsigned int );
+void gmm_codebook_close( gmm_codebook * );
+
+/*! Nearest centroid (squared euclidean distance), see gmm_nearest().
+	\param codebook handle.
+	\param feature vector.
+	\param distance to every centroid, a lower bound for centroids abandoned early.
+	\return index of the first nearest centroid.
+*/
+unsigned int gmm_codebook_nearest( gmm_codebook *, const float *, double * );
+
+const char *gmm_error( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,183 @@
+#include "htk.h"
+#include "profile.h"
+
+#include <fstream>
+#include <cstring>
+
+HTKReader::HTKReader()
+{
+	Fdata = NULL;
+	RemainingNumber = 0;
+}
+
+//! Open a feature file and read its header.
+/*!	\param file name.
+	\return false if the file cannot be opened or has no header.
+*/
+
+bool HTKReader::open( string dataFile )
+{
+	close();
+
+	{
+		ProfileTimer timer( PHASE_OPEN );
+		Fdata = fopen( dataFile.c_str(), "rb" );
+	}
+
+	if( Fdata == NULL )
+	{
+		return false;
+	}
+
+	ProfileTimer timer( PHASE_HEADER );
+
+	if( fread( &Htk, sizeof( HTKHeader ), 1, Fdata ) != 1 )
+	{
+		close();
+		return false;
+	}
+
+	RemainingNumber = Htk.nSamples;
+	profileCount( COUNT_FILES, 1 );
+
+	return true;
+}
+
+//! Read feature vectors in file precision.
+/*!	\param feature vector buffer.
+	\param maximum number of feature vectors.
+	\param feature vector dimension.
+	\return number of feature vectors read.
+*/
+
+unsigned int HTKReader::read( float *frames, unsigned int number, unsigned int dimension )
+{
+	ProfileTimer timer( PHASE_DECODE );
+
+	return fill( frames, number, dimension );
+}
+
+//! Read feature vectors from the file.
+/*!	\param feature vector buffer.
+	\param maximum number of feature vectors.
+	\param feature vector dimension.
+	\return number of feature vectors read.
+*/
+
+unsigned int HTKReader::fill( float *frames, unsigned int number, unsigned int dimension )
+{
+	if( Fdata == NULL )
+	{
+		return 0;
+	}
+
+	if( number > RemainingNumber )
+	{
+		number = RemainingNumber;
+	}
+
+	number = fread( frames, sizeof( float )*dimension, number, Fdata );
+	RemainingNumber -= number;
+
+	profileCount( COUNT_FRAMES, number );
+	profileCount( COUNT_BYTES, (unsigned long long)number*dimension*sizeof( float ) );
+
+	return number;
+}
+
+//! Read feature vectors converted to double precision.
+/*!	\param feature vector buffer.
+	\param maximum number of feature vectors.
+	\param feature vector dimension.
+	\return number of feature vectors read.
+*/
+
+unsigned int HTKReader::read( double *frames, unsigned int number, unsigned int dimension )
+{
+	if( number == 0 )
+	{
+		return 0;
+	}
+
+	ProfileTimer timer( PHASE_DECODE );
+
+	// The samples are read into the upper half of the buffer and widened in place, front to
+	// back: a double never overwrites a sample that has not been converted yet
+	float *samples = reinterpret_cast< float * >( frames ) + (size_t)number*dimension;
+	float sample;
+
+	number = fill( samples, number, dimension );
+
+	size_t i = 0;
+
+	while( i < (size_t)number*dimension )
+	{
+		memcpy( &sample, samples + i, sizeof( float ) );
+		frames[i] = (double)sample;
+		i++;
+	}
+
+	return number;
+}
+
+void HTKReader::close()
+{
+	if( Fdata != NULL )
+	{
+		fclose( Fdata );
+		Fdata = NULL;
+	}
+	RemainingNumber = 0;
+}
+
+HTKReader::~HTKReader()
+{
+	close();
+}
+
+bool readList( string dataList, vector<string> &files )
+{
+	std::ifstream Flist( dataList.c_str() );
+
+	if( !Flist )
+	{
+		return false;
+	}
+
+	string dataFile;
+
+	files.clear();
+	Flist >> dataFile;
+
+	while( !Flist.eof() )
+	{
+		files.push_back( dataFile );
+		Flist >> dataFile;
+	}
+
+	return true;
+}
+
+unsigned long long listFrames( string dataList )
+{
+	vector<string> files;
+	HTKReader reader;
+	unsigned long long frames = 0;
+	unsigned int i = 0;
+
+	if( !readList( dataList, files ) )
+	{
+		return 0;
+	}
+
+	while( i < files.size() )
+	{
+		if( reader.open( files[i] ) )
+		{
+			frames += reader.Remaining();
+		}
+		i++;
+	}
+
+	return frames;
+}
@@ -0,0 +1,66 @@
+#ifndef HTK_H
+#define HTK_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+//! HTK Binary File header.
+//! This is defined in the HTKBook.
+
+typedef struct {
+	unsigned int	nSamples,	//!< number of samples in ﬁle (4-byte integer)
+			sampPeriod;	//!< sample period in 100ns units (4-byte integer)
+	unsigned short	sampSize,	//!< number of bytes per sample (2-byte integer)
+			parmKind;	//!< a code indicating the sample kind (2-byte integer)
+}HTKHeader;
+
+//! HTK feature file reader.
+//! Reads the header on open and then hands out feature vectors block by block.
+
+class HTKReader {
+	public:
+		HTKReader();
+
+		bool open( string );
+		unsigned int read( float *, unsigned int, unsigned int );
+		unsigned int read( double *, unsigned int, unsigned int );
+		void close();
+
+		unsigned int Remaining() { return RemainingNumber; }	//!< The number of feature vectors not read yet.
+
+		~HTKReader();
+
+		HTKHeader Htk;		//!< Header of the open file.
+
+	private:
+
+		unsigned int fill( float *, unsigned int, unsigned int );
+
+		FILE *Fdata;		//!< Data file handle.
+		unsigned int RemainingNumber;
+};
+
+//! Read the file names of a data list.
+/*!	\param data list file.
+	\param file names.
+	\return false if the list cannot be opened.
+*/
+
+bool readList( string, vector<string> & );
+
+//! Number of feature vectors of the files in a data list, from the file headers.
+/*!	\param data list file.
+	\return feature vectors, 0 if the list cannot be opened.
+*/
+
+unsigned long long listFrames( string );
+
+#endif
@@ -0,0 +1,423 @@
+#include "kernels.h"
+#include "score.h"
+
+//! Generic kernels, dimension taken from the model at run time.
+
+static bool frameGeneric( const Model &model, const double *x, double *PR, double &value )
+{
+	const unsigned int MixtureNumber = model.MixtureNumber, Dimension = model.Dimension;
+	double enorm = 0.0, diff, sum;
+	unsigned int i = 0, j;
+	const double *mean, *var;
+
+	while( i < MixtureNumber )
+	{
+		mean = model.means + i*Dimension;
+		var = model.variances + i*Dimension;
+		value = 0.0;
+		j = 0;
+
+		while( j < Dimension )
+		{
+			diff = x[j] - mean[j];
+			value += diff*diff / var[j];
+			j++;
+		}
+		value *= -0.5;
+
+		if( value < SCORE_UNDERFLOW )
+		{
+			return false;
+		}
+
+		enorm = 1.0;
+		j = 0;
+
+		while( j < Dimension )
+		{
+			enorm *= var[j++];
+		}
+
+		enorm = sqrt( enorm );
+		enorm *= pow( 2.0*M_PI, (double)Dimension / 2.0 );
+		enorm = pow( enorm, -1.0 );
+		PR[i] = exp(value)*enorm*model.weights[i];
+
+		i++;
+	}
+
+	sum = 0.0;
+	i = 0;
+
+	while( i < MixtureNumber )
+	{
+		sum += PR[i++];
+	}
+
+	value = log( sum );
+
+	return true;
+}
+
+static unsigned int blockGeneric( const Model &model, const double *frames, unsigned int number, double *PR, double &LL )
+{
+	unsigned int T = 0, scored = 0;
+	double value;
+
+	while( T < number )
+	{
+		if( frameGeneric( model, frames + (size_t)T*model.Dimension, PR, value ) )
+		{
+			scored++;
+			LL += value;
+		}
+		T++;
+	}
+
+	return scored;
+}
+
+static void momentsGeneric( unsigned int MixtureNumber, unsigned int Dimension, double sum, double *PR, double *N, const double *x, double *EX, double *EX2 )
+{
+	unsigned int i = 0, j;
+	double *ex, *ex2;
+
+	while( i < MixtureNumber )
+	{
+		PR[i] /= sum;
+		N[i] += PR[i];
+
+		ex = EX + i*Dimension;
+		ex2 = EX2 + i*Dimension;
+		j = 0;
+
+		while( j < Dimension )
+		{
+			ex[j] += PR[i] * x[j];
+			ex2[j] += PR[i] * ( x[j]*x[j] );
+			j++;
+		}
+		i++;
+	}
+}
+
+static void sparseGeneric( unsigned int number, const unsigned int *index, unsigned int Dimension, const double *PR, double *N, const double *x, double *EX, double *EX2 )
+{
+	unsigned int k = 0, i, j;
+	double *ex, *ex2;
+
+	while( k < number )
+	{
+		i = index[k++];
+		N[i] += PR[i];
+
+		ex = EX + (size_t)i*Dimension;
+		ex2 = EX2 + (size_t)i*Dimension;
+		j = 0;
+
+		while( j < Dimension )
+		{
+			ex[j] += PR[i] * x[j];
+			ex2[j] += PR[i] * ( x[j]*x[j] );
+			j++;
+		}
+	}
+}
+
+static unsigned int nearestGeneric( const double *const *centroids, unsigned int number, unsigned int dims, const float *x, double *score )
+{
+	unsigned int i = 0, j, best = 0;
+	double diff;
+
+	while( i < number )
+	{
+		score[i] = 0.0;
+		j = 0;
+
+		while( j < dims )
+		{
+			diff = x[j] - centroids[i][j];
+			score[i] += diff*diff;
+			j++;
+		}
+
+		if( score[i] < score[best] )
+		{
+			best = i;
+		}
+		i++;
+	}
+
+	return best;
+}
+
+const KernelSet GenericKernels = { 0, frameGeneric, blockGeneric, momentsGeneric, sparseGeneric, nearestGeneric };
+
+//! Specialised kernels, dimension D known at compile time.
+//! The dimension loops have constant trip counts and are unrolled by the compiler. Two
+//! mixtures (centroids) are processed per iteration with separate accumulators, which
+//! hides the latency of the dependent additions without changing any summation order.
+
+//! Mahalanobis exponents of a feature vector against two mixtures.
+
+template<unsigned int D>
+static inline void exponents( const double *x, const double *mean0, const double *var0, const double *mean1, const double *var1, double &value0, double &value1 )
+{
+	double diff0, diff1;
+	unsigned int j = 0;
+
+	value0 = 0.0;
+	value1 = 0.0;
+
+	while( j < D )
+	{
+		diff0 = x[j] - mean0[j];
+		diff1 = x[j] - mean1[j];
+		value0 += diff0*diff0 / var0[j];
+		value1 += diff1*diff1 / var1[j];
+		j++;
+	}
+
+	value0 *= -0.5;
+	value1 *= -0.5;
+}
+
+//! Gaussian normalisation factor of one mixture.
+
+template<unsigned int D>
+static inline double normalisation( const double *var )
+{
+	double enorm = 1.0;
+	unsigned int j = 0;
+
+	while( j < D )
+	{
+		enorm *= var[j++];
+	}
+
+	enorm = sqrt( enorm );
+	enorm *= pow( 2.0*M_PI, (double)D / 2.0 );
+
+	return pow( enorm, -1.0 );
+}
+
+template<unsigned int D>
+static inline bool frameFixed( const Model &model, const double *frame, double *PR, double &value )
+{
+	const unsigned int MixtureNumber = model.MixtureNumber;
+	const double *means = model.means, *variances = model.variances, *weights = model.weights;
+	double x[D], value0, value1, sum;
+	unsigned int i = 0, j = 0;
+
+	// Local copy, the compiler cannot keep the vector in registers across the PR stores otherwise
+	while( j < D )
+	{
+		x[j] = frame[j];
+		j++;
+	}
+
+	while( i + 1 < MixtureNumber )
+	{
+		exponents<D>( x, means + i*D, variances + i*D, means + ( i + 1 )*D, variances + ( i + 1 )*D, value0, value1 );
+
+		if( value0 < SCORE_UNDERFLOW || value1 < SCORE_UNDERFLOW )
+		{
+			return false;
+		}
+
+		PR[i] = exp(value0)*normalisation<D>( variances + i*D )*weights[i];
+		PR[i + 1] = exp(value1)*normalisation<D>( variances + ( i + 1 )*D )*weights[i + 1];
+		i += 2;
+	}
+
+	if( i < MixtureNumber )
+	{
+		exponents<D>( x, means + i*D, variances + i*D, means + i*D, variances + i*D, value0, value1 );
+
+		if( value0 < SCORE_UNDERFLOW )
+		{
+			return false;
+		}
+
+		PR[i] = exp(value0)*normalisation<D>( variances + i*D )*weights[i];
+	}
+
+	sum = 0.0;
+	i = 0;
+
+	while( i < MixtureNumber )
+	{
+		sum += PR[i++];
+	}
+
+	value = log( sum );
+
+	return true;
+}
+
+template<unsigned int D>
+static bool frameKernel( const Model &model, const double *x, double *PR, double &value )
+{
+	return frameFixed<D>( model, x, PR, value );
+}
+
+template<unsigned int D>
+static unsigned int blockKernel( const Model &model, const double *frames, unsigned int number, double *PR, double &LL )
+{
+	unsigned int T = 0, scored = 0;
+	double value;
+
+	while( T < number )
+	{
+		if( frameFixed<D>( model, frames + (size_t)T*D, PR, value ) )
+		{
+			scored++;
+			LL += value;
+		}
+		T++;
+	}
+
+	return scored;
+}
+
+template<unsigned int D>
+static void momentsKernel( unsigned int MixtureNumber, unsigned int, double sum, double *PR, double *N, const double *frame, double *EX, double *EX2 )
+{
+	double x[D], x2[D], p;
+	double *ex, *ex2;
+	unsigned int i = 0, j = 0;
+
+	while( j < D )
+	{
+		x[j] = frame[j];
+		x2[j] = frame[j]*frame[j];
+		j++;
+	}
+
+	while( i < MixtureNumber )
+	{
+		PR[i] /= sum;
+		N[i] += PR[i];
+		p = PR[i];
+
+		ex = EX + i*D;
+		ex2 = EX2 + i*D;
+		j = 0;
+
+		while( j < D )
+		{
+			ex[j] += p * x[j];
+			ex2[j] += p * x2[j];
+			j++;
+		}
+		i++;
+	}
+}
+
+template<unsigned int D>
+static void sparseKernel( unsigned int number, const unsigned int *index, unsigned int, const double *PR, double *N, const double *frame, double *EX, double *EX2 )
+{
+	double x[D], x2[D], p;
+	double *ex, *ex2;
+	unsigned int k = 0, i, j = 0;
+
+	while( j < D )
+	{
+		x[j] = frame[j];
+		x2[j] = frame[j]*frame[j];
+		j++;
+	}
+
+	while( k < number )
+	{
+		i = index[k++];
+		N[i] += PR[i];
+		p = PR[i];
+
+		ex = EX + (size_t)i*D;
+		ex2 = EX2 + (size_t)i*D;
+		j = 0;
+
+		while( j < D )
+		{
+			ex[j] += p * x[j];
+			ex2[j] += p * x2[j];
+			j++;
+		}
+	}
+}
+
+template<unsigned int D>
+static unsigned int nearestKernel( const double *const *centroids, unsigned int number, unsigned int, const float *frame, double *score )
+{
+	double x[D], diff0, diff1, score0, score1;
+	unsigned int i = 0, j = 0, best = 0;
+
+	while( j < D )
+	{
+		x[j] = frame[j];
+		j++;
+	}
+
+	while( i < number )
+	{
+		const double *c0 = centroids[i], *c1 = centroids[i + 1 < number ? i + 1 : i];
+
+		score0 = 0.0;
+		score1 = 0.0;
+		j = 0;
+
+		while( j < D )
+		{
+			diff0 = x[j] - c0[j];
+			diff1 = x[j] - c1[j];
+			score0 += diff0*diff0;
+			score1 += diff1*diff1;
+			j++;
+		}
+
+		score[i] = score0;
+		if( score0 < score[best] )
+		{
+			best = i;
+		}
+
+		if( i + 1 < number )
+		{
+			score[i + 1] = score1;
+			if( score1 < score[best] )
+			{
+				best = i + 1;
+			}
+		}
+		i += 2;
+	}
+
+	return best;
+}
+
+#define FIXED_KERNELS(D) { D, frameKernel<D>, blockKernel<D>, momentsKernel<D>, sparseKernel<D>, nearestKernel<D> }
+
+static const KernelSet FixedKernels[] = {
+	FIXED_KERNELS(13),
+	FIXED_KERNELS(20),
+	FIXED_KERNELS(39),
+	FIXED_KERNELS(60),
+	{ 0, NULL, NULL, NULL, NULL, NULL }
+};
+
+const KernelSet *selectKernels( unsigned int dimension )
+{
+	unsigned int k = 0;
+
+	while( FixedKernels[k].Dimension != 0 )
+	{
+		if( FixedKernels[k].Dimension == dimension )
+		{
+			return &FixedKernels[k];
+		}
+		k++;
+	}
+
+	return &GenericKernels;
+}
@@ -0,0 +1,65 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include "model.h"
+
+//! Inner loop kernels of one feature vector dimension.
+//! The common dimensions (13, 20, 39, 60) have instantiations with the dimension as a
+//! compile-time constant, every other dimension uses the generic kernels. All kernels sum
+//! in the order of the generic code so their results are identical.
+
+struct KernelSet {
+	unsigned int Dimension;		//!< Specialised dimension, 0 for the generic kernels.
+
+	//! Log-likelihood of a single feature vector, see frameLogL().
+	bool (*FrameLogL)( const Model &, const double *, double *, double & );
+
+	//! Log-likelihoods of a block of feature vectors, see blockLogL().
+	/*!	\return number of scored feature vectors.
+	*/
+	unsigned int (*BlockLogL)( const Model &, const double *, unsigned int, double *, double & );
+
+	//! Posterior normalisation and moment update of one feature vector, see Stats::accumulate().
+	/*!	\param mixture number.
+		\param feature vector dimension.
+		\param sum of the weighted mixture likelihoods.
+		\param weighted mixture likelihoods, turned into posteriors.
+		\param mixture occupation.
+		\param feature vector.
+		\param first moment.
+		\param second moment.
+	*/
+	void (*Moments)( unsigned int, unsigned int, double, double *, double *, const double *, double *, double * );
+
+	//! Moment update of the selected mixtures of one feature vector, see Stats::accumulate().
+	/*!	\param number of selected mixtures.
+		\param selected mixtures.
+		\param feature vector dimension.
+		\param posteriors.
+		\param mixture occupation.
+		\param feature vector.
+		\param first moment.
+		\param second moment.
+	*/
+	void (*SparseMoments)( unsigned int, const unsigned int *, unsigned int, const double *, double *, const double *, double *, double * );
+
+	//! Nearest centroid, see nearest().
+	unsigned int (*Nearest)( const double *const *, unsigned int, unsigned int, const float *, double * );
+};
+
+//! Kernels for any dimension.
+
+extern const KernelSet GenericKernels;
+
+//! Kernels of a feature vector dimension.
+/*!	\param feature vector dimension.
+	\return the specialised kernels of the dimension or the generic kernels.
+*/
+
+const KernelSet *selectKernels( unsigned int );
+
+#endif
@@ -0,0 +1,981 @@
+#include "model.h"
+#include "profile.h"
+#include "kernels.h"
+#include "tree.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctime>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+Model::Model( unsigned int mixtures, unsigned int length, double floor, Arena *arena )
+{
+	MixtureNumber = mixtures;
+	Dimension = length;
+	vFloor = floor;
+	Kernels = selectKernels( Dimension );
+	Image = NULL;
+	ImageSize = 0;
+	ImageLock = -1;
+
+	Private = NULL;
+
+	if( arena == NULL )
+	{
+		arena = Private = new Arena();
+	}
+
+	setParameters( arena->doubles( parameterNumber( MixtureNumber, Dimension ) ) );
+}
+
+void Model::setParameters( double *block )
+{
+	Parameters = block;
+	globalvars = Parameters;
+	weights = globalvars + Dimension;
+	means = weights + MixtureNumber;
+	variances = means + MixtureNumber*Dimension;
+}
+
+//! Drop the private parameter block once the parameters live in a shared image.
+//! A block carved from a caller's arena stays there until the arena is destroyed.
+
+void Model::releasePrivate()
+{
+	delete Private;
+	Private = NULL;
+}
+
+int Model::fail( string message, int code )
+{
+	Error = message;
+	return code;
+}
+
+//! Load a model of any type.
+/*!	\param model file name.
+	\param model file type (MODEL_FILE, MODEL_VQ or MODEL_DELTA).
+	\param base model file (delta models only).
+	\param share the model through POSIX shared memory (model and VQ files only).
+	\return 0 or a negative error code.
+*/
+
+int Model::load( string modelFile, unsigned int type, string baseFile, bool shared )
+{
+	int status = 0;
+
+	if( shared && ( type == MODEL_FILE || type == MODEL_VQ ) )
+	{
+		bool attached = false;
+
+		status = attachShared( modelFile, type, attached );
+
+		if( status != 0 || attached )
+		{
+			return status;
+		}
+	}
+
+	if( type == MODEL_FILE )
+	{
+		status = loadModel( modelFile );
+	}
+	else if( type == MODEL_VQ )
+	{
+		status = loadVQ( modelFile, false );
+	}
+	else if( type == MODEL_DELTA )
+	{
+		status = loadDelta( modelFile, baseFile );
+	}
+	else
+	{
+		return fail( "Load(): InitType error value specified not known.", -100 );
+	}
+
+	if( status == 0 && Image != NULL )
+	{
+		publishShared();
+	}
+
+	return status;
+}
+
+int Model::loadModel( string modelFile )
+{
+	ifstream Finit( modelFile.c_str(), ios_base::binary );
+	ModelHeader Hmodel;
+
+	Finit.read( reinterpret_cast <char *>( &Hmodel ), sizeof( ModelHeader ) );
+
+	if( !Finit )
+	{
+		return fail( "LoadModel(): Cannot open model file " + modelFile + " .", -200 );
+	}
+
+	if( Hmodel.MixtureNumber != MixtureNumber )
+	{
+		return fail( "LoadModel(): Model file reports non-equal mixture number", -201 );
+	}
+
+	if( Hmodel.Dimension != Dimension )
+	{
+		return fail( "LoadModel(): Model file reports non-equal feature vector dimension", -202 );
+	}
+
+	int i = 0;
+	double value;
+
+	while( i < Dimension )
+	{
+		Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
+		globalvars[i++] = value;
+	}
+
+	int j = 0;
+	i = 0;
+
+	while( i < MixtureNumber )
+	{
+		Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
+		weights[i] = value;
+
+		while( j < Dimension )
+		{
+			Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
+			means[i*Dimension + j] = value;
+
+			Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
+			variances[i*Dimension + j++] = value;
+		}
+		j = 0;
+		i++;
+	}
+
+	if( !Finit )
+	{
+		return fail( "LoadModel(): Model file " + modelFile + " is truncated", -203 );
+	}
+
+	Finit.close();
+
+	return 0;
+}
+
+//! Load a VQ text codebook.
+/*!	\param codebook file name.
+	\param floor the cluster variances with vFloor times the global variances (training),
+		otherwise the variances are used as is (scoring).
+*/
+
+int Model::loadVQ( string dataFile, bool floorVariances )
+{
+	ifstream Finit( dataFile.c_str() );
+
+	if( !Finit )
+	{
+		return fail( "LoadVQ(): Cannot open VQcodebook file " + dataFile + " .", -300 );
+	}
+
+	int SkipNumber = 6*Dimension*Dimension;
+
+	// Ignore headers and mean data
+	Finit.ignore( SkipNumber, '\n' );
+	Finit.ignore( SkipNumber, '\n' );
+	Finit.ignore( SkipNumber, '\n' );
+	Finit.ignore( SkipNumber, '\n' );
+
+	int i = 0;
+	double value;
+
+	while( i < Dimension )
+	{
+		Finit >> value;
+		globalvars[i++] = value;
+	}
+
+	if( floorVariances )
+	{
+		i = 0;
+		while( i < Dimension )
+		{
+			globalvars[i++] *= vFloor;
+		}
+	}
+
+	int type = 0;
+	Finit >> type;	// magic
+	Finit >> type; // type
+
+	if( type == VQ_TREE )
+	{
+		Finit.close();
+		return loadTreeVQ( dataFile, floorVariances );
+	}
+
+	if( type != VQ_LINEAR )
+	{
+		return fail( "LoadVQ(): Unknown VQ codebook type.", -301 );
+	}
+
+	int covkind = 0;
+	Finit >> covkind;
+
+	if( covkind != 1 )
+	{
+		return fail( "LoadVQ(): File contains non-diagonal covariance values.", -302 );
+	}
+
+	int clusterNumber = 0;
+	Finit >> clusterNumber;
+
+	if( clusterNumber != MixtureNumber )
+	{
+		return fail( "LoadVQ(): The cluster number does not match mixture number.", -303 );
+	}
+
+	int streamNumber = 0;
+	Finit >> streamNumber;
+
+	if( streamNumber != 1 )
+	{
+		return fail( "LoadVQ(): More than one stream in file.", -304 );
+	}
+
+	int streamWidth = 0;
+	Finit >> streamWidth;
+
+	if( streamWidth != Dimension )
+	{
+		return fail( "LoadVQ(): Stream width not equal to feature vector dimension.", -305 );
+	}
+
+	// Readout cluster header
+	Finit.ignore( 40, '\n' );
+	Finit.ignore( 40, '\n' );
+
+	// Read cluster data
+	int j;
+	i = 0;
+
+	while( i < MixtureNumber )
+	{
+		j = 0;
+
+		while( j < Dimension )
+		{
+			Finit >> value;
+			means[i*Dimension + j++] = value;
+		}
+
+		j = 0;
+
+		while( j < Dimension )
+		{
+			Finit >> value;
+
+			if( floorVariances && value < globalvars[j] )
+			{
+				value = globalvars[j];
+			}
+			variances[i*Dimension + j++] = value;
+		}
+		i++;
+
+		// Readout next header
+		Finit.ignore( 40, '\n' );
+		Finit.ignore( 40, '\n' );
+		Finit.ignore( 40, '\n' );
+	}
+
+	i = 0;
+
+	while( i < MixtureNumber )
+	{
+		weights[i++] = 1.0/(double)MixtureNumber;
+	}
+
+	Finit.close();
+
+	return 0;
+}
+
+//! Load a tree-structured VQ codebook, the leaves are the clusters, see loadVQ().
+
+int Model::loadTreeVQ( string dataFile, bool floorVariances )
+{
+	GaussianTree tree;
+	int status = tree.load( dataFile, Dimension );
+
+	if( status != 0 )
+	{
+		return fail( "LoadVQ(): " + tree.Error, status );
+	}
+
+	if( tree.LeafNumber != MixtureNumber )
+	{
+		return fail( "LoadVQ(): The leaf number of the tree codebook does not match mixture number.", -306 );
+	}
+
+	unsigned int i = 0, j, node;
+
+	while( i < Dimension )
+	{
+		globalvars[i] = floorVariances ? tree.globalvars[i]*vFloor : tree.globalvars[i];
+		i++;
+	}
+
+	node = 0;
+
+	while( node < tree.NodeNumber )
+	{
+		if( tree.Left[node] == 0 )
+		{
+			i = tree.Index[node];
+			j = 0;
+
+			while( j < Dimension )
+			{
+				means[i*Dimension + j] = tree.means[(size_t)node*Dimension + j];
+				variances[i*Dimension + j] = tree.variances[(size_t)node*Dimension + j];
+
+				if( floorVariances && variances[i*Dimension + j] < globalvars[j] )
+				{
+					variances[i*Dimension + j] = globalvars[j];
+				}
+				j++;
+			}
+			weights[i] = 1.0/(double)MixtureNumber;
+		}
+		node++;
+	}
+
+	return 0;
+}
+
+//! Orders mixture indices by decreasing weight.
+
+namespace {
+
+struct WeightOrder {
+	WeightOrder( const double *weights ) : Weights( weights ) {}
+
+	bool operator()( unsigned int a, unsigned int b ) const { return Weights[a] > Weights[b]; }
+
+	const double *Weights;
+};
+
+}
+
+//! Initialise by binary splitting of a smaller model (LBG).
+//! The mixtures with the largest weights are split in two along their largest variance
+//! dimension, the two means are moved SPLIT_PERTURB standard deviations apart from the
+//! original one; weights are halved, variances and global variances are copied.
+/*!	\param model with at least half and at most all of the mixtures of this model.
+	\return 0 or a negative error code.
+*/
+
+int Model::split( const Model &source )
+{
+	const unsigned int K = source.MixtureNumber;
+
+	if( source.Dimension != Dimension || MixtureNumber < K || MixtureNumber > 2*K )
+	{
+		return fail( "Split(): Model sizes do not allow a binary split.", -350 );
+	}
+
+	vector<unsigned int> order( K );
+	unsigned int i = 0, j, k, best, added = K;
+
+	while( i < K )
+	{
+		order[i] = i;
+		i++;
+	}
+
+	// Largest weights first, ties keep the mixture order
+	std::stable_sort( order.begin(), order.end(), WeightOrder( source.weights ) );
+
+	std::copy( source.globalvars, source.globalvars + Dimension, globalvars );
+	std::copy( source.weights, source.weights + K, weights );
+	std::copy( source.means, source.means + (size_t)K*Dimension, means );
+	std::copy( source.variances, source.variances + (size_t)K*Dimension, variances );
+
+	i = 0;
+
+	while( added < MixtureNumber )
+	{
+		k = order[i++];
+		best = 0;
+		j = 1;
+
+		while( j < Dimension )
+		{
+			if( variances[k*Dimension + j] > variances[k*Dimension + best] )
+			{
+				best = j;
+			}
+			j++;
+		}
+
+		std::copy( means + k*Dimension, means + ( k + 1 )*Dimension, means + added*Dimension );
+		std::copy( variances + k*Dimension, variances + ( k + 1 )*Dimension, variances + added*Dimension );
+
+		double offset = SPLIT_PERTURB*sqrt( variances[k*Dimension + best] );
+
+		means[k*Dimension + best] -= offset;
+		means[added*Dimension + best] += offset;
+
+		weights[k] *= 0.5;
+		weights[added] = weights[k];
+		added++;
+	}
+
+	return 0;
+}
+
+int Model::loadDelta( string deltaFile, string baseFile )
+{
+	int status = loadModel( baseFile );
+
+	if( status != 0 )
+	{
+		return status;
+	}
+
+	ifstream Finit( deltaFile.c_str(), ios_base::binary );
+	DeltaHeader Hdelta;
+
+	Finit.read( reinterpret_cast <char *>( &Hdelta ), sizeof( DeltaHeader ) );
+
+	if( !Finit )
+	{
+		return fail( "LoadDelta(): Cannot open delta model file " + deltaFile + " .", -600 );
+	}
+
+	if( Hdelta.Magic != DELTA_MAGIC )
+	{
+		return fail( "LoadDelta(): " + deltaFile + " is not a delta model file", -601 );
+	}
+
+	if( Hdelta.MixtureNumber != MixtureNumber || Hdelta.Dimension != Dimension )
+	{
+		return fail( "LoadDelta(): Delta model reports non-equal mixture number or feature vector dimension", -602 );
+	}
+
+	if( Hdelta.BaseHash != fileHash( baseFile ) )
+	{
+		return fail( "LoadDelta(): Delta model was not adapted from base model " + baseFile, -603 );
+	}
+
+	unsigned int i = 0, j, k = 0;
+	double value;
+
+	if( Hdelta.Flags & 1 )
+	{
+		while( i < MixtureNumber )
+		{
+			Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
+			weights[i++] = value;
+		}
+	}
+
+	while( k < Hdelta.BlockNumber )
+	{
+		Finit.read( reinterpret_cast <char *>( &i ), sizeof(unsigned int) );
+
+		if( !Finit || i >= MixtureNumber )
+		{
+			return fail( "LoadDelta(): Delta model file " + deltaFile + " is corrupt", -604 );
+		}
+
+		j = 0;
+		while( j < Dimension && Hdelta.Flags & 2 )
+		{
+			Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
+			means[i*Dimension + j++] = value;
+		}
+
+		j = 0;
+		while( j < Dimension && Hdelta.Flags & 4 )
+		{
+			Finit.read( reinterpret_cast <char *>( &value ), sizeof(double) );
+			variances[i*Dimension + j++] = value;
+		}
+		k++;
+	}
+
+	if( !Finit )
+	{
+		return fail( "LoadDelta(): Delta model file " + deltaFile + " is truncated", -605 );
+	}
+
+	Finit.close();
+
+	return 0;
+}
+
+int Model::saveModel( string modelFile )
+{
+	ProfileTimer timer( PHASE_OUTPUT );
+	ofstream Fmodel( modelFile.c_str(), ios_base::binary );
+
+	if( !Fmodel )
+	{
+		return fail( "SaveModel(): Cannot open output model file " + modelFile,  -400 );
+	}
+
+	ModelHeader Hmodel;
+
+	Hmodel.MixtureNumber = MixtureNumber;
+	Hmodel.Dimension = Dimension;
+	Hmodel.vFloor = vFloor;
+
+	Fmodel.write( reinterpret_cast< char * > ( &Hmodel ), sizeof( ModelHeader ) );
+
+	int i = 0;
+
+	while( i < Dimension )
+	{
+		Fmodel.write( reinterpret_cast <char *>( &globalvars[i++] ), sizeof(double) );
+	}
+
+	int j = 0;
+	i = 0;
+
+	while( i < MixtureNumber )
+	{
+		Fmodel.write( reinterpret_cast <char *>( &weights[i] ), sizeof(double) );
+
+		while( j < Dimension )
+		{
+			Fmodel.write( reinterpret_cast <char *>( &means[i*Dimension + j] ), sizeof(double) );
+			Fmodel.write( reinterpret_cast <char *>( &variances[i*Dimension + j++] ), sizeof(double) );
+		}
+
+		j = 0;
+		i++;
+	}
+
+	Fmodel.close();
+
+	return 0;
+}
+
+//! Save the adapted parameter blocks relative to a base model.
+/*!	\param delta model file name.
+	\param base model file the model was adapted from.
+	\param adapted blocks 1 (weights), 2 (means), 4 (variances).
+	\param adaption factor of every mixture.
+	\param only store mixtures with an adaption factor above this value.
+*/
+
+int Model::saveDelta( string deltaFile, string baseFile, unsigned int flags, const double *DDA, double threshold )
+{
+	ProfileTimer timer( PHASE_OUTPUT );
+	if( !( flags & 7 ) )
+	{
+		return fail( "SaveDelta(): No adapted parameters to store.",  -801 );
+	}
+
+	DeltaHeader Hdelta;
+
+	Hdelta.Magic = DELTA_MAGIC;
+	Hdelta.MixtureNumber = MixtureNumber;
+	Hdelta.Dimension = Dimension;
+	Hdelta.Flags = flags & 7;
+	Hdelta.Threshold = (float)threshold;
+	Hdelta.BaseHash = fileHash( baseFile );
+
+	if( Hdelta.BaseHash == 0 )
+	{
+		return fail( "SaveDelta(): Cannot read base model file " + baseFile,  -802 );
+	}
+
+	unsigned int i = 0;
+	Hdelta.BlockNumber = 0;
+
+	while( i < MixtureNumber )
+	{
+		if( DDA[i++] > threshold )
+		{
+			Hdelta.BlockNumber++;
+		}
+	}
+
+	ofstream Fmodel( deltaFile.c_str(), ios_base::binary );
+
+	if( !Fmodel )
+	{
+		return fail( "SaveDelta(): Cannot open output model file " + deltaFile,  -803 );
+	}
+
+	Fmodel.write( reinterpret_cast< char * > ( &Hdelta ), sizeof( DeltaHeader ) );
+
+	// Weights are renormalized during adaption so all of them change
+	if( Hdelta.Flags & 1 )
+	{
+		i = 0;
+		while( i < MixtureNumber )
+		{
+			Fmodel.write( reinterpret_cast <char *>( &weights[i++] ), sizeof(double) );
+		}
+	}
+
+	unsigned int j;
+	i = 0;
+
+	while( i < MixtureNumber )
+	{
+		if( DDA[i] > threshold )
+		{
+			Fmodel.write( reinterpret_cast <char *>( &i ), sizeof(unsigned int) );
+
+			j = 0;
+			while( j < Dimension && Hdelta.Flags & 2 )
+			{
+				Fmodel.write( reinterpret_cast <char *>( &means[i*Dimension + j++] ), sizeof(double) );
+			}
+
+			j = 0;
+			while( j < Dimension && Hdelta.Flags & 4 )
+			{
+				Fmodel.write( reinterpret_cast <char *>( &variances[i*Dimension + j++] ), sizeof(double) );
+			}
+		}
+		i++;
+	}
+
+	cout << "Delta blocks stored\t" << Hdelta.BlockNumber << " of " << MixtureNumber << endl;
+
+	Fmodel.close();
+
+	return 0;
+}
+
+//! Attach to the shared image of a model, or become the process that publishes it.
+/*!	\param model file name.
+	\param model file type.
+	\param set if a published image was attached, otherwise the model must still be loaded:
+		into shared memory if this process publishes it, into private memory if sharing failed.
+*/
+
+int Model::attachShared( string modelFile, unsigned int initType, bool &attached )
+{
+	unsigned long long hash = fileHash( modelFile );
+
+	attached = false;
+
+	if( hash == 0 )
+	{
+		return fail( "AttachShared(): Cannot open model file " + modelFile + " .", -700 );
+	}
+
+	// The image also depends on how the file is interpreted
+	unsigned int key[3] = { initType, MixtureNumber, Dimension };
+	unsigned int i = 0;
+
+	while( i < 3 )
+	{
+		hash ^= key[i++];
+		hash *= 1099511628211ULL;
+	}
+
+	string name = sharedName( hash );
+	size_t size = sizeof( SharedHeader ) + sizeof( double )*( Dimension + MixtureNumber*( 1 + 2*Dimension ) );
+	void *block = MAP_FAILED;
+	unsigned int attempt = 0;
+	int fd, status = 0;
+
+	while( attempt < SHARED_ATTEMPTS )
+	{
+		fd = shm_open( name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644 );
+
+		if( fd >= 0 )
+		{
+			// Locked until publishShared(), the lock dies with the process
+			if( flock( fd, LOCK_EX ) == 0 && ftruncate( fd, size ) == 0 )
+			{
+				block = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+			}
+
+			if( block == MAP_FAILED )
+			{
+				shm_unlink( name.c_str() );
+				close( fd );
+				cout << "Warning: cannot publish shared model " << name << ", loading privately" << endl;
+				return 0;
+			}
+
+			releasePrivate();
+
+			Image = block;
+			ImageSize = size;
+			ImageName = name;
+			ImageLock = fd;
+			reinterpret_cast< SharedHeader * >( Image )->Hash = hash;
+			setParameters( reinterpret_cast< double * >( reinterpret_cast< char * >( Image ) + sizeof( SharedHeader ) ) );
+
+			cout << "Publishing shared model " << name << endl;
+			return 0;
+		}
+
+		if( errno != EEXIST || ( fd = shm_open( name.c_str(), O_RDONLY, 0 ) ) < 0 )
+		{
+			cout << "Warning: cannot open shared model " << name << ", loading privately" << endl;
+			return 0;
+		}
+
+		status = waitShared( fd, name, size, block );
+		close( fd );
+
+		if( status >= 0 )
+		{
+			break;
+		}
+
+		cout << "Warning: publisher of shared model " << name << " died, publishing again" << endl;
+		attempt++;
+	}
+
+	if( status <= 0 )
+	{
+		cout << "Warning: shared model " << name << " was never published, loading privately" << endl;
+		return 0;
+	}
+
+	SharedHeader *Hshared = reinterpret_cast< SharedHeader * >( block );
+
+	if( Hshared->Magic != SHARED_MAGIC || Hshared->Hash != hash || Hshared->Hmodel.MixtureNumber != MixtureNumber || Hshared->Hmodel.Dimension != Dimension )
+	{
+		munmap( block, size );
+		return fail( "AttachShared(): Shared model " + name + " does not match " + modelFile, -701 );
+	}
+
+	releasePrivate();
+
+	Image = block;
+	ImageSize = size;
+	ImageName = name;
+	setParameters( reinterpret_cast< double * >( reinterpret_cast< char * >( Image ) + sizeof( SharedHeader ) ) );
+
+	cout << "Attached shared model " << name << endl;
+	attached = true;
+
+	return 0;
+}
+
+//! Milliseconds of the monotonic clock.
+
+static long long clockMilliseconds()
+{
+	struct timespec now;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+
+	return (long long)now.tv_sec*1000 + now.tv_nsec/1000000;
+}
+
+//! Wait for another process to publish a shared image.
+//! An image that is not ready and stays unlocked for SHARED_GRACE milliseconds belongs to a
+//! dead publisher: it is withdrawn (unless another waiter already did) so it can be published again.
+/*!	\param descriptor of the image.
+	\param shared memory object name of the image.
+	\param image size.
+	\param mapped image once it is ready.
+	\return 1 if the image is ready, 0 if it was not published within SHARED_WAIT
+		milliseconds, -1 if its publisher died.
+*/
+
+int Model::waitShared( int fd, string name, size_t size, void *&block )
+{
+	const long long deadline = clockMilliseconds() + SHARED_WAIT;
+	long long now, unlocked = -1;
+	struct stat info;
+
+	block = MAP_FAILED;
+
+	while( ( now = clockMilliseconds() ) < deadline )
+	{
+		if( block == MAP_FAILED && fstat( fd, &info ) == 0 && (size_t)info.st_size == size )
+		{
+			block = mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 );
+		}
+
+		if( block != MAP_FAILED && __atomic_load_n( &reinterpret_cast< SharedHeader * >( block )->Ready, __ATOMIC_ACQUIRE ) )
+		{
+			return 1;
+		}
+
+		if( flock( fd, LOCK_EX | LOCK_NB ) == 0 )
+		{
+			unlocked = unlocked < 0 ? now : unlocked;
+
+			// Holding the lock nobody else withdraws the image; one already withdrawn has no links
+			if( now - unlocked >= SHARED_GRACE && fstat( fd, &info ) == 0 )
+			{
+				if( info.st_nlink > 0 )
+				{
+					shm_unlink( name.c_str() );
+				}
+				flock( fd, LOCK_UN );
+
+				if( block != MAP_FAILED )
+				{
+					munmap( block, size );
+					block = MAP_FAILED;
+				}
+				return -1;
+			}
+			flock( fd, LOCK_UN );
+		}
+		else
+		{
+			unlocked = -1;
+		}
+
+		usleep( 1000 );
+	}
+
+	if( block != MAP_FAILED )
+	{
+		munmap( block, size );
+		block = MAP_FAILED;
+	}
+
+	return 0;
+}
+
+//! Mark the loaded shared image ready for the processes waiting in attachShared().
+
+void Model::publishShared()
+{
+	SharedHeader *Hshared = reinterpret_cast< SharedHeader * >( Image );
+
+	Hshared->Hmodel.MixtureNumber = MixtureNumber;
+	Hshared->Hmodel.Dimension = Dimension;
+	Hshared->Hmodel.vFloor = vFloor;
+	Hshared->Magic = SHARED_MAGIC;
+	__atomic_store_n( &Hshared->Ready, 1, __ATOMIC_RELEASE );
+
+	mprotect( Image, ImageSize, PROT_READ );
+
+	flock( ImageLock, LOCK_UN );
+	close( ImageLock );
+	ImageLock = -1;
+}
+
+void Model::printModel()
+{
+	int i = 0, j = 0;
+
+	cout << "WEIGHTS" << endl;
+	while( i < MixtureNumber )
+	{
+		cout << weights[i++] << " ";
+	}
+	cout << endl;
+
+	i = 0;
+	cout << "MEANS" << endl;
+	while( i < MixtureNumber )
+	{
+		j = 0;
+		cout << i << ": ";
+		while( j < Dimension )
+		{
+			cout << means[i*Dimension + j++] << " ";
+		}
+		cout << endl;
+		i++;
+	}
+	cout << endl;
+
+	i = 0;
+	cout << "VARS" << endl;
+	while( i < MixtureNumber )
+	{
+		j = 0;
+		cout << i << ": ";
+		while( j < Dimension )
+		{
+			cout << variances[i*Dimension + j++] << " ";
+		}
+		cout << endl;
+		i++;
+	}
+	cout << endl;
+
+	i = 0;
+	cout << "GLOBAL VARS" << endl;
+	while( i < Dimension )
+	{
+		cout << globalvars[i++] << " ";
+	}
+	cout << endl;
+}
+
+Model::~Model()
+{
+	if( Image != NULL )
+	{
+		// Withdraw an image this process failed to publish so others do not wait for it
+		if( !__atomic_load_n( &reinterpret_cast< SharedHeader * >( Image )->Ready, __ATOMIC_ACQUIRE ) )
+		{
+			shm_unlink( ImageName.c_str() );
+		}
+		munmap( Image, ImageSize );
+	}
+
+	if( ImageLock >= 0 )
+	{
+		close( ImageLock );
+	}
+
+	delete Private;
+}
+
+unsigned long long fileHash( string fileName )
+{
+	ifstream Fhash( fileName.c_str(), ios_base::binary );
+
+	if( !Fhash )
+	{
+		return 0;
+	}
+
+	unsigned long long hash = 14695981039346656037ULL;
+	char buffer[4096];
+	std::streamsize i, count;
+
+	do
+	{
+		Fhash.read( buffer, sizeof( buffer ) );
+		count = Fhash.gcount();
+
+		i = 0;
+		while( i < count )
+		{
+			hash ^= (unsigned char)buffer[i++];
+			hash *= 1099511628211ULL;
+		}
+	} while( count > 0 );
+
+	Fhash.close();
+
+	return hash;
+}
+
+string sharedName( unsigned long long hash )
+{
+	char name[32];
+
+	snprintf( name, sizeof( name ), "/gmm-%016llx", hash );
+
+	return string( name );
+}
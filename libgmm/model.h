@@ -0,0 +1,183 @@
+#ifndef MODEL_H
+#define MODEL_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+
+#include "arena.h"
+
+using std::ios_base;
+using std::cout;
+using std::endl;
+using std::vector;
+using std::ifstream;
+using std::ofstream;
+using std::string;
+using std::stringstream;
+
+struct KernelSet;
+
+//! Model header format
+
+typedef struct {
+	unsigned int	MixtureNumber,	//!< mixture number.
+			Dimension;	//!< feature vector dimension
+	double		vFloor;		//!< global variance flooring value.
+}ModelHeader;
+
+//! Delta model identifier.
+
+#define DELTA_MAGIC 0x544C4447
+
+//! Delta model header format.
+//! A delta model only stores the adapted parameter blocks of a MAP adapted model,
+//! the remaining parameters are taken from the base (UBM) model it was adapted from.
+
+typedef struct {
+	unsigned int	Magic,		//!< delta model identifier (DELTA_MAGIC).
+			MixtureNumber,	//!< mixture number.
+			Dimension,	//!< feature vector dimension
+			Flags,		//!< stored blocks 1 (weights), 2 (means), 4 (variances)
+			BlockNumber;	//!< number of mixtures stored
+	float		Threshold;	//!< adaption factor threshold used to select mixtures
+	unsigned long long	BaseHash;	//!< content hash of the base model file
+}DeltaHeader;
+
+//! Shared model image identifier.
+
+#define SHARED_MAGIC 0x4D484753
+
+//! Number of milliseconds to wait for another process to publish a shared model image.
+
+#define SHARED_WAIT 30000
+
+//! Milliseconds an unpublished image has to stay unlocked before its publisher counts as dead.
+//! Covers the moment between creating the image and locking it.
+
+#define SHARED_GRACE 100
+
+//! Number of times a dead publisher's image is withdrawn and publishing retried.
+
+#define SHARED_ATTEMPTS 3
+
+//! Shared model image header.
+//! The image is a read-only copy of the model parameters published in POSIX shared memory:
+//! header, global variances, weights, means and variances. The publishing process holds an
+//! exclusive flock() on the image until it is ready, so waiters can tell a dead publisher
+//! (killed while loading) from a slow one.
+
+typedef struct {
+	unsigned int	Magic,		//!< shared image identifier (SHARED_MAGIC).
+			Ready;		//!< set once the publishing process has loaded the model.
+	unsigned long long	Hash;	//!< content hash of the model file.
+	ModelHeader	Hmodel;		//!< model header.
+}SharedHeader;
+
+//! Distance of the two means of a split mixture from the original mean, in standard deviations.
+
+#define SPLIT_PERTURB 0.2
+
+//! Model initialization file types.
+
+#define MODEL_FILE	1	//!< binary model file
+#define MODEL_VQ	2	//!< VQ text codebook
+#define MODEL_DELTA	3	//!< delta model relative to a base model file
+
+//! Diagonal covariance GMM parameter container.
+//! All parameters live in one block: global variances, weights, means and variances,
+//! means and variances stored mixture after mixture. The block is either private or a
+//! mapped shared memory image. Functions return 0 or a negative error code and leave a
+//! message in Error.
+
+class Model {
+	public:
+		//! Constructor.
+		/*!	\param Model mixture number.
+			\param Feature vector dimension.
+			\param Variance minimizing factor.
+			\param Arena the parameter block is carved from, NULL for a private one.
+		*/
+		Model( unsigned int, unsigned int, double, Arena * =NULL );
+
+		int load( string, unsigned int, string ="", bool =false );
+		int loadModel( string );		// HTK binary format file : type = 1
+		int loadVQ( string, bool );		// VQ Text file format : type = 2
+		int loadDelta( string, string );	// Delta model + base model : type = 3
+
+		int split( const Model & );
+
+		int saveModel( string );
+		int saveDelta( string, string, unsigned int, const double *, double );
+
+		void printModel();
+
+		bool isShared() { return Image != NULL; }	//!< The parameters are a shared memory image.
+
+		~Model();
+
+		unsigned int MixtureNumber;	//!< The mixture number of the model.
+		unsigned int Dimension;		//!< The dimension of the feature vector.
+		double vFloor;		//!< Value multiplied by global variance values to give minimum variances values.
+
+		double *globalvars;	//!< Global variances (Dimension).
+		double *weights;	//!< Model weights (MixtureNumber).
+		double *means;		//!< Model means (MixtureNumber*Dimension).
+		double *variances;	//!< Model variances (MixtureNumber*Dimension).
+
+		const KernelSet *Kernels;	//!< Inner loop kernels selected for Dimension.
+
+		string Error;		//!< Message of the last error.
+
+	private:
+
+		int fail( string, int );
+		int loadTreeVQ( string, bool );
+		int attachShared( string, unsigned int, bool & );
+		int waitShared( int, string, size_t, void *& );
+		void publishShared();
+		void setParameters( double * );
+		void releasePrivate();
+
+		double *Parameters;	//!< Model parameter block, from an arena or mapped from shared memory.
+		Arena *Private;		//!< Arena of the parameter block if the model owns it, else NULL.
+		void *Image;		//!< Mapped shared model image, NULL if the model is private.
+		size_t ImageSize;	//!< Size of the mapped shared model image.
+		string ImageName;	//!< Shared memory object name of the model image.
+		int ImageLock;		//!< Locked descriptor of an image being published, -1 otherwise.
+};
+
+//! Number of doubles in the parameter block of a model.
+/*!	\param mixture number.
+	\param feature vector dimension.
+	\return globalvars, weights, means and variances size.
+*/
+
+inline size_t parameterNumber( unsigned int mixtures, unsigned int length )
+{
+	return length + (size_t)mixtures*( 1 + 2*(size_t)length );
+}
+
+//! Content hash (64 bit FNV-1a) of a file, used to tie delta models to their base model.
+/*!	\param file name.
+	\return hash value or 0 if the file cannot be read.
+*/
+
+unsigned long long fileHash( string );
+
+//! Name of the shared memory image of a model.
+/*!	\param model content hash.
+	\return POSIX shared memory object name.
+*/
+
+string sharedName( unsigned long long );
+
+#endif
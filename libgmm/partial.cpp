@@ -0,0 +1,465 @@
+#include "partial.h"
+#include "score.h"
+#include "profile.h"
+
+#include <algorithm>
+
+//! Orders dimensions by decreasing spread.
+
+namespace {
+
+struct SpreadOrder {
+	SpreadOrder( const double *spread ) : Spread( spread ) {}
+
+	bool operator()( unsigned int a, unsigned int b ) const { return Spread[a] > Spread[b]; }
+
+	const double *Spread;
+};
+
+}
+
+void spreadOrder( const double *spread, unsigned int dims, unsigned int *order )
+{
+	unsigned int j = 0;
+
+	while( j < dims )
+	{
+		order[j] = j;
+		j++;
+	}
+
+	// Ties keep the natural order
+	std::stable_sort( order, order + dims, SpreadOrder( spread ) );
+}
+
+//! Squared euclidean distance summed as nearest() does.
+
+static inline double fullDistance( const double *centroid, const float *x, unsigned int dims )
+{
+	double diff, score = 0.0;
+	unsigned int j = 0;
+
+	while( j < dims )
+	{
+		diff = x[j] - centroid[j];
+		score += diff*diff;
+		j++;
+	}
+
+	return score;
+}
+
+PartialCodebook::PartialCodebook( const double *const *centroids, unsigned int number, unsigned int dims )
+{
+	vector<double> mean( dims, 0.0 ), spread( dims, 0.0 );
+	unsigned int i = 0, j;
+	double diff;
+
+	Number = number;
+	Dimension = dims;
+	Head = dims < PARTIAL_HEAD ? dims : PARTIAL_HEAD;
+	Order.resize( dims );
+	Centroids.resize( (size_t)number*dims );
+	Permuted.resize( (size_t)number*dims );
+	X.resize( dims );
+	Candidates.resize( number );
+
+	while( i < Number )
+	{
+		j = 0;
+		while( j < Dimension )
+		{
+			Centroids[(size_t)i*Dimension + j] = centroids[i][j];
+			mean[j] += centroids[i][j] / (double)Number;
+			j++;
+		}
+		i++;
+	}
+
+	// Centroid variance per dimension: far apart centroids are told apart early
+	i = 0;
+	while( i < Number )
+	{
+		j = 0;
+		while( j < Dimension )
+		{
+			diff = centroids[i][j] - mean[j];
+			spread[j] += diff*diff;
+			j++;
+		}
+		i++;
+	}
+
+	spreadOrder( &spread[0], Dimension, &Order[0] );
+
+	i = 0;
+	while( i < Number )
+	{
+		j = 0;
+		while( j < Dimension )
+		{
+			Permuted[(size_t)i*Dimension + j] = centroids[i][Order[j]];
+			j++;
+		}
+		i++;
+	}
+}
+
+//! Nearest centroid (squared euclidean distance), same result as nearest().
+/*!	\param feature vector.
+	\param distance to every centroid; a lower bound of the distance for abandoned centroids.
+	\return index of the first nearest centroid.
+*/
+
+unsigned int PartialCodebook::nearest( const float *x, double *score )
+{
+	const unsigned int D = Dimension, H = Head;
+	unsigned int i = 0, j, k, end, count, guess = 0, best;
+	double diff, diff0, diff1, partial, partial0, partial1, bound, least;
+	const double *centroid;
+
+	j = 0;
+	while( j < D )
+	{
+		X[j] = (double)x[Order[j]];
+		j++;
+	}
+
+	// Leading dimensions of every centroid, the smallest partial distance is the first guess.
+	// Two centroids per iteration keep two independent sums in flight.
+	least = HUGE_VAL;
+
+	while( i < Number )
+	{
+		const double *c0 = &Permuted[(size_t)i*D], *c1 = &Permuted[(size_t)( i + 1 < Number ? i + 1 : i )*D];
+
+		partial0 = 0.0;
+		partial1 = 0.0;
+		j = 0;
+
+		while( j < H )
+		{
+			diff0 = X[j] - c0[j];
+			diff1 = X[j] - c1[j];
+			partial0 += diff0*diff0;
+			partial1 += diff1*diff1;
+			j++;
+		}
+
+		score[i] = partial0;
+		if( partial0 < least )
+		{
+			least = partial0;
+			guess = i;
+		}
+
+		if( i + 1 < Number )
+		{
+			score[i + 1] = partial1;
+			if( partial1 < least )
+			{
+				least = partial1;
+				guess = i + 1;
+			}
+		}
+		i += 2;
+	}
+
+	best = guess;
+	score[best] = fullDistance( &Centroids[(size_t)best*D], x, D );
+	bound = score[best]*( 1.0 + PARTIAL_MARGIN );
+
+	// Centroids within the bound, collected without branches
+	count = 0;
+	i = 0;
+
+	while( i < Number )
+	{
+		Candidates[count] = i;
+		count += score[i] > bound || i == guess ? 0 : 1;
+		i++;
+	}
+
+	k = 0;
+
+	while( k < count )
+	{
+		i = Candidates[k++];
+		centroid = &Permuted[(size_t)i*D];
+		partial = score[i];
+		j = H;
+
+		while( j < D && !( partial > bound ) )
+		{
+			end = j + PARTIAL_BLOCK < D ? j + PARTIAL_BLOCK : D;
+
+			while( j < end )
+			{
+				diff = X[j] - centroid[j];
+				partial += diff*diff;
+				j++;
+			}
+		}
+
+		if( partial > bound )
+		{
+			score[i] = partial;
+			continue;
+		}
+
+		// Full distance in the order of nearest() so ties and rounding match
+		score[i] = fullDistance( &Centroids[(size_t)i*D], x, D );
+
+		if( score[i] < score[best] || ( score[i] == score[best] && i < best ) )
+		{
+			best = i;
+			bound = score[best]*( 1.0 + PARTIAL_MARGIN );
+		}
+	}
+
+	return best;
+}
+
+PartialModel::PartialModel( const Model &model, double beam )
+{
+	vector<double> mean( model.Dimension, 0.0 ), within( model.Dimension, 0.0 ), spread( model.Dimension, 0.0 );
+	unsigned int i = 0, j;
+	double diff, weights = 0.0;
+
+	MixtureNumber = model.MixtureNumber;
+	Dimension = model.Dimension;
+	Head = Dimension < PARTIAL_HEAD ? Dimension : PARTIAL_HEAD;
+	Beam = beam;
+
+	Order.resize( Dimension );
+	Constants.resize( MixtureNumber );
+	Means.resize( (size_t)MixtureNumber*Dimension );
+	Precisions.resize( (size_t)MixtureNumber*Dimension );
+	X.resize( Dimension );
+	Partial.resize( MixtureNumber );
+	Kept.resize( MixtureNumber );
+
+	while( i < MixtureNumber )
+	{
+		weights += model.weights[i];
+		j = 0;
+		while( j < Dimension )
+		{
+			mean[j] += model.weights[i]*model.means[(size_t)i*Dimension + j];
+			within[j] += model.weights[i]*model.variances[(size_t)i*Dimension + j];
+			j++;
+		}
+		i++;
+	}
+
+	// Weighted spread of the means over the average mixture variance
+	i = 0;
+	while( i < MixtureNumber )
+	{
+		j = 0;
+		while( j < Dimension )
+		{
+			diff = model.means[(size_t)i*Dimension + j] - mean[j]/weights;
+			spread[j] += model.weights[i]*diff*diff;
+			j++;
+		}
+		i++;
+	}
+
+	j = 0;
+	while( j < Dimension )
+	{
+		spread[j] /= within[j];
+		j++;
+	}
+
+	spreadOrder( &spread[0], Dimension, &Order[0] );
+
+	i = 0;
+	while( i < MixtureNumber )
+	{
+		const double *var = model.variances + (size_t)i*Dimension;
+		double logdet = 0.0;
+
+		j = 0;
+		while( j < Dimension )
+		{
+			Means[(size_t)i*Dimension + j] = model.means[(size_t)i*Dimension + Order[j]];
+			Precisions[(size_t)i*Dimension + j] = 1.0 / var[Order[j]];
+			logdet += log( var[j] );
+			j++;
+		}
+
+		Constants[i] = log( model.weights[i] ) - 0.5*( logdet + (double)Dimension*log( 2.0*M_PI ) );
+		i++;
+	}
+}
+
+//! Log-likelihood of a single feature vector.
+/*!	\param feature vector (Dimension values).
+	\param log-likelihood of the vector, at most (MixtureNumber - 1)*exp(-Beam) too low.
+	\return false if the best mixture underflows and the vector has to be ignored.
+*/
+
+bool PartialModel::frameLogL( const double *x, double &value )
+{
+	const unsigned int D = Dimension, H = Head;
+	unsigned int i = 0, j, end, k = 0, n = 0, guess = 0;
+	double diff, partial, limit, bestLL, bestExponent, sum;
+	const double *mean, *precision;
+
+	j = 0;
+	while( j < D )
+	{
+		X[j] = x[Order[j]];
+		j++;
+	}
+
+	// Leading dimensions of every mixture, the largest bound is evaluated in full first
+	while( i < MixtureNumber )
+	{
+		mean = &Means[(size_t)i*D];
+		precision = &Precisions[(size_t)i*D];
+		partial = 0.0;
+		j = 0;
+
+		while( j < H )
+		{
+			diff = X[j] - mean[j];
+			partial += diff*diff*precision[j];
+			j++;
+		}
+
+		Partial[i] = partial;
+		guess = Constants[i] - 0.5*partial > Constants[guess] - 0.5*Partial[guess] ? i : guess;
+		i++;
+	}
+
+	bestLL = -HUGE_VAL;
+	bestExponent = 0.0;
+	i = guess;
+
+	while( n < MixtureNumber )
+	{
+		// Dropped once the partial distance exceeds this limit
+		limit = 2.0*( Constants[i] - bestLL + Beam );
+		partial = Partial[i];
+
+		if( !( partial > limit ) )
+		{
+			mean = &Means[(size_t)i*D];
+			precision = &Precisions[(size_t)i*D];
+			j = H;
+
+			while( j < D && !( partial > limit ) )
+			{
+				end = j + PARTIAL_BLOCK < D ? j + PARTIAL_BLOCK : D;
+
+				while( j < end )
+				{
+					diff = X[j] - mean[j];
+					partial += diff*diff*precision[j];
+					j++;
+				}
+			}
+		}
+
+		if( !( partial > limit ) )
+		{
+			Kept[k] = Constants[i] - 0.5*partial;
+
+			if( Kept[k] > bestLL )
+			{
+				bestLL = Kept[k];
+				bestExponent = -0.5*partial;
+			}
+			k++;
+		}
+
+		// Guess first, then all other mixtures in order
+		n++;
+		i = n == 1 ? 0 : i + 1;
+		i += i == guess ? 1 : 0;
+	}
+
+	if( bestExponent < SCORE_UNDERFLOW )
+	{
+		return false;
+	}
+
+	sum = 0.0;
+	i = 0;
+
+	while( i < k )
+	{
+		sum += exp( Kept[i++] - bestLL );
+	}
+
+	value = bestLL + log( sum );
+
+	return true;
+}
+
+//! Accumulate the log-likelihoods of a block of feature vectors, see ::blockLogL().
+
+void PartialModel::blockLogL( const double *frames, unsigned int number, double &LL, unsigned int &processed, unsigned int &ignored )
+{
+	ProfileTimer timer( PHASE_SCORE );
+	unsigned int T = 0, scored = 0;
+	double value;
+
+	while( T < number )
+	{
+		if( frameLogL( frames + (size_t)T*Dimension, value ) )
+		{
+			scored++;
+			LL += value;
+		}
+		T++;
+	}
+
+	processed += scored;
+	ignored += number - scored;
+	profileCount( COUNT_SCORED, scored );
+	profileCount( COUNT_IGNORED, number - scored );
+	profileWork( PHASE_SCORE, (unsigned long long)number*MixtureNumber );
+}
+
+//! Average log-likelihood of single precision feature vectors held in memory, see ::averageLogL().
+
+double PartialModel::averageLogL( const float *frames, unsigned int number, unsigned int &ignored )
+{
+	ProfileTimer timer( PHASE_SCORE );
+	vector<double> frame( Dimension );
+	unsigned int T = 0, j, processed = 0;
+	double LL = 0.0, value;
+
+	ignored = 0;
+
+	while( T < number )
+	{
+		j = 0;
+		while( j < Dimension )
+		{
+			frame[j] = (double)frames[(size_t)T*Dimension + j];
+			j++;
+		}
+
+		if( frameLogL( &frame[0], value ) )
+		{
+			processed++;
+			LL += value;
+		}
+		else
+		{
+			ignored++;
+		}
+		T++;
+	}
+
+	profileCount( COUNT_SCORED, processed );
+	profileCount( COUNT_IGNORED, ignored );
+	profileWork( PHASE_SCORE, (unsigned long long)number*MixtureNumber );
+
+	return LL/(double)processed;
+}
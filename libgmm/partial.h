@@ -0,0 +1,105 @@
+#ifndef PARTIAL_H
+#define PARTIAL_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include "model.h"
+
+//! Number of leading dimensions summed for every centroid (mixture) before the first check.
+//! The best partial sum picks the candidate whose full distance sets the bound.
+
+#define PARTIAL_HEAD 8
+
+//! Number of dimensions summed between two partial distance checks after the leading ones.
+
+#define PARTIAL_BLOCK 4
+
+//! Relative margin of the kmeans partial distance check. Partial sums are taken in another
+//! order than the full distances, the margin covers their rounding difference.
+
+#define PARTIAL_MARGIN 1e-9
+
+//! Dimensions sorted by decreasing spread, the most discriminative dimension first.
+/*!	\param spread of every dimension.
+	\param feature vector dimension.
+	\param dimension order.
+*/
+
+void spreadOrder( const double *, unsigned int, unsigned int * );
+
+//! Nearest centroid search with partial distance elimination (kmeans).
+//! Dimensions are visited in decreasing order of the centroid spread. The leading
+//! dimensions are summed for every centroid, the centroid with the smallest partial
+//! distance is taken as first guess and its full distance becomes the bound. Every other
+//! centroid is abandoned at the first block boundary where its partial distance exceeds
+//! the best full distance. Centroids that survive get their full distance in the natural
+//! order, so the result is exactly the one of nearest(). The centroids are copied, the
+//! codebook has to be rebuilt when they move.
+
+class PartialCodebook {
+	public:
+		//! Constructor.
+		/*!	\param centroids.
+			\param number of centroids.
+			\param feature vector dimension.
+		*/
+		PartialCodebook( const double *const *, unsigned int, unsigned int );
+
+		unsigned int nearest( const float *, double * );
+
+		unsigned int Number;		//!< Number of centroids.
+		unsigned int Dimension;		//!< Feature vector dimension.
+
+	private:
+
+		vector<unsigned int> Order;	//!< Dimension order of the partial sums.
+		vector<double> Centroids;	//!< Centroids (Number*Dimension).
+		vector<double> Permuted;	//!< Centroids in dimension order (Number*Dimension).
+		vector<double> X;		//!< Feature vector in dimension order.
+		vector<unsigned int> Candidates;	//!< Centroids within the bound after the leading dimensions.
+		unsigned int Head;		//!< Leading dimensions summed for every centroid.
+};
+
+//! Bounded-error log-likelihood scoring with partial distance elimination (gmmscore -B).
+//! Mixtures are evaluated in the log domain with dimensions in decreasing order of the mean
+//! spread over the average variance. The leading dimensions are summed for every mixture,
+//! the mixture with the largest bound is evaluated in full first. Every other mixture is
+//! dropped at the first block boundary where the bound on its log-likelihood falls more than
+//! the beam below the best mixture so far. Each dropped mixture is smaller than exp(-beam)
+//! times the best one, so the log-likelihood of a feature vector is at most
+//! (MixtureNumber - 1)*exp(-beam) too low. A feature vector is ignored when the exponent of
+//! its best mixture underflows (SCORE_UNDERFLOW), frameLogL() ignores it as soon as any
+//! mixture does. The parameters are copied, the scorer has to be rebuilt when the model
+//! changes.
+
+class PartialModel {
+	public:
+		//! Constructor.
+		/*!	\param model.
+			\param pruning beam (natural log).
+		*/
+		PartialModel( const Model &, double );
+
+		bool frameLogL( const double *, double & );
+		void blockLogL( const double *, unsigned int, double &, unsigned int &, unsigned int & );
+		double averageLogL( const float *, unsigned int, unsigned int & );
+
+		unsigned int MixtureNumber;	//!< The mixture number of the model.
+		unsigned int Dimension;		//!< The dimension of the feature vector.
+		double Beam;			//!< Pruning beam.
+
+	private:
+
+		vector<unsigned int> Order;	//!< Dimension order of the partial sums.
+		vector<double> Constants;	//!< log( weight*normalisation ) of every mixture.
+		vector<double> Means;		//!< Means in dimension order (MixtureNumber*Dimension).
+		vector<double> Precisions;	//!< Inverse variances in dimension order (MixtureNumber*Dimension).
+		vector<double> X;		//!< Feature vector in dimension order.
+		vector<double> Partial;		//!< Partial distances over the leading dimensions.
+		vector<double> Kept;		//!< Log-likelihoods of the mixtures within the beam.
+		unsigned int Head;		//!< Leading dimensions summed for every mixture.
+};
+
+#endif
@@ -0,0 +1,445 @@
+#include "profile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <vector>
+#include <mutex>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+using std::vector;
+
+bool profileEnabled = false;
+static bool Hardware = false;		//!< Count hardware events in every thread.
+
+static const char *PhaseNames[PHASE_NUMBER] = { "open", "header", "decode", "score", "estep", "mstep", "output" };
+static const char *CounterNames[COUNT_NUMBER] = { "files", "bytes", "frames", "scored", "ignored" };
+static const char *EventNames[EVENT_NUMBER] = { "cycles", "instructions", "cache_misses", "l1d_misses", "branch_misses" };
+
+//! perf_event_open type and config of the hardware events.
+
+static const unsigned int EventTypes[EVENT_NUMBER] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE };
+static const unsigned long long EventConfigs[EVENT_NUMBER] = {
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_CACHE_L1D | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ),
+	PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static std::mutex Lock;			//!< Guards the record list and the progress line.
+static vector<ProfileRecord *> Records;	//!< Records of all threads, kept until exit.
+static thread_local ProfileRecord *Local = NULL;
+
+static double Started = 0.0;		//!< Time instrumentation was enabled.
+static double ProgressInterval = 0.0;	//!< Seconds between progress lines, 0 for none.
+static double ProgressNext = 0.0;	//!< Time of the next progress line.
+static unsigned long long Expected = 0;	//!< Feature vectors expected in total, 0 if unknown.
+
+//! Monotonic clock.
+/*!	\return seconds.
+*/
+
+double profileClock()
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+}
+
+//! Open the hardware event group of the calling thread.
+/*!	\param thread record.
+	\return 0 or the errno of the group leader (cycles).
+*/
+
+static int openGroup( ProfileRecord &r )
+{
+	struct perf_event_attr attr;
+	unsigned int i = 0, slot = 0;
+	int fd;
+
+	r.Group = -1;
+
+	while( i < EVENT_NUMBER )
+	{
+		memset( &attr, 0, sizeof( attr ) );
+		attr.size = sizeof( attr );
+		attr.type = EventTypes[i];
+		attr.config = EventConfigs[i];
+		attr.disabled = ( r.Group < 0 );
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		fd = syscall( SYS_perf_event_open, &attr, 0, -1, r.Group, 0 );
+		r.Slot[i] = -1;
+
+		if( fd >= 0 )
+		{
+			if( r.Group < 0 )
+			{
+				r.Group = fd;
+			}
+			r.Slot[i] = slot++;
+		}
+		else if( r.Group < 0 )
+		{
+			// Without the leader no event of the group can be counted
+			return errno;
+		}
+		i++;
+	}
+
+	ioctl( r.Group, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+
+	return 0;
+}
+
+//! Record of the calling thread, registered on first use.
+
+static ProfileRecord &record()
+{
+	if( Local == NULL )
+	{
+		Local = new ProfileRecord();
+		Local->Group = -1;
+
+		if( Hardware )
+		{
+			openGroup( *Local );
+		}
+
+		std::lock_guard<std::mutex> guard( Lock );
+		Records.push_back( Local );
+	}
+
+	return *Local;
+}
+
+//! Start collecting timers and counters.
+
+void profileEnable()
+{
+	Started = profileClock();
+	profileEnabled = true;
+}
+
+//! Count hardware events (cycles, instructions, cache and branch misses) in every timed phase.
+//! Must be called before the first timer of any thread.
+/*!	\param error message if the events cannot be counted.
+	\return false if perf events are not available.
+*/
+
+bool profileHardware( string &error )
+{
+	ProfileRecord probe = ProfileRecord();
+	int status = openGroup( probe );
+
+	if( status != 0 )
+	{
+		error = string( "perf_event_open: " ) + strerror( status );
+		return false;
+	}
+
+	close( probe.Group );
+	Hardware = true;
+
+	return true;
+}
+
+//! Read the hardware event group of a thread.
+/*!	\param thread record.
+	\param snapshot: time enabled, time running, events.
+*/
+
+static void readGroup( const ProfileRecord &r, unsigned long long *snapshot )
+{
+	unsigned long long buffer[3 + EVENT_NUMBER];
+	unsigned int i = 0;
+
+	memset( snapshot, 0, sizeof( unsigned long long )*PROFILE_SNAPSHOT );
+
+	if( r.Group < 0 || read( r.Group, buffer, sizeof( buffer ) ) <= 0 )
+	{
+		return;
+	}
+
+	// Group read format: number of events, time enabled, time running, values
+	snapshot[0] = buffer[1];
+	snapshot[1] = buffer[2];
+
+	while( i < EVENT_NUMBER )
+	{
+		if( r.Slot[i] >= 0 )
+		{
+			snapshot[2 + i] = buffer[3 + r.Slot[i]];
+		}
+		i++;
+	}
+}
+
+//! Start a timed section.
+/*!	\param start time.
+	\param hardware event snapshot (PROFILE_SNAPSHOT values).
+*/
+
+void profileStart( double &start, unsigned long long *snapshot )
+{
+	if( Hardware )
+	{
+		readGroup( record(), snapshot );
+	}
+	start = profileClock();
+}
+
+//! End a timed section, add its time and hardware events to a phase of the calling thread.
+/*!	\param phase.
+	\param start time.
+	\param hardware event snapshot taken at the start.
+*/
+
+void profileStop( ProfilePhase phase, double start, const unsigned long long *snapshot )
+{
+	double seconds = profileClock() - start;
+	ProfileRecord &r = record();
+
+	r.Time[phase] += seconds;
+	r.Calls[phase]++;
+
+	if( Hardware && r.Group >= 0 )
+	{
+		unsigned long long now[PROFILE_SNAPSHOT];
+		unsigned int i = 0;
+
+		readGroup( r, now );
+
+		// Scale for multiplexing: the group only counted while it was running
+		double running = (double)( now[1] - snapshot[1] );
+		double scale = running > 0.0 ? (double)( now[0] - snapshot[0] )/running : 0.0;
+
+		while( i < EVENT_NUMBER )
+		{
+			r.Events[phase][i] += scale*(double)( now[2 + i] - snapshot[2 + i] );
+			i++;
+		}
+	}
+}
+
+//! Add frame x mixture evaluations to a phase of the calling thread.
+/*!	\param phase.
+	\param number of evaluations.
+*/
+
+void profileWork( ProfilePhase phase, unsigned long long pairs )
+{
+	if( profileEnabled )
+	{
+		record().Work[phase] += pairs;
+	}
+}
+
+//! Print the progress line if it is due.
+
+static void progress( bool final )
+{
+	double now = profileClock();
+
+	if( !final && now < ProgressNext )
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard( Lock );
+	unsigned long long frames = 0;
+	unsigned int i = 0;
+
+	if( !final && now < ProgressNext )
+	{
+		return;
+	}
+	ProgressNext = now + ProgressInterval;
+
+	while( i < Records.size() )
+	{
+		frames += Records[i++]->Count[COUNT_FRAMES];
+	}
+
+	double rate = frames / ( now - Started > 0.0 ? now - Started : 1e-9 );
+
+	fprintf( stderr, "\r%llu frames  %.0f frames/s", frames, rate );
+
+	if( Expected > frames && rate > 0.0 )
+	{
+		fprintf( stderr, "  ETA %.0f s   ", ( Expected - frames ) / rate );
+	}
+	else if( Expected > 0 )
+	{
+		fprintf( stderr, "  ETA 0 s   " );
+	}
+
+	if( final )
+	{
+		fprintf( stderr, "\n" );
+	}
+}
+
+//! Add to a counter of the calling thread.
+/*!	\param counter.
+	\param value.
+*/
+
+void profileCount( ProfileCounter counter, unsigned long long value )
+{
+	if( !profileEnabled )
+	{
+		return;
+	}
+
+	record().Count[counter] += value;
+
+	if( counter == COUNT_FRAMES && ProgressInterval > 0.0 )
+	{
+		progress( false );
+	}
+}
+
+//! Print a progress line with frames/s and ETA to stderr while feature vectors are read.
+/*!	\param seconds between progress lines.
+	\param feature vectors expected in total, 0 if unknown.
+*/
+
+void profileProgress( double interval, unsigned long long expected )
+{
+	ProgressInterval = interval;
+	ProgressNext = profileClock() + interval;
+	Expected = expected;
+}
+
+static void writeRecord( FILE *out, const ProfileRecord &r )
+{
+	unsigned int i = 0, j;
+
+	fprintf( out, "{\"phases\":{" );
+	while( i < PHASE_NUMBER )
+	{
+		fprintf( out, "%s\"%s\":{\"seconds\":%.6f,\"calls\":%llu", i ? "," : "", PhaseNames[i], r.Time[i], r.Calls[i] );
+
+		if( r.Work[i] > 0 )
+		{
+			fprintf( out, ",\"pairs\":%llu,\"ns_per_pair\":%.4f", r.Work[i], 1e9*r.Time[i]/(double)r.Work[i] );
+		}
+
+		if( Hardware )
+		{
+			for( j = 0; j < EVENT_NUMBER; j++ )
+			{
+				fprintf( out, ",\"%s\":%.0f", EventNames[j], r.Events[i][j] );
+			}
+
+			if( r.Events[i][EVENT_CYCLES] > 0.0 )
+			{
+				fprintf( out, ",\"ipc\":%.4f", r.Events[i][EVENT_INSTRUCTIONS]/r.Events[i][EVENT_CYCLES] );
+			}
+
+			if( r.Work[i] > 0 )
+			{
+				for( j = 0; j < EVENT_NUMBER; j++ )
+				{
+					fprintf( out, ",\"%s_per_pair\":%.6f", EventNames[j], r.Events[i][j]/(double)r.Work[i] );
+				}
+			}
+		}
+		fprintf( out, "}" );
+		i++;
+	}
+
+	fprintf( out, "},\"counters\":{" );
+	i = 0;
+	while( i < COUNT_NUMBER )
+	{
+		fprintf( out, "%s\"%s\":%llu", i ? "," : "", CounterNames[i], r.Count[i] );
+		i++;
+	}
+
+	fprintf( out, "},\"io_seconds\":%.6f,\"compute_seconds\":%.6f}",
+		r.Time[PHASE_OPEN] + r.Time[PHASE_HEADER] + r.Time[PHASE_DECODE] + r.Time[PHASE_OUTPUT],
+		r.Time[PHASE_SCORE] + r.Time[PHASE_ESTEP] + r.Time[PHASE_MSTEP] );
+}
+
+//! Write the timers and counters, summed over all threads and per thread, as JSON.
+//! Ends the progress line.
+/*!	\param report file name, - for stderr, empty for no report.
+	\return false if the report file cannot be written.
+*/
+
+bool profileReport( string file )
+{
+	if( ProgressInterval > 0.0 )
+	{
+		progress( true );
+	}
+
+	if( file.empty() )
+	{
+		return true;
+	}
+
+	FILE *out = file == "-" ? stderr : fopen( file.c_str(), "w" );
+
+	if( out == NULL )
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> guard( Lock );
+	ProfileRecord total = ProfileRecord();
+	unsigned int i = 0, j, k;
+
+	while( i < Records.size() )
+	{
+		for( j = 0; j < PHASE_NUMBER; j++ )
+		{
+			total.Time[j] += Records[i]->Time[j];
+			total.Calls[j] += Records[i]->Calls[j];
+			total.Work[j] += Records[i]->Work[j];
+
+			for( k = 0; k < EVENT_NUMBER; k++ )
+			{
+				total.Events[j][k] += Records[i]->Events[j][k];
+			}
+		}
+		for( j = 0; j < COUNT_NUMBER; j++ )
+		{
+			total.Count[j] += Records[i]->Count[j];
+		}
+		i++;
+	}
+
+	fprintf( out, "{\"wall_seconds\":%.6f,\"threads\":%u,\"hardware\":%s,\"total\":", profileClock() - Started, (unsigned int)Records.size(), Hardware ? "true" : "false" );
+	writeRecord( out, total );
+	fprintf( out, ",\"per_thread\":[" );
+
+	i = 0;
+	while( i < Records.size() )
+	{
+		if( i > 0 )
+		{
+			fprintf( out, "," );
+		}
+		writeRecord( out, *Records[i] );
+		i++;
+	}
+	fprintf( out, "]}\n" );
+
+	if( out != stderr )
+	{
+		return fclose( out ) == 0;
+	}
+
+	return true;
+}
@@ -0,0 +1,103 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include <string>
+
+using std::string;
+
+//! Instrumented phases.
+
+enum ProfilePhase {
+	PHASE_OPEN,		//!< feature file open
+	PHASE_HEADER,		//!< feature file header read
+	PHASE_DECODE,		//!< feature vector read and conversion
+	PHASE_SCORE,		//!< log-likelihood scoring
+	PHASE_ESTEP,		//!< EM statistics accumulation
+	PHASE_MSTEP,		//!< model update from the statistics
+	PHASE_OUTPUT,		//!< model and results output
+	PHASE_NUMBER
+};
+
+//! Instrumented counters.
+
+enum ProfileCounter {
+	COUNT_FILES,		//!< feature files opened
+	COUNT_BYTES,		//!< feature bytes read
+	COUNT_FRAMES,		//!< feature vectors read
+	COUNT_SCORED,		//!< feature vectors scored or accumulated
+	COUNT_IGNORED,		//!< feature vectors ignored (underflow)
+	COUNT_NUMBER
+};
+
+//! Hardware events counted per phase (perf_event_open).
+
+enum ProfileEvent {
+	EVENT_CYCLES,		//!< CPU cycles
+	EVENT_INSTRUCTIONS,	//!< retired instructions
+	EVENT_CACHE_MISSES,	//!< last level cache misses
+	EVENT_L1D_MISSES,	//!< level 1 data cache read misses
+	EVENT_BRANCH_MISSES,	//!< mispredicted branches
+	EVENT_NUMBER
+};
+
+//! Timers and counters of one thread.
+
+typedef struct {
+	double			Time[PHASE_NUMBER];	//!< seconds spent per phase.
+	unsigned long long	Calls[PHASE_NUMBER];	//!< timed sections per phase.
+	unsigned long long	Work[PHASE_NUMBER];	//!< frame x mixture evaluations per phase.
+	unsigned long long	Count[COUNT_NUMBER];	//!< counter values.
+	double			Events[PHASE_NUMBER][EVENT_NUMBER];	//!< hardware events per phase.
+	int			Group;			//!< perf event group of the thread, -1 if none.
+	int			Slot[EVENT_NUMBER];	//!< position of each event in the group, -1 if not counted.
+}ProfileRecord;
+
+//! Size of a hardware event snapshot: time enabled, time running and one value per event.
+
+#define PROFILE_SNAPSHOT ( 2 + EVENT_NUMBER )
+
+//! Instrumentation is collected only once enabled, disabled timers cost one branch.
+
+extern bool profileEnabled;
+
+void profileEnable();
+bool profileHardware( string & );
+double profileClock();
+void profileStart( double &, unsigned long long * );
+void profileStop( ProfilePhase, double, const unsigned long long * );
+void profileWork( ProfilePhase, unsigned long long );
+void profileCount( ProfileCounter, unsigned long long );
+void profileProgress( double, unsigned long long );
+bool profileReport( string );
+
+//! Scoped timer, adds the lifetime of the object (and its hardware events) to a phase of the calling thread.
+
+class ProfileTimer {
+	public:
+		ProfileTimer( ProfilePhase phase ) : Phase( phase )
+		{
+			if( profileEnabled )
+			{
+				profileStart( Start, Snapshot );
+			}
+		}
+
+		~ProfileTimer()
+		{
+			if( profileEnabled )
+			{
+				profileStop( Phase, Start, Snapshot );
+			}
+		}
+
+	private:
+		ProfilePhase Phase;
+		double Start;
+		unsigned long long Snapshot[PROFILE_SNAPSHOT];
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include <cmath>
+
+//! Small deterministic random generator (xorshift) so synthetic data is identical on every machine.
+
+class Random {
+	public:
+		//! Constructor.
+		/*!	\param seed.
+		*/
+		Random( unsigned long long seed ) { State = seed*2862933555777941757ULL + 3037000493ULL; }
+
+		//! Uniform value in [0,1).
+		double uniform()
+		{
+			State ^= State << 13;
+			State ^= State >> 7;
+			State ^= State << 17;
+			return (double)( State >> 11 ) / 9007199254740992.0;
+		}
+
+		//! Standard normal value (Box-Muller).
+		double gauss()
+		{
+			double u = uniform();
+
+			while( u <= 0.0 )
+			{
+				u = uniform();
+			}
+			return sqrt( -2.0*log( u ) ) * cos( 2.0*M_PI*uniform() );
+		}
+
+	private:
+		unsigned long long State;
+};
+
+#endif
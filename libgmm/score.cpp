@@ -0,0 +1,61 @@
+#include "score.h"
+#include "profile.h"
+#include "kernels.h"
+
+bool frameLogL( const Model &model, const double *x, double *PR, double &value )
+{
+	return model.Kernels->FrameLogL( model, x, PR, value );
+}
+
+void blockLogL( const Model &model, const double *frames, unsigned int number, double *PR, double &LL, unsigned int &processed, unsigned int &ignored )
+{
+	ProfileTimer timer( PHASE_SCORE );
+	unsigned int scored = model.Kernels->BlockLogL( model, frames, number, PR, LL );
+
+	processed += scored;
+	ignored += number - scored;
+	profileCount( COUNT_SCORED, scored );
+	profileCount( COUNT_IGNORED, number - scored );
+	profileWork( PHASE_SCORE, (unsigned long long)number*model.MixtureNumber );
+}
+
+double averageLogL( const Model &model, const float *frames, unsigned int number, double *frame, double *PR, unsigned int &ignored )
+{
+	ProfileTimer timer( PHASE_SCORE );
+	unsigned int T = 0, j, processed = 0;
+	double LL = 0.0, value;
+
+	ignored = 0;
+
+	while( T < number )
+	{
+		j = 0;
+		while( j < model.Dimension )
+		{
+			frame[j] = (double)frames[(size_t)T*model.Dimension + j];
+			j++;
+		}
+
+		if( model.Kernels->FrameLogL( model, frame, PR, value ) )
+		{
+			processed++;
+			LL += value;
+		}
+		else
+		{
+			ignored++;
+		}
+		T++;
+	}
+
+	profileCount( COUNT_SCORED, processed );
+	profileCount( COUNT_IGNORED, ignored );
+	profileWork( PHASE_SCORE, (unsigned long long)number*model.MixtureNumber );
+
+	return LL/(double)processed;
+}
+
+unsigned int nearest( const double *const *centroids, unsigned int number, unsigned int dims, const float *x, double *score )
+{
+	return selectKernels( dims )->Nearest( centroids, number, dims, x, score );
+}
@@ -0,0 +1,59 @@
+#ifndef SCORE_H
+#define SCORE_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include "model.h"
+
+//! Feature vectors whose mixture exponent falls below this value are ignored.
+
+#define SCORE_UNDERFLOW -700.0
+
+//! Log-likelihood of a single feature vector.
+/*!	\param model.
+	\param feature vector (Dimension values).
+	\param weighted mixture likelihoods (MixtureNumber values), scratch space the caller owns.
+	\param log-likelihood of the vector.
+	\return false if a mixture underflows and the vector has to be ignored.
+*/
+
+bool frameLogL( const Model &, const double *, double *, double & );
+
+//! Accumulate the log-likelihoods of a block of feature vectors.
+/*!	\param model.
+	\param feature vectors, one after the other.
+	\param number of feature vectors.
+	\param mixture scratch space (MixtureNumber values).
+	\param log-likelihood sum, accumulated.
+	\param number of scored feature vectors, accumulated.
+	\param number of ignored feature vectors, accumulated.
+*/
+
+void blockLogL( const Model &, const double *, unsigned int, double *, double &, unsigned int &, unsigned int & );
+
+//! Average log-likelihood of single precision feature vectors held in memory.
+/*!	\param model.
+	\param feature vectors, one after the other.
+	\param number of feature vectors.
+	\param feature vector scratch space (Dimension values).
+	\param mixture scratch space (MixtureNumber values).
+	\param number of ignored feature vectors.
+	\return average log-likelihood of the scored feature vectors.
+*/
+
+double averageLogL( const Model &, const float *, unsigned int, double *, double *, unsigned int & );
+
+//! Nearest centroid (squared euclidean distance).
+/*!	\param centroids.
+	\param number of centroids.
+	\param feature vector dimension.
+	\param feature vector.
+	\param distance to every centroid.
+	\return index of the first nearest centroid.
+*/
+
+unsigned int nearest( const double *const *, unsigned int, unsigned int, const float *, double * );
+
+#endif
@@ -0,0 +1,342 @@
+#include "sidecar.h"
+#include "score.h"
+#include "htk.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+
+Sidecar::Sidecar()
+{
+	MixtureNumber = 0;
+	Top = 0;
+	Frames = 0;
+	FeatureHash = 0;
+	ModelHash = 0;
+	Cached = false;
+}
+
+int Sidecar::fail( string message, int code )
+{
+	Error = message;
+	return code;
+}
+
+//! Load the sidecar of an utterance from the cache directory, compute and store it if missing.
+/*!	\param UBM.
+	\param content hash of the UBM file.
+	\param mixtures stored per feature vector.
+	\param feature file.
+	\param cache directory, empty to compute without storing.
+	\param feature vectors read at a time.
+	\return 0 or a negative error code.
+*/
+
+int Sidecar::prepare( const Model &ubm, unsigned long long ubmHash, unsigned int top, string featureFile, string cacheDir, unsigned int block )
+{
+	unsigned long long featureHash = fileHash( featureFile );
+	string name;
+	int status;
+
+	if( featureHash == 0 )
+	{
+		return fail( "Sidecar(): Cannot open data file " + featureFile, -1000 );
+	}
+
+	Cached = false;
+
+	if( !cacheDir.empty() )
+	{
+		name = sidecarName( cacheDir, featureHash, ubmHash, top );
+
+		if( load( name, featureHash, ubmHash, top, ubm.MixtureNumber ) == 0 )
+		{
+			Cached = true;
+			return 0;
+		}
+	}
+
+	status = compute( ubm, top, featureFile, block );
+
+	if( status != 0 )
+	{
+		return status;
+	}
+
+	FeatureHash = featureHash;
+	ModelHash = ubmHash;
+
+	return cacheDir.empty() ? 0 : save( name );
+}
+
+//! Orders mixtures by decreasing weighted likelihood.
+
+namespace {
+
+struct LikelihoodOrder {
+	LikelihoodOrder( const double *PR ) : Likelihoods( PR ) {}
+
+	bool operator()( unsigned short a, unsigned short b ) const { return Likelihoods[a] > Likelihoods[b] || ( Likelihoods[a] == Likelihoods[b] && a < b ); }
+
+	const double *Likelihoods;
+};
+
+}
+
+//! UBM pass over a feature file.
+/*!	\param UBM.
+	\param mixtures stored per feature vector.
+	\param feature file.
+	\param feature vectors read at a time.
+	\return 0 or a negative error code.
+*/
+
+int Sidecar::compute( const Model &ubm, unsigned int top, string featureFile, unsigned int block )
+{
+	const unsigned int M = ubm.MixtureNumber, D = ubm.Dimension;
+	HTKReader reader;
+	vector<double> frames( (size_t)block*D ), PR( M );
+	vector<unsigned short> order( M );
+	unsigned int number, T, i;
+	double value;
+
+	if( M > SIDECAR_MIXTURES || top == 0 || top > M )
+	{
+		return fail( "Sidecar(): Top mixture number must be between 1 and the UBM mixture number (at most 65536)", -1001 );
+	}
+
+	if( !reader.open( featureFile ) )
+	{
+		return fail( "Sidecar(): Cannot open data file " + featureFile, -1000 );
+	}
+
+	MixtureNumber = M;
+	Top = top;
+	Frames = 0;
+	LL.clear();
+	Index.clear();
+
+	while( ( number = reader.read( &frames[0], block, D ) ) > 0 )
+	{
+		ProfileTimer timer( PHASE_SCORE );
+		T = 0;
+
+		while( T < number )
+		{
+			LL.push_back( -HUGE_VAL );
+			Index.resize( Index.size() + Top, 0 );
+
+			if( frameLogL( ubm, &frames[(size_t)T*D], &PR[0], value ) )
+			{
+				i = 0;
+				while( i < M )
+				{
+					order[i] = (unsigned short)i;
+					i++;
+				}
+
+				std::partial_sort( order.begin(), order.begin() + Top, order.end(), LikelihoodOrder( &PR[0] ) );
+				std::copy( order.begin(), order.begin() + Top, Index.end() - Top );
+				LL.back() = value;
+			}
+			T++;
+		}
+		Frames += number;
+		profileWork( PHASE_SCORE, (unsigned long long)number*M );
+	}
+
+	reader.close();
+
+	return 0;
+}
+
+//! Load a sidecar file.
+/*!	\param sidecar file name.
+	\param expected content hash of the feature file.
+	\param expected content hash of the UBM file.
+	\param expected mixtures per feature vector.
+	\param expected UBM mixture number.
+	\return 0 or a negative error code; -1002 if the file is missing.
+*/
+
+int Sidecar::load( string sidecarFile, unsigned long long featureHash, unsigned long long ubmHash, unsigned int top, unsigned int mixtures )
+{
+	ProfileTimer timer( PHASE_OPEN );
+	ifstream Fside( sidecarFile.c_str(), ios_base::binary );
+	SidecarHeader Hside;
+
+	if( !Fside )
+	{
+		return fail( "Sidecar(): Cannot open sidecar file " + sidecarFile, -1002 );
+	}
+
+	Fside.read( reinterpret_cast<char *>( &Hside ), sizeof( SidecarHeader ) );
+
+	if( !Fside || Hside.Magic != SIDECAR_MAGIC || Hside.FeatureHash != featureHash || Hside.ModelHash != ubmHash || Hside.Top != top || Hside.MixtureNumber != mixtures )
+	{
+		return fail( "Sidecar(): Sidecar file " + sidecarFile + " does not belong to this data file and UBM", -1003 );
+	}
+
+	MixtureNumber = Hside.MixtureNumber;
+	Top = Hside.Top;
+	Frames = Hside.Frames;
+	FeatureHash = Hside.FeatureHash;
+	ModelHash = Hside.ModelHash;
+	LL.resize( Frames );
+	Index.resize( (size_t)Frames*Top );
+
+	// An empty utterance has no body
+	if( Frames > 0 )
+	{
+		Fside.read( reinterpret_cast<char *>( &LL[0] ), sizeof( double )*Frames );
+		Fside.read( reinterpret_cast<char *>( &Index[0] ), sizeof( unsigned short )*Index.size() );
+	}
+
+	if( !Fside )
+	{
+		return fail( "Sidecar(): Sidecar file " + sidecarFile + " is truncated", -1004 );
+	}
+
+	return 0;
+}
+
+//! Save as sidecar file.
+//! The file is written under a temporary name and renamed, so processes scoring the same
+//! utterance at the same time never read a partial sidecar.
+/*!	\param sidecar file name.
+	\return 0 or a negative error code.
+*/
+
+int Sidecar::save( string sidecarFile )
+{
+	ProfileTimer timer( PHASE_OUTPUT );
+	stringstream temporary;
+	SidecarHeader Hside;
+
+	temporary << sidecarFile << "." << getpid();
+
+	ofstream Fside( temporary.str().c_str(), ios_base::binary );
+
+	if( !Fside )
+	{
+		return fail( "Sidecar(): Cannot open sidecar file " + temporary.str(), -1005 );
+	}
+
+	Hside.Magic = SIDECAR_MAGIC;
+	Hside.MixtureNumber = MixtureNumber;
+	Hside.Top = Top;
+	Hside.Frames = Frames;
+	Hside.FeatureHash = FeatureHash;
+	Hside.ModelHash = ModelHash;
+
+	Fside.write( reinterpret_cast<char *>( &Hside ), sizeof( SidecarHeader ) );
+	if( Frames > 0 )
+	{
+		Fside.write( reinterpret_cast<char *>( &LL[0] ), sizeof( double )*Frames );
+		Fside.write( reinterpret_cast<char *>( &Index[0] ), sizeof( unsigned short )*Index.size() );
+	}
+	Fside.close();
+
+	if( !Fside || rename( temporary.str().c_str(), sidecarFile.c_str() ) != 0 )
+	{
+		remove( temporary.str().c_str() );
+		return fail( "Sidecar(): Cannot write sidecar file " + sidecarFile, -1005 );
+	}
+
+	return 0;
+}
+
+//! Sum of the UBM log-likelihoods of the utterance.
+/*!	\param number of scored feature vectors, accumulated.
+	\param number of ignored feature vectors, accumulated.
+	\return log-likelihood sum.
+*/
+
+double Sidecar::worldLL( unsigned int &processed, unsigned int &ignored ) const
+{
+	unsigned int T = 0;
+	double sum = 0.0;
+
+	while( T < Frames )
+	{
+		if( LL[T] != -HUGE_VAL )
+		{
+			sum += LL[T];
+			processed++;
+		}
+		else
+		{
+			ignored++;
+		}
+		T++;
+	}
+
+	return sum;
+}
+
+string sidecarName( string cacheDir, unsigned long long featureHash, unsigned long long ubmHash, unsigned int top )
+{
+	char name[64];
+
+	snprintf( name, sizeof( name ), "/%016llx-%016llx-%u.top", featureHash, ubmHash, top );
+
+	return cacheDir + name;
+}
+
+bool topLogL( const Model &model, const double *x, const unsigned short *index, unsigned int number, double *PR, double &value )
+{
+	const unsigned int Dimension = model.Dimension;
+	double enorm, diff, sum;
+	unsigned int k = 0, i, j;
+	const double *mean, *var;
+
+	while( k < number )
+	{
+		i = index[k];
+		mean = model.means + (size_t)i*Dimension;
+		var = model.variances + (size_t)i*Dimension;
+		value = 0.0;
+		j = 0;
+
+		while( j < Dimension )
+		{
+			diff = x[j] - mean[j];
+			value += diff*diff / var[j];
+			j++;
+		}
+		value *= -0.5;
+
+		if( value < SCORE_UNDERFLOW )
+		{
+			return false;
+		}
+
+		enorm = 1.0;
+		j = 0;
+
+		while( j < Dimension )
+		{
+			enorm *= var[j++];
+		}
+
+		enorm = sqrt( enorm );
+		enorm *= pow( 2.0*M_PI, (double)Dimension / 2.0 );
+		enorm = pow( enorm, -1.0 );
+		PR[k] = exp(value)*enorm*model.weights[i];
+
+		k++;
+	}
+
+	sum = 0.0;
+	k = 0;
+
+	while( k < number )
+	{
+		sum += PR[k++];
+	}
+
+	value = log( sum );
+
+	return true;
+}
@@ -0,0 +1,90 @@
+#ifndef SIDECAR_H
+#define SIDECAR_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include "model.h"
+
+//! Sidecar file identifier.
+
+#define SIDECAR_MAGIC 0x43504F54
+
+//! Largest mixture number a sidecar can index (16 bit mixture indices).
+
+#define SIDECAR_MIXTURES 65536
+
+//! Sidecar file header.
+//! The header is followed by the UBM log-likelihood of every feature vector (double,
+//! -HUGE_VAL for ignored vectors) and the Top best UBM mixtures of every feature vector
+//! (unsigned short, best first).
+
+typedef struct {
+	unsigned int	Magic,		//!< sidecar identifier (SIDECAR_MAGIC).
+			MixtureNumber,	//!< UBM mixture number.
+			Top,		//!< mixtures stored per feature vector.
+			Frames;		//!< feature vectors.
+	unsigned long long	FeatureHash,	//!< content hash of the feature file.
+				ModelHash;	//!< content hash of the UBM file.
+}SidecarHeader;
+
+//! UBM frame log-likelihoods and top-C mixtures of one utterance.
+//! Scoring a model adapted from a UBM only needs the mixtures that dominate the UBM
+//! likelihood of a feature vector (topLogL()). The UBM pass is done once per utterance and
+//! kept in a sidecar file named after the feature file and UBM content hashes, so every
+//! later scoring of the utterance against models of the same UBM reuses it. Functions
+//! return 0 or a negative error code and leave a message in Error.
+
+class Sidecar {
+	public:
+		Sidecar();
+
+		int prepare( const Model &, unsigned long long, unsigned int, string, string, unsigned int );
+		int compute( const Model &, unsigned int, string, unsigned int );
+		int load( string, unsigned long long, unsigned long long, unsigned int, unsigned int );
+		int save( string );
+
+		double worldLL( unsigned int &, unsigned int & ) const;
+
+		unsigned int MixtureNumber;	//!< UBM mixture number.
+		unsigned int Top;		//!< Mixtures stored per feature vector.
+		unsigned int Frames;		//!< Feature vectors of the utterance.
+		unsigned long long FeatureHash;	//!< Content hash of the feature file.
+		unsigned long long ModelHash;	//!< Content hash of the UBM file.
+		bool Cached;			//!< prepare() found the sidecar file.
+
+		vector<double> LL;		//!< UBM log-likelihood of every feature vector, -HUGE_VAL if ignored.
+		vector<unsigned short> Index;	//!< Top best UBM mixtures of every feature vector (Frames*Top).
+
+		string Error;		//!< Message of the last error.
+
+	private:
+
+		int fail( string, int );
+};
+
+//! Sidecar file name of an utterance.
+/*!	\param cache directory.
+	\param content hash of the feature file.
+	\param content hash of the UBM file.
+	\param mixtures stored per feature vector.
+	\return file name.
+*/
+
+string sidecarName( string, unsigned long long, unsigned long long, unsigned int );
+
+//! Log-likelihood of a single feature vector over a set of mixtures.
+//! Mixtures are evaluated as by ::frameLogL(), the other ones are taken as zero.
+/*!	\param model.
+	\param feature vector (Dimension values).
+	\param mixtures to evaluate.
+	\param number of mixtures.
+	\param weighted mixture likelihoods (number values), scratch space the caller owns.
+	\param log-likelihood of the vector.
+	\return false if one of the mixtures underflows and the vector has to be ignored.
+*/
+
+bool topLogL( const Model &, const double *, const unsigned short *, unsigned int, double *, double & );
+
+#endif
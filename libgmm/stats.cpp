@@ -0,0 +1,331 @@
+#include "stats.h"
+#include "score.h"
+#include "profile.h"
+#include "kernels.h"
+
+#include <algorithm>
+
+Stats::Stats( unsigned int mixtures, unsigned int length, Arena *arena )
+{
+	MixtureNumber = mixtures;
+	Dimension = length;
+	Private = NULL;
+
+	if( arena == NULL )
+	{
+		arena = Private = new Arena();
+	}
+
+	Block = arena->doubles( statsNumber( MixtureNumber, Dimension ) );
+
+	N = Block;
+	DDA = N + MixtureNumber;
+	PR = DDA + MixtureNumber;
+	CPweights = PR + MixtureNumber;
+	EX = CPweights + MixtureNumber;
+	EX2 = EX + MixtureNumber*Dimension;
+	CPmeans = EX2 + MixtureNumber*Dimension;
+	CPvariances = CPmeans + MixtureNumber*Dimension;
+
+	Kept = static_cast< unsigned int * >( arena->allocate( MixtureNumber*sizeof( unsigned int ) ) );
+	TopNumber = 0;
+	Threshold = 0.0;
+	DiscardedMass = 0.0;
+
+	VectorProcessNumber = 0;
+	VectorsIgnored = 0;
+}
+
+//! Orders mixture indices by decreasing likelihood.
+
+namespace {
+
+struct LikelihoodOrder {
+	LikelihoodOrder( const double *PR ) : Likelihoods( PR ) {}
+
+	bool operator()( unsigned int a, unsigned int b ) const { return Likelihoods[a] > Likelihoods[b]; }
+
+	const double *Likelihoods;
+};
+
+}
+
+//! Accumulate only the largest posteriors of every feature vector.
+//! Mixtures whose posterior is below the threshold are dropped, of the rest only the top
+//! ones are kept; the kept posteriors are renormalised to sum to one. The most likely
+//! mixture is always kept.
+/*!	\param number of posteriors kept per feature vector, 0 for all.
+	\param posterior threshold, 0 for none.
+*/
+
+void Stats::prune( unsigned int top, double threshold )
+{
+	TopNumber = top;
+	Threshold = threshold;
+}
+
+//! E-step for one feature vector.
+/*!	\param model.
+	\param feature vector.
+	\return false if the vector underflows and was ignored.
+*/
+
+bool Stats::accumulate( const Model &model, const double *x )
+{
+	double value, sum = 0.0;
+	unsigned int i;
+
+	if( !frameLogL( model, x, PR, value ) )
+	{
+		VectorsIgnored++;
+		return false;
+	}
+
+	VectorProcessNumber++;
+
+	i = 0;
+	while( i < MixtureNumber )
+	{
+		sum += PR[i++];
+	}
+
+	if( TopNumber == 0 && Threshold <= 0.0 )
+	{
+		model.Kernels->Moments( MixtureNumber, Dimension, sum, PR, N, x, EX, EX2 );
+		return true;
+	}
+
+	double floor = Threshold*sum, kept = 0.0;
+	unsigned int count = 0, best = 0, k;
+
+	i = 0;
+	while( i < MixtureNumber )
+	{
+		if( PR[i] >= floor )
+		{
+			Kept[count++] = i;
+		}
+		if( PR[i] > PR[best] )
+		{
+			best = i;
+		}
+		i++;
+	}
+
+	if( count == 0 )
+	{
+		Kept[count++] = best;
+	}
+
+	if( TopNumber > 0 && count > TopNumber )
+	{
+		std::nth_element( Kept, Kept + TopNumber, Kept + count, LikelihoodOrder( PR ) );
+		count = TopNumber;
+		std::sort( Kept, Kept + count );
+	}
+
+	k = 0;
+	while( k < count )
+	{
+		kept += PR[Kept[k++]];
+	}
+
+	DiscardedMass += 1.0 - kept/sum;
+
+	// Posteriors of the kept mixtures, zero for the dropped ones
+	i = 0;
+	k = 0;
+	while( i < MixtureNumber )
+	{
+		if( k < count && Kept[k] == i )
+		{
+			PR[i] /= kept;
+			k++;
+		}
+		else
+		{
+			PR[i] = 0.0;
+		}
+		i++;
+	}
+
+	model.Kernels->SparseMoments( count, Kept, Dimension, PR, N, x, EX, EX2 );
+
+	return true;
+}
+
+//! Turn the moment sums into expectations.
+
+void Stats::normalize()
+{
+	unsigned int i = 0, j;
+
+	while( i < MixtureNumber )
+	{
+		j = 0;
+		// Mixtures pruned from every feature vector keep zero moments
+		while( j < Dimension && N[i] > 0.0 )
+		{
+			EX[i*Dimension + j] /= N[i];
+			EX2[i*Dimension + j] /= N[i];
+			j++;
+		}
+		i++;
+	}
+}
+
+//! Maximum likelihood M-step.
+
+void Stats::train( Model &model )
+{
+	ProfileTimer timer( PHASE_MSTEP );
+	unsigned int i = 0, j, k;
+
+	normalize();
+
+	while( i < MixtureNumber )
+	{
+		N[i++] /= VectorProcessNumber;
+	}
+
+	i = 0;
+
+	while( i < MixtureNumber )
+	{
+		j = 0;
+		// A mixture without statistics keeps its parameters and gets zero weight
+		while( j < Dimension && N[i] > 0.0 )
+		{
+			k = i*Dimension + j;
+			EX2[k] -= EX[k]*EX[k];
+
+			if( EX2[k] < model.globalvars[j] )
+			{
+				EX2[k] = model.globalvars[j];
+			}
+
+			model.means[k] = EX[k];
+			model.variances[k] = EX2[k];
+			j++;
+		}
+
+		model.weights[i] = N[i];
+		i++;
+	}
+}
+
+//! MAP adaption M-step.
+/*!	\param model.
+	\param adapt 1 (weights), 2 (means), 4 (variances).
+*/
+
+void Stats::adapt( Model &model, unsigned int flag )
+{
+	ProfileTimer timer( PHASE_MSTEP );
+	unsigned int i = 0, j, k;
+	double sum = 0.0;
+
+	normalize();
+
+	while( i < MixtureNumber )
+	{
+		DDA[i] = N[i] / ( N[i] + MAP_RELEVANCE );
+		N[i] /= VectorProcessNumber;
+		i++;
+	}
+
+	if( flag & 2 || flag & 4 )
+	{
+		i = 0;
+		while( i < MixtureNumber*Dimension )
+		{
+			CPmeans[i] = model.means[i];
+			CPvariances[i] = model.variances[i];
+			i++;
+		}
+	}
+
+	if( flag & 1 )
+	{
+		i = 0;
+		while( i < MixtureNumber )
+		{
+			CPweights[i] = model.weights[i];
+			model.weights[i] = DDA[i]*N[i] + ( 1.0 - DDA[i] )*CPweights[i];
+			sum += model.weights[i];
+			i++;
+		}
+
+		i = 0;
+		while( i < MixtureNumber )
+		{
+			model.weights[i++] /= sum;
+		}
+	}
+
+	if( flag & 2 )
+	{
+		i = 0;
+		while( i < MixtureNumber )
+		{
+			j = 0;
+			while( j < Dimension )
+			{
+				k = i*Dimension + j;
+				model.means[k] = DDA[i]*EX[k] + ( 1.0 - DDA[i] ) * CPmeans[k];
+				j++;
+			}
+			i++;
+		}
+	}
+
+	if( flag & 4 )
+	{
+		i = 0;
+		while( i < MixtureNumber )
+		{
+			j = 0;
+			while( j < Dimension )
+			{
+				k = i*Dimension + j;
+				model.variances[k] = DDA[i]*EX2[k] + ( 1.0 - DDA[i] ) * ( CPmeans[k]*CPmeans[k] + CPvariances[k] ) - model.means[k]*model.means[k];
+
+				if( model.variances[k] < model.globalvars[j] )
+				{
+					model.variances[k] = model.globalvars[j];
+				}
+				j++;
+			}
+			i++;
+		}
+	}
+}
+
+//! Clear the statistics for the next iteration.
+
+void Stats::reset()
+{
+	unsigned int i = 0;
+
+	while( i < MixtureNumber )
+	{
+		N[i++] = 0.0;
+	}
+
+	i = 0;
+	while( i < MixtureNumber*Dimension )
+	{
+		EX[i] = 0.0;
+		EX2[i] = 0.0;
+		i++;
+	}
+
+	DiscardedMass = 0.0;
+	VectorProcessNumber = 0;
+	VectorsIgnored = 0;
+}
+
+Stats::~Stats()
+{
+	delete Private;
+}
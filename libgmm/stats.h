@@ -0,0 +1,86 @@
+#ifndef STATS_H
+#define STATS_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include "model.h"
+
+//! Relevance factor of MAP adaption.
+
+#define MAP_RELEVANCE 16.0
+
+//! Number of doubles in the statistics block: N, DDA, PR and CPweights (mixtures each),
+//! EX, EX2, CPmeans and CPvariances (mixtures*length each).
+/*!	\param mixture number.
+	\param feature vector dimension.
+	\return size of the block.
+*/
+
+inline size_t statsNumber( unsigned int mixtures, unsigned int length )
+{
+	return (size_t)mixtures*( 4 + 4*(size_t)length );
+}
+
+//! Arena bytes of the statistics: block and pruning index buffer.
+/*!	\param mixture number.
+	\param feature vector dimension.
+	\return bytes.
+*/
+
+inline size_t statsSize( unsigned int mixtures, unsigned int length )
+{
+	return arenaSize( statsNumber( mixtures, length ) ) + arenaSize( mixtures, sizeof( unsigned int ) );
+}
+
+//! EM statistics.
+//! Accumulates the zeroth, first and second order statistics of the mixtures (E-step) and
+//! updates a model from them by maximum likelihood training or MAP adaption (M-step).
+
+class Stats {
+	public:
+		//! Constructor.
+		/*!	\param Model mixture number.
+			\param Feature vector dimension.
+			\param Arena the statistics block is carved from, NULL for a private one.
+		*/
+		Stats( unsigned int, unsigned int, Arena * =NULL );
+
+		void prune( unsigned int, double );
+		bool accumulate( const Model &, const double * );
+		void train( Model & );
+		void adapt( Model &, unsigned int );
+		void reset();
+
+		~Stats();
+
+		double *N;		//!< Mixture occupation (MixtureNumber).
+		double *EX;		//!< first moment (MixtureNumber*Dimension).
+		double *EX2;		//!< second moment (MixtureNumber*Dimension).
+		double *DDA;		//!< Adaption factor of the last MAP update (MixtureNumber).
+		double *PR;		//!< Posteriors of the last accumulated vector (MixtureNumber), zero if pruned.
+
+		unsigned int VectorProcessNumber;	//!< The number of feature vectors accumulated.
+		unsigned int VectorsIgnored;	//!< The number of feature vectors ignored.
+		double DiscardedMass;	//!< Posterior mass dropped by pruning, summed over the accumulated vectors.
+
+	private:
+
+		void normalize();
+
+		unsigned int MixtureNumber;	//!< The mixture number of the model.
+		unsigned int Dimension;		//!< The dimension of the feature vector.
+
+		double *Block;		//!< Statistics block.
+		Arena *Private;		//!< Arena of the statistics block if the statistics own it, else NULL.
+		double *CPweights;	//!< Copy of model weights.
+		double *CPmeans;	//!< Copy of model means.
+		double *CPvariances;	//!< Copy of model variances.
+
+		unsigned int *Kept;	//!< Mixtures kept by pruning (MixtureNumber).
+		unsigned int TopNumber;	//!< Posteriors kept per feature vector, 0 for all.
+		double Threshold;	//!< Posteriors below this value are dropped.
+};
+
+#endif
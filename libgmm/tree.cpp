@@ -0,0 +1,777 @@
+#include "tree.h"
+#include "score.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <map>
+
+GaussianTree::GaussianTree()
+{
+	Dimension = 0;
+	NodeNumber = 0;
+	LeafNumber = 0;
+}
+
+int GaussianTree::fail( string message, int code )
+{
+	Error = message;
+	return code;
+}
+
+//! Load a tree-structured VQ codebook.
+//! Same text format as the flat codebooks of kmeans with codebook type VQ_TREE: global means
+//! and variances, the header (magic, type, covariance kind, node number, streams, stream
+//! width) and per node "stream vqidx nodeId leftId rightId", mean and variance. A child id
+//! of 0 means no child; leaves have no children and a vqidx from 1 to the leaf number.
+/*!	\param codebook file name.
+	\param feature vector dimension.
+	\return 0 or a negative error code.
+*/
+
+int GaussianTree::load( string treeFile, unsigned int length )
+{
+	ifstream Ftree( treeFile.c_str() );
+	string word;
+	unsigned int i, j, magic, type, covkind, nodes, streams, width;
+
+	if( !Ftree )
+	{
+		return fail( "LoadTree(): Cannot open tree codebook file " + treeFile + " .", -900 );
+	}
+
+	Dimension = length;
+	globalmeans.resize( Dimension );
+	globalvars.resize( Dimension );
+
+	Ftree >> word >> word;	// Global mean:
+	for( j = 0; j < Dimension; j++ )
+	{
+		Ftree >> globalmeans[j];
+	}
+
+	Ftree >> word >> word;	// Global variance:
+	for( j = 0; j < Dimension; j++ )
+	{
+		Ftree >> globalvars[j];
+	}
+
+	Ftree >> magic >> type >> covkind >> nodes >> streams >> width;
+
+	if( !Ftree )
+	{
+		return fail( "LoadTree(): Tree codebook file " + treeFile + " is truncated", -906 );
+	}
+
+	if( type != VQ_TREE )
+	{
+		return fail( "LoadTree(): " + treeFile + " is not a tree-structured VQ codebook.", -901 );
+	}
+
+	if( covkind != 1 )
+	{
+		return fail( "LoadTree(): File contains non-diagonal covariance values.", -902 );
+	}
+
+	if( streams != 1 || width != Dimension || nodes == 0 )
+	{
+		return fail( "LoadTree(): Tree codebook reports one stream of the feature vector dimension.", -903 );
+	}
+
+	vector<unsigned int> ids( nodes ), leftIds( nodes ), rightIds( nodes ), vqidx( nodes );
+	vector<double> fileMeans( (size_t)nodes*Dimension ), fileVariances( (size_t)nodes*Dimension );
+	std::map<unsigned int, unsigned int> position;
+
+	for( i = 0; i < nodes; i++ )
+	{
+		Ftree >> streams >> vqidx[i] >> ids[i] >> leftIds[i] >> rightIds[i];
+
+		for( j = 0; j < Dimension; j++ )
+		{
+			Ftree >> fileMeans[(size_t)i*Dimension + j];
+		}
+		for( j = 0; j < Dimension; j++ )
+		{
+			Ftree >> fileVariances[(size_t)i*Dimension + j];
+		}
+
+		if( ids[i] == 0 || !position.insert( std::make_pair( ids[i], i ) ).second )
+		{
+			return fail( "LoadTree(): Tree codebook file " + treeFile + " has invalid node ids", -904 );
+		}
+	}
+
+	if( !Ftree )
+	{
+		return fail( "LoadTree(): Tree codebook file " + treeFile + " is truncated", -906 );
+	}
+
+	// The root is the only node that is nobody's child
+	vector<unsigned int> parents( nodes, 0 );
+	unsigned int root = nodes;
+
+	LeafNumber = 0;
+
+	for( i = 0; i < nodes; i++ )
+	{
+		if( ( leftIds[i] == 0 ) != ( rightIds[i] == 0 ) || ( leftIds[i] != 0 && ( position.count( leftIds[i] ) == 0 || position.count( rightIds[i] ) == 0 ) ) )
+		{
+			return fail( "LoadTree(): Tree codebook file " + treeFile + " has nodes with a missing child", -904 );
+		}
+
+		if( leftIds[i] != 0 )
+		{
+			parents[position[leftIds[i]]]++;
+			parents[position[rightIds[i]]]++;
+		}
+		else
+		{
+			LeafNumber++;
+		}
+	}
+
+	for( i = 0; i < nodes; i++ )
+	{
+		if( parents[i] > 1 || ( parents[i] == 0 && root != nodes ) )
+		{
+			return fail( "LoadTree(): Tree codebook file " + treeFile + " is not a tree", -904 );
+		}
+		root = parents[i] == 0 ? i : root;
+	}
+
+	if( root == nodes )
+	{
+		return fail( "LoadTree(): Tree codebook file " + treeFile + " is not a tree", -904 );
+	}
+
+	// Renumber in preorder so the root is node 0
+	vector<unsigned int> stack( 1, root ), seen( LeafNumber, 0 );
+	unsigned int node, k;
+
+	NodeNumber = nodes;
+	means.resize( (size_t)NodeNumber*Dimension );
+	variances.resize( (size_t)NodeNumber*Dimension );
+	Left.assign( NodeNumber, 0 );
+	Right.assign( NodeNumber, 0 );
+	Index.assign( NodeNumber, 0 );
+
+	vector<unsigned int> parent( NodeNumber, 0 ), side( NodeNumber, 0 );
+	k = 0;
+
+	while( !stack.empty() )
+	{
+		i = stack.back();
+		stack.pop_back();
+		node = k++;
+
+		std::copy( fileMeans.begin() + (size_t)i*Dimension, fileMeans.begin() + (size_t)( i + 1 )*Dimension, means.begin() + (size_t)node*Dimension );
+		std::copy( fileVariances.begin() + (size_t)i*Dimension, fileVariances.begin() + (size_t)( i + 1 )*Dimension, variances.begin() + (size_t)node*Dimension );
+
+		if( node > 0 )
+		{
+			( side[i] == 0 ? Left : Right )[parent[i]] = node;
+		}
+
+		if( leftIds[i] == 0 )
+		{
+			if( vqidx[i] == 0 || vqidx[i] > LeafNumber || seen[vqidx[i] - 1]++ != 0 )
+			{
+				return fail( "LoadTree(): Tree codebook file " + treeFile + " has invalid leaf indices", -905 );
+			}
+			Index[node] = vqidx[i] - 1;
+		}
+		else
+		{
+			parent[position[rightIds[i]]] = node;
+			side[position[rightIds[i]]] = 1;
+			stack.push_back( position[rightIds[i]] );
+			parent[position[leftIds[i]]] = node;
+			side[position[leftIds[i]]] = 0;
+			stack.push_back( position[leftIds[i]] );
+		}
+	}
+
+	if( k != NodeNumber )
+	{
+		return fail( "LoadTree(): Tree codebook file " + treeFile + " is not a tree", -904 );
+	}
+
+	prepare();
+
+	return 0;
+}
+
+//! Save as tree-structured VQ codebook, see load().
+/*!	\param codebook file name.
+	\return 0 or a negative error code.
+*/
+
+int GaussianTree::save( string treeFile )
+{
+	ProfileTimer timer( PHASE_OUTPUT );
+	ofstream Ftree( treeFile.c_str() );
+	unsigned int i, j;
+
+	if( !Ftree )
+	{
+		return fail( "SaveTree(): Cannot open output tree codebook file " + treeFile, -907 );
+	}
+
+	Ftree.precision( 10 );
+	Ftree << "Global mean:" << endl << endl;
+
+	for( j = 0; j < Dimension; j++ )
+	{
+		Ftree << globalmeans[j] << "\t";
+	}
+
+	Ftree << endl << "Global variance:" << endl;
+
+	for( j = 0; j < Dimension; j++ )
+	{
+		Ftree << globalvars[j] << "\t";
+	}
+
+	Ftree << endl << "262 " << VQ_TREE << " 1 " << NodeNumber << " 1 " << Dimension << endl;
+
+	for( i = 0; i < NodeNumber; i++ )
+	{
+		Ftree << "1 " << ( Left[i] == 0 ? Index[i] + 1 : 0 ) << " " << i + 1 << " " << ( Left[i] == 0 ? 0 : Left[i] + 1 ) << " " << ( Right[i] == 0 ? 0 : Right[i] + 1 ) << endl;
+
+		for( j = 0; j < Dimension; j++ )
+		{
+			Ftree << means[(size_t)i*Dimension + j] << " ";
+		}
+		Ftree << endl;
+
+		for( j = 0; j < Dimension; j++ )
+		{
+			Ftree << variances[(size_t)i*Dimension + j] << " ";
+		}
+		Ftree << endl << endl;
+	}
+
+	if( !Ftree )
+	{
+		return fail( "SaveTree(): Cannot write tree codebook file " + treeFile, -907 );
+	}
+
+	return 0;
+}
+
+//! Orders mixture indices by one mean component.
+
+namespace {
+
+struct MeanOrder {
+	MeanOrder( const double *means, unsigned int dims, unsigned int component ) : Means( means ), Dimension( dims ), Component( component ) {}
+
+	bool operator()( unsigned int a, unsigned int b ) const { return Means[(size_t)a*Dimension + Component] < Means[(size_t)b*Dimension + Component]; }
+
+	const double *Means;
+	unsigned int Dimension, Component;
+};
+
+}
+
+//! Mixtures of the left side first.
+
+namespace {
+
+struct SideOrder {
+	SideOrder( const unsigned int *side ) : Side( side ) {}
+
+	bool operator()( unsigned int a ) const { return Side[a] == 0; }
+
+	const unsigned int *Side;
+};
+
+}
+
+//! Build a Gaussian selection tree over the mixtures of a model.
+//! Mixture sets are split in two recursively: first at the weight median along the mean
+//! component with the largest spread relative to the set variance, then refined by
+//! TREE_ITERATIONS 2-means iterations on the means. Every node holds the weighted merge of
+//! its mixtures, the leaves hold the mixtures themselves.
+/*!	\param model.
+	\return 0 or a negative error code.
+*/
+
+int GaussianTree::build( const Model &model )
+{
+	const unsigned int M = model.MixtureNumber, D = model.Dimension;
+	vector<unsigned int> mixtures( M ), stack, ranges, side( M );
+	vector<double> centre( 2*D ), spread( D );
+	unsigned int i, j, k, node, begin, end, best, iteration, count[2];
+	double weight, total, diff, distance[2];
+
+	if( M == 0 )
+	{
+		return fail( "BuildTree(): Model has no mixtures.", -908 );
+	}
+
+	Dimension = D;
+	NodeNumber = 2*M - 1;
+	LeafNumber = M;
+	globalmeans.assign( D, 0.0 );
+	globalvars.assign( D, 0.0 );
+	means.assign( (size_t)NodeNumber*D, 0.0 );
+	variances.assign( (size_t)NodeNumber*D, 0.0 );
+	Left.assign( NodeNumber, 0 );
+	Right.assign( NodeNumber, 0 );
+	Index.assign( NodeNumber, 0 );
+
+	for( i = 0; i < M; i++ )
+	{
+		mixtures[i] = i;
+	}
+
+	// Stack of (parent node, side, begin, end), nodes are numbered in preorder
+	ranges.push_back( 0 );
+	ranges.push_back( 0 );
+	ranges.push_back( 0 );
+	ranges.push_back( M );
+	node = 0;
+
+	while( !ranges.empty() )
+	{
+		end = ranges.back(); ranges.pop_back();
+		begin = ranges.back(); ranges.pop_back();
+		k = ranges.back(); ranges.pop_back();
+		i = ranges.back(); ranges.pop_back();
+
+		if( node > 0 )
+		{
+			( k == 0 ? Left : Right )[i] = node;
+		}
+
+		double *mean = &means[(size_t)node*D], *var = &variances[(size_t)node*D];
+
+		// Weighted merge, uniform weights if the set has no weight at all
+		total = 0.0;
+		for( k = begin; k < end; k++ )
+		{
+			total += model.weights[mixtures[k]];
+		}
+
+		for( k = begin; k < end; k++ )
+		{
+			weight = total > 0.0 ? model.weights[mixtures[k]] / total : 1.0 / (double)( end - begin );
+
+			for( j = 0; j < D; j++ )
+			{
+				mean[j] += weight*model.means[(size_t)mixtures[k]*D + j];
+			}
+		}
+
+		for( j = 0; j < D; j++ )
+		{
+			spread[j] = 0.0;
+		}
+
+		for( k = begin; k < end; k++ )
+		{
+			weight = total > 0.0 ? model.weights[mixtures[k]] / total : 1.0 / (double)( end - begin );
+
+			for( j = 0; j < D; j++ )
+			{
+				diff = model.means[(size_t)mixtures[k]*D + j] - mean[j];
+				var[j] += weight*( model.variances[(size_t)mixtures[k]*D + j] + diff*diff );
+				spread[j] += weight*diff*diff;
+			}
+		}
+
+		if( end - begin == 1 )
+		{
+			Index[node++] = mixtures[begin];
+			continue;
+		}
+
+		// Weight median split along the most spread component
+		best = 0;
+		for( j = 1; j < D; j++ )
+		{
+			best = spread[j]/var[j] > spread[best]/var[best] ? j : best;
+		}
+
+		std::sort( mixtures.begin() + begin, mixtures.begin() + end, MeanOrder( model.means, D, best ) );
+
+		// Right once the weight before a mixture reaches half the set weight, both sides keep one
+		weight = 0.0;
+		for( k = begin; k < end; k++ )
+		{
+			side[mixtures[k]] = k > begin && ( k + 1 == end || weight >= 0.5 ) ? 1 : 0;
+			weight += total > 0.0 ? model.weights[mixtures[k]] / total : 1.0 / (double)( end - begin );
+		}
+
+		// 2-means refinement, variance normalised distances to the two centres
+		for( iteration = 0; iteration < TREE_ITERATIONS; iteration++ )
+		{
+			std::fill( centre.begin(), centre.end(), 0.0 );
+			count[0] = count[1] = 0;
+
+			for( k = begin; k < end; k++ )
+			{
+				count[side[mixtures[k]]]++;
+				for( j = 0; j < D; j++ )
+				{
+					centre[side[mixtures[k]]*D + j] += model.means[(size_t)mixtures[k]*D + j];
+				}
+			}
+
+			for( j = 0; j < D; j++ )
+			{
+				centre[j] /= (double)count[0];
+				centre[D + j] /= (double)count[1];
+			}
+
+			count[0] = count[1] = 0;
+
+			for( k = begin; k < end; k++ )
+			{
+				distance[0] = distance[1] = 0.0;
+
+				for( j = 0; j < D; j++ )
+				{
+					diff = model.means[(size_t)mixtures[k]*D + j] - centre[j];
+					distance[0] += diff*diff / var[j];
+					diff = model.means[(size_t)mixtures[k]*D + j] - centre[D + j];
+					distance[1] += diff*diff / var[j];
+				}
+				count[distance[1] < distance[0] ? 1 : 0]++;
+			}
+
+			// Keep the previous partition if one side would be empty
+			if( count[0] == 0 || count[1] == 0 )
+			{
+				break;
+			}
+
+			for( k = begin; k < end; k++ )
+			{
+				distance[0] = distance[1] = 0.0;
+
+				for( j = 0; j < D; j++ )
+				{
+					diff = model.means[(size_t)mixtures[k]*D + j] - centre[j];
+					distance[0] += diff*diff / var[j];
+					diff = model.means[(size_t)mixtures[k]*D + j] - centre[D + j];
+					distance[1] += diff*diff / var[j];
+				}
+				side[mixtures[k]] = distance[1] < distance[0] ? 1 : 0;
+			}
+		}
+
+		k = std::stable_partition( mixtures.begin() + begin, mixtures.begin() + end, SideOrder( &side[0] ) ) - mixtures.begin();
+
+		// Right child below the left one on the stack, so the left subtree is numbered first
+		ranges.push_back( node ); ranges.push_back( 1 ); ranges.push_back( k ); ranges.push_back( end );
+		ranges.push_back( node ); ranges.push_back( 0 ); ranges.push_back( begin ); ranges.push_back( k );
+		node++;
+	}
+
+	std::copy( means.begin(), means.begin() + D, globalmeans.begin() );
+	std::copy( variances.begin(), variances.begin() + D, globalvars.begin() );
+
+	prepare();
+
+	return 0;
+}
+
+//! Number of levels of the tree.
+
+unsigned int GaussianTree::depth() const
+{
+	vector<unsigned int> level( NodeNumber, 1 );
+	unsigned int i, deepest = 0;
+
+	// Preorder numbering: parents come before their children
+	for( i = 0; i < NodeNumber; i++ )
+	{
+		if( Left[i] != 0 )
+		{
+			level[Left[i]] = level[Right[i]] = level[i] + 1;
+		}
+		deepest = level[i] > deepest ? level[i] : deepest;
+	}
+
+	return deepest;
+}
+
+//! Node normalisation constants and inverse variances for the descent.
+
+void GaussianTree::prepare()
+{
+	unsigned int i, j;
+	double logdet;
+
+	Constants.resize( NodeNumber );
+	Precisions.resize( (size_t)NodeNumber*Dimension );
+
+	for( i = 0; i < NodeNumber; i++ )
+	{
+		logdet = 0.0;
+
+		for( j = 0; j < Dimension; j++ )
+		{
+			Precisions[(size_t)i*Dimension + j] = 1.0 / variances[(size_t)i*Dimension + j];
+			logdet += log( variances[(size_t)i*Dimension + j] );
+		}
+
+		Constants[i] = -0.5*( logdet + (double)Dimension*log( 2.0*M_PI ) );
+	}
+}
+
+double GaussianTree::nodeLogL( unsigned int node, const double *x ) const
+{
+	const double *mean = &means[(size_t)node*Dimension], *precision = &Precisions[(size_t)node*Dimension];
+	double diff, value = 0.0;
+	unsigned int j = 0;
+
+	while( j < Dimension )
+	{
+		diff = x[j] - mean[j];
+		value += diff*diff*precision[j];
+		j++;
+	}
+
+	return Constants[node] - 0.5*value;
+}
+
+//! Orders nodes by decreasing score.
+
+namespace {
+
+struct ScoreOrder {
+	ScoreOrder( const double *scores ) : Scores( scores ) {}
+
+	bool operator()( unsigned int a, unsigned int b ) const { return Scores[a] > Scores[b]; }
+
+	const double *Scores;
+};
+
+}
+
+//! Candidate mixtures of a feature vector.
+//! The tree is descended level by level, of the children of the kept nodes only the width
+//! best (by node log-likelihood) are kept; kept leaves are the candidates.
+/*!	\param feature vector.
+	\param nodes kept per level.
+	\param candidate mixtures (LeafNumber values).
+	\param scratch space (NodeNumber values).
+	\param scratch space (NodeNumber values).
+	\return number of candidates.
+*/
+
+unsigned int GaussianTree::select( const double *x, unsigned int width, unsigned int *candidates, unsigned int *frontier, double *scores ) const
+{
+	unsigned int count, number = 0, n, k, node;
+	unsigned int *next;
+
+	if( NodeNumber == 0 )
+	{
+		return 0;
+	}
+
+	if( Left[0] == 0 )
+	{
+		candidates[0] = Index[0];
+		return 1;
+	}
+
+	frontier[0] = 0;
+	count = 1;
+
+	while( count > 0 )
+	{
+		// Children go behind the current level, two levels never hold more than all nodes
+		next = frontier + count;
+		n = 0;
+
+		for( k = 0; k < count; k++ )
+		{
+			next[n++] = Left[frontier[k]];
+			next[n++] = Right[frontier[k]];
+		}
+
+		for( k = 0; k < n; k++ )
+		{
+			scores[next[k]] = nodeLogL( next[k], x );
+		}
+
+		if( n > width )
+		{
+			std::nth_element( next, next + width, next + n, ScoreOrder( scores ) );
+			n = width;
+		}
+
+		count = 0;
+
+		for( k = 0; k < n; k++ )
+		{
+			node = next[k];
+
+			if( Left[node] == 0 )
+			{
+				candidates[number++] = Index[node];
+			}
+			else
+			{
+				frontier[count++] = node;
+			}
+		}
+	}
+
+	return number;
+}
+
+SelectedModel::SelectedModel( const Model &model, const GaussianTree &tree, unsigned int width ) : Source( model ), Tree( tree )
+{
+	unsigned int i, j;
+	double logdet;
+
+	MixtureNumber = model.MixtureNumber;
+	Dimension = model.Dimension;
+	Width = width > 0 ? width : 1;
+	Candidates = 0;
+
+	Constants.resize( MixtureNumber );
+	Precisions.resize( (size_t)MixtureNumber*Dimension );
+	Selected.resize( MixtureNumber );
+	Frontier.resize( Tree.NodeNumber );
+	Scores.resize( Tree.NodeNumber > MixtureNumber ? Tree.NodeNumber : MixtureNumber );
+
+	for( i = 0; i < MixtureNumber; i++ )
+	{
+		logdet = 0.0;
+
+		for( j = 0; j < Dimension; j++ )
+		{
+			Precisions[(size_t)i*Dimension + j] = 1.0 / model.variances[(size_t)i*Dimension + j];
+			logdet += log( model.variances[(size_t)i*Dimension + j] );
+		}
+
+		Constants[i] = log( model.weights[i] ) - 0.5*( logdet + (double)Dimension*log( 2.0*M_PI ) );
+	}
+}
+
+//! Log-likelihood of a single feature vector over the candidate mixtures.
+/*!	\param feature vector (Dimension values).
+	\param log-likelihood of the vector.
+	\return false if every candidate has zero weight or the best one underflows, the vector
+	has to be ignored.
+*/
+
+bool SelectedModel::frameLogL( const double *x, double &value )
+{
+	unsigned int count, k, i, j;
+	double diff, exponent, bestLL = -HUGE_VAL, bestExponent = 0.0, sum = 0.0;
+	const double *mean, *precision;
+
+	count = Tree.select( x, Width, &Selected[0], &Frontier[0], &Scores[0] );
+	Candidates += count;
+
+	// Scores is free again after the descent, it takes the candidate log-likelihoods
+	for( k = 0; k < count; k++ )
+	{
+		i = Selected[k];
+		mean = Source.means + (size_t)i*Dimension;
+		precision = &Precisions[(size_t)i*Dimension];
+		exponent = 0.0;
+
+		for( j = 0; j < Dimension; j++ )
+		{
+			diff = x[j] - mean[j];
+			exponent += diff*diff*precision[j];
+		}
+		exponent *= -0.5;
+
+		Scores[k] = Constants[i] + exponent;
+
+		if( Scores[k] > bestLL )
+		{
+			bestLL = Scores[k];
+			bestExponent = exponent;
+		}
+	}
+
+	// Zero weight mixtures (MAP adapted without data) score -inf, all of them leave no best
+	if( count == 0 || bestLL == -HUGE_VAL || bestExponent < SCORE_UNDERFLOW )
+	{
+		return false;
+	}
+
+	for( k = 0; k < count; k++ )
+	{
+		sum += exp( Scores[k] - bestLL );
+	}
+
+	value = bestLL + log( sum );
+
+	return true;
+}
+
+//! Accumulate the log-likelihoods of a block of feature vectors, see ::blockLogL().
+
+void SelectedModel::blockLogL( const double *frames, unsigned int number, double &LL, unsigned int &processed, unsigned int &ignored )
+{
+	ProfileTimer timer( PHASE_SCORE );
+	unsigned long long candidates = Candidates;
+	unsigned int T = 0, scored = 0;
+	double value;
+
+	while( T < number )
+	{
+		if( frameLogL( frames + (size_t)T*Dimension, value ) )
+		{
+			scored++;
+			LL += value;
+		}
+		T++;
+	}
+
+	processed += scored;
+	ignored += number - scored;
+	profileCount( COUNT_SCORED, scored );
+	profileCount( COUNT_IGNORED, number - scored );
+	profileWork( PHASE_SCORE, Candidates - candidates );
+}
+
+//! Average log-likelihood of single precision feature vectors held in memory, see ::averageLogL().
+
+double SelectedModel::averageLogL( const float *frames, unsigned int number, unsigned int &ignored )
+{
+	ProfileTimer timer( PHASE_SCORE );
+	unsigned long long candidates = Candidates;
+	vector<double> frame( Dimension );
+	unsigned int T = 0, j, processed = 0;
+	double LL = 0.0, value;
+
+	ignored = 0;
+
+	while( T < number )
+	{
+		j = 0;
+		while( j < Dimension )
+		{
+			frame[j] = (double)frames[(size_t)T*Dimension + j];
+			j++;
+		}
+
+		if( frameLogL( &frame[0], value ) )
+		{
+			processed++;
+			LL += value;
+		}
+		else
+		{
+			ignored++;
+		}
+		T++;
+	}
+
+	profileCount( COUNT_SCORED, processed );
+	profileCount( COUNT_IGNORED, ignored );
+	profileWork( PHASE_SCORE, Candidates - candidates );
+
+	return LL/(double)processed;
+}
@@ -0,0 +1,100 @@
+#ifndef TREE_H
+#define TREE_H
+
+/**
+	@author neil taylor kleynhans <ntkleynhans@csir.co.za>
+*/
+
+#include "model.h"
+
+//! VQ codebook types (second field of the codebook header).
+
+#define VQ_LINEAR	0	//!< flat codebook
+#define VQ_TREE		1	//!< binary tree codebook
+
+//! 2-means iterations per split when a tree is built from a model.
+
+#define TREE_ITERATIONS 5
+
+//! Binary tree of diagonal Gaussians stored as a tree-structured VQ codebook.
+//! Every node holds the Gaussian of the mixtures (clusters) below it, the leaves hold one
+//! mixture each and carry its index (vqidx, 1 based); internal nodes have vqidx 0. Used as
+//! Gaussian selection index over a UBM (see SelectedModel) and as tree codebook of kmeans.
+//! Functions return 0 or a negative error code and leave a message in Error.
+
+class GaussianTree {
+	public:
+		GaussianTree();
+
+		int load( string, unsigned int );
+		int save( string );
+		int build( const Model & );
+
+		unsigned int select( const double *, unsigned int, unsigned int *, unsigned int *, double * ) const;
+		unsigned int depth() const;
+
+		unsigned int Dimension;		//!< Feature vector dimension.
+		unsigned int NodeNumber;	//!< Number of nodes.
+		unsigned int LeafNumber;	//!< Number of leaves (mixtures).
+
+		vector<double> globalmeans;	//!< Global means (Dimension).
+		vector<double> globalvars;	//!< Global variances (Dimension).
+		vector<double> means;		//!< Node means (NodeNumber*Dimension).
+		vector<double> variances;	//!< Node variances (NodeNumber*Dimension).
+		vector<unsigned int> Left;	//!< Left child of every node, 0 for leaves.
+		vector<unsigned int> Right;	//!< Right child of every node, 0 for leaves.
+		vector<unsigned int> Index;	//!< Mixture of every leaf (vqidx - 1), 0 for internal nodes.
+
+		string Error;		//!< Message of the last error.
+
+	private:
+
+		int fail( string, int );
+		void prepare();
+		double nodeLogL( unsigned int, const double * ) const;
+
+		vector<double> Constants;	//!< Log normalisation of every node Gaussian.
+		vector<double> Precisions;	//!< Inverse node variances (NodeNumber*Dimension).
+};
+
+//! Log-likelihood scoring over the mixtures a Gaussian selection tree picks (gmmscore -G).
+//! Per feature vector the tree is descended level by level keeping the Width best nodes,
+//! the leaves reached are the candidate mixtures. The log-likelihood is the log of the sum
+//! of the weighted candidate likelihoods, so it is a lower bound of the full one; with a
+//! Width of at least the number of leaves all mixtures are candidates. A feature vector is
+//! ignored when the exponent of its best candidate underflows (SCORE_UNDERFLOW). The tree
+//! only indexes mixtures, so a UBM tree also selects for the models adapted from the UBM.
+//! The model and the tree must outlive the scorer.
+
+class SelectedModel {
+	public:
+		//! Constructor.
+		/*!	\param model.
+			\param selection tree with one leaf per mixture.
+			\param nodes kept per tree level.
+		*/
+		SelectedModel( const Model &, const GaussianTree &, unsigned int );
+
+		bool frameLogL( const double *, double & );
+		void blockLogL( const double *, unsigned int, double &, unsigned int &, unsigned int & );
+		double averageLogL( const float *, unsigned int, unsigned int & );
+
+		unsigned int MixtureNumber;	//!< The mixture number of the model.
+		unsigned int Dimension;		//!< The dimension of the feature vector.
+		unsigned int Width;		//!< Nodes kept per tree level.
+
+		unsigned long long Candidates;	//!< Candidate mixtures evaluated so far.
+
+	private:
+
+		const Model &Source;		//!< Scored model.
+		const GaussianTree &Tree;	//!< Selection tree.
+
+		vector<double> Constants;	//!< log( weight*normalisation ) of every mixture.
+		vector<double> Precisions;	//!< Inverse variances (MixtureNumber*Dimension).
+		vector<unsigned int> Selected;	//!< Candidate mixtures of the current feature vector.
+		vector<unsigned int> Frontier;	//!< Tree descent scratch space.
+		vector<double> Scores;		//!< Tree descent scratch space.
+};
+
+#endif
@@ -0,0 +1,733 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <valarray>
+#include <cstdlib>
+#include <cmath>
+#include <getopt.h>
+
+#include "model.h"
+#include "htk.h"
+#include "score.h"
+#include "stats.h"
+#include "kernels.h"
+#include "partial.h"
+#include "tree.h"
+#include "sidecar.h"
+#include "random.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+using std::valarray;
+
+//! Golden reference: the original valarray implementation of gmmtrain and gmmscore.
+//! Every backend has to reproduce its log-likelihoods, posteriors, model updates and
+//! cluster assignments within the backend's tolerances.
+
+class Reference {
+	public:
+		Reference( const Model & );
+
+		bool frameLogL( const valarray<double> &, double & );
+		bool accumulate( const valarray<double> & );
+		void train();
+		void adapt( unsigned int );
+		unsigned int nearest( const valarray<double> & );
+
+		unsigned int MixtureNumber;
+		unsigned int Dimension;
+		unsigned int VectorProcessNumber;
+
+		valarray<double> weights, globalvars, PR, N, DDA;
+		vector< valarray<double> > means, variances, EX, EX2;
+};
+
+Reference::Reference( const Model &model )
+{
+	unsigned int i = 0;
+
+	MixtureNumber = model.MixtureNumber;
+	Dimension = model.Dimension;
+	VectorProcessNumber = 0;
+
+	weights = valarray<double>( model.weights, MixtureNumber );
+	globalvars = valarray<double>( model.globalvars, Dimension );
+	PR.resize( MixtureNumber, 0.0 );
+	N.resize( MixtureNumber, 0.0 );
+	DDA.resize( MixtureNumber, 0.0 );
+
+	while( i < MixtureNumber )
+	{
+		means.push_back( valarray<double>( model.means + i*Dimension, Dimension ) );
+		variances.push_back( valarray<double>( model.variances + i*Dimension, Dimension ) );
+		EX.push_back( valarray<double>( 0.0, Dimension ) );
+		EX2.push_back( valarray<double>( 0.0, Dimension ) );
+		i++;
+	}
+}
+
+//! Weighted mixture likelihoods (PR) and log-likelihood of a feature vector.
+
+bool Reference::frameLogL( const valarray<double> &x, double &LL )
+{
+	valarray<double> distance;
+	double value, enorm;
+	unsigned int i = 0, j;
+
+	while( i < MixtureNumber )
+	{
+		distance = x - means[i];
+		distance = pow( distance, 2.0 );
+		distance /= variances[i];
+		value = distance.sum();
+		value *= -0.5;
+
+		if( value < -700.0 )
+		{
+			return false;
+		}
+
+		enorm = 1.0;
+		j = 0;
+
+		while( j < Dimension )
+		{
+			enorm *= variances[i][j++];
+		}
+
+		enorm = sqrt( enorm );
+		enorm *= pow( 2.0*M_PI, (double)Dimension / 2.0 );
+		enorm = pow( enorm, -1.0 );
+		PR[i] = exp( value )*enorm*weights[i];
+		i++;
+	}
+
+	LL = log( PR.sum() );
+
+	return true;
+}
+
+bool Reference::accumulate( const valarray<double> &x )
+{
+	double LL;
+	unsigned int i = 0;
+
+	if( !frameLogL( x, LL ) )
+	{
+		return false;
+	}
+
+	VectorProcessNumber++;
+	PR /= PR.sum();
+	N += PR;
+
+	while( i < MixtureNumber )
+	{
+		EX[i] += PR[i] * x;
+		EX2[i] += PR[i] * pow( x, 2.0 );
+		i++;
+	}
+
+	return true;
+}
+
+void Reference::train()
+{
+	unsigned int i = 0, j;
+
+	while( i < MixtureNumber )
+	{
+		EX[i] /= N[i];
+		EX2[i] /= N[i];
+		i++;
+	}
+
+	N /= VectorProcessNumber;
+
+	for( i = 0; i < MixtureNumber; i++ )
+	{
+		EX2[i] -= pow( EX[i], 2.0 );
+
+		for( j = 0; j < Dimension; j++ )
+		{
+			if( EX2[i][j] < globalvars[j] )
+			{
+				EX2[i][j] = globalvars[j];
+			}
+		}
+
+		means[i] = EX[i];
+		variances[i] = EX2[i];
+	}
+
+	weights = N;
+}
+
+void Reference::adapt( unsigned int flag )
+{
+	vector< valarray<double> > CPmeans = means, CPvariances = variances;
+	valarray<double> CPweights = weights;
+	unsigned int i = 0, j;
+
+	while( i < MixtureNumber )
+	{
+		EX[i] /= N[i];
+		EX2[i] /= N[i];
+		i++;
+	}
+
+	DDA = N / ( N + MAP_RELEVANCE );
+	N /= VectorProcessNumber;
+
+	if( flag & 1 )
+	{
+		weights = DDA*N + ( 1.0 - DDA )*CPweights;
+		weights /= weights.sum();
+	}
+
+	for( i = 0; i < MixtureNumber; i++ )
+	{
+		if( flag & 2 )
+		{
+			means[i] = DDA[i]*EX[i] + ( 1.0 - DDA[i] )*CPmeans[i];
+		}
+
+		if( flag & 4 )
+		{
+			variances[i] = DDA[i]*EX2[i] + ( 1.0 - DDA[i] )*( pow( CPmeans[i], 2.0 ) + CPvariances[i] ) - pow( means[i], 2.0 );
+
+			for( j = 0; j < Dimension; j++ )
+			{
+				if( variances[i][j] < globalvars[j] )
+				{
+					variances[i][j] = globalvars[j];
+				}
+			}
+		}
+	}
+}
+
+//! First nearest mean (kmeans cluster assignment).
+
+unsigned int Reference::nearest( const valarray<double> &x )
+{
+	unsigned int i = 1, best = 0;
+	double score, bestScore = pow( x - means[0], 2.0 ).sum();
+
+	while( i < MixtureNumber )
+	{
+		score = pow( x - means[i], 2.0 ).sum();
+
+		if( score < bestScore )
+		{
+			bestScore = score;
+			best = i;
+		}
+		i++;
+	}
+
+	return best;
+}
+
+//! Allowed difference: a value passes if either bound holds.
+
+typedef struct {
+	double Absolute;
+	double Relative;
+}Tolerance;
+
+//! Kernel backend under test.
+//! Backends implement the scoring, E-step and kmeans kernels over the libgmm Model and
+//! Stats containers; the M-step is always Stats::train / Stats::adapt.
+
+typedef struct {
+	const char *Name;
+	bool (*Score)( const Model &, const double *, double *, double & );	//!< frame log-likelihood, PR = weighted mixture likelihoods.
+	bool (*Accumulate)( Stats &, const Model &, const double * );		//!< E-step of one frame, Stats::PR = posteriors.
+	unsigned int (*Nearest)( const double *const *, unsigned int, unsigned int, const float *, double * );	//!< cluster assignment.
+	Tolerance LL;		//!< frame log-likelihood tolerance.
+	Tolerance Posterior;	//!< posterior tolerance.
+	Tolerance Parameter;	//!< updated model parameter tolerance.
+	const KernelSet *Kernels;	//!< kernels the model uses, NULL for the ones selected at load.
+}Backend;
+
+static bool libAccumulate( Stats &stats, const Model &model, const double *x )
+{
+	return stats.accumulate( model, x );
+}
+
+//! E-step dropping posteriors below 1e-12 (gmmtrain -q): differences are bounded by the
+//! dropped mass.
+
+static bool sparseAccumulate( Stats &stats, const Model &model, const double *x )
+{
+	stats.prune( 0, 1e-12 );
+	return stats.accumulate( model, x );
+}
+
+//! Partial distance elimination with a beam of 25: log-likelihoods are at most
+//! (M - 1)*exp(-25) low, kmeans assignments are exact. The scorer and codebook copy the
+//! parameters, they are rebuilt for every model.
+
+static bool partialScore( const Model &model, const double *x, double *, double &value )
+{
+	static PartialModel *scorer = NULL;
+	static const Model *source = NULL;
+
+	if( source != &model )
+	{
+		delete scorer;
+		scorer = new PartialModel( model, 25.0 );
+		source = &model;
+	}
+
+	return scorer->frameLogL( x, value );
+}
+
+static unsigned int partialNearest( const double *const *centroids, unsigned int number, unsigned int dims, const float *x, double *score )
+{
+	PartialCodebook codebook( centroids, number, dims );
+
+	return codebook.nearest( x, score );
+}
+
+//! Tree selection wide enough to keep every mixture: the log-sum-exp over the candidates
+//! equals the full log-likelihood up to rounding. Tree and scorer are rebuilt for every model.
+
+static bool treeScore( const Model &model, const double *x, double *, double &value )
+{
+	static GaussianTree *tree = NULL;
+	static SelectedModel *scorer = NULL;
+	static const Model *source = NULL;
+
+	if( source != &model )
+	{
+		delete scorer;
+		delete tree;
+		tree = new GaussianTree();
+		tree->build( model );
+		scorer = new SelectedModel( model, *tree, 1U << 30 );
+		source = &model;
+	}
+
+	return scorer->frameLogL( x, value );
+}
+
+//! UBM top-C scoring (gmmscore -C) with every mixture in the top list.
+
+static bool topScore( const Model &model, const double *x, double *PR, double &value )
+{
+	static vector<unsigned short> index;
+	unsigned int i = (unsigned int)index.size();
+
+	while( i < model.MixtureNumber )
+	{
+		index.push_back( (unsigned short)i );
+		i++;
+	}
+
+	return topLogL( model, x, &index[0], model.MixtureNumber, PR, value );
+}
+
+//! Registered backends. Every optimised kernel is added here with its tolerances.
+
+static const Backend Backends[] = {
+	{ "libgmm", frameLogL, libAccumulate, nearest, { 1e-12, 1e-12 }, { 1e-12, 1e-12 }, { 1e-12, 1e-12 }, NULL },
+	{ "generic", frameLogL, libAccumulate, GenericKernels.Nearest, { 1e-12, 1e-12 }, { 1e-12, 1e-12 }, { 1e-12, 1e-12 }, &GenericKernels },
+	{ "sparse", frameLogL, sparseAccumulate, nearest, { 1e-12, 1e-12 }, { 1e-10, 1e-9 }, { 1e-9, 1e-9 }, NULL },
+	{ "partial", partialScore, libAccumulate, partialNearest, { 1e-8, 1e-10 }, { 1e-12, 1e-12 }, { 1e-12, 1e-12 }, NULL },
+	{ "tree", treeScore, libAccumulate, nearest, { 1e-10, 1e-12 }, { 1e-12, 1e-12 }, { 1e-12, 1e-12 }, NULL },
+	{ "top", topScore, libAccumulate, nearest, { 1e-12, 1e-12 }, { 1e-12, 1e-12 }, { 1e-12, 1e-12 }, NULL },
+	{ NULL, NULL, NULL, NULL, { 0, 0 }, { 0, 0 }, { 0, 0 }, NULL }
+};
+
+//! Largest differences of one compared quantity.
+
+class Difference {
+	public:
+		Difference( string name, Tolerance tolerance ) : Name( name ), Limit( tolerance ) { Absolute = Relative = 0.0; Failed = 0; Compared = 0; }
+
+		void add( double value, double reference )
+		{
+			double absolute = fabs( value - reference );
+			double relative = absolute / ( fabs( reference ) > 1e-300 ? fabs( reference ) : 1e-300 );
+
+			Absolute = absolute > Absolute ? absolute : Absolute;
+			Relative = relative > Relative ? relative : Relative;
+			Compared++;
+
+			if( !( absolute <= Limit.Absolute || relative <= Limit.Relative ) )
+			{
+				Failed++;
+			}
+		}
+
+		bool report( string backend )
+		{
+			cout << backend << "\t" << Name << "\t" << Compared << "\t" << Absolute << "\t" << Relative
+				<< "\t" << ( Failed == 0 ? "PASS" : "FAIL" ) << endl;
+			return Failed == 0;
+		}
+
+		string Name;
+		Tolerance Limit;
+		double Absolute, Relative;
+		unsigned long long Failed, Compared;
+};
+
+//! Compare one backend with the reference on a model and a set of feature vectors.
+/*!	\param backend.
+	\param model.
+	\param feature vectors.
+	\param number of feature vectors.
+	\return false if any difference is out of tolerance.
+*/
+
+bool compare( const Backend &backend, const Model &model, const vector<float> &samples, unsigned int number )
+{
+	const unsigned int M = model.MixtureNumber, D = model.Dimension;
+	Reference reference( model );
+	Stats stats( M, D );
+	vector<double> frame( D ), PR( M ), score( M );
+	valarray<double> x( D );
+	vector<const double *> centroids( M );
+	Difference LL( "loglik", backend.LL ), posterior( "posterior", backend.Posterior ), ignored( "ignored", Tolerance() ), assign( "nearest", Tolerance() );
+	unsigned int T = 0, i, j;
+	double value, refValue;
+	bool scored, refScored;
+
+	for( i = 0; i < M; i++ )
+	{
+		centroids[i] = model.means + i*D;
+	}
+
+	while( T < number )
+	{
+		for( j = 0; j < D; j++ )
+		{
+			frame[j] = x[j] = (double)samples[(size_t)T*D + j];
+		}
+
+		// Scoring
+		scored = backend.Score( model, &frame[0], &PR[0], value );
+		refScored = reference.frameLogL( x, refValue );
+		ignored.add( scored, refScored );
+
+		if( scored && refScored )
+		{
+			LL.add( value, refValue );
+		}
+
+		// E-step
+		scored = backend.Accumulate( stats, model, &frame[0] );
+		refScored = reference.accumulate( x );
+
+		if( scored && refScored )
+		{
+			for( i = 0; i < M; i++ )
+			{
+				posterior.add( stats.PR[i], reference.PR[i] );
+			}
+		}
+
+		// kmeans assignment
+		assign.add( backend.Nearest( &centroids[0], M, D, &samples[(size_t)T*D], &score[0] ), reference.nearest( x ) );
+		T++;
+	}
+
+	bool passed = LL.report( backend.Name ) & posterior.report( backend.Name ) & ignored.report( backend.Name ) & assign.report( backend.Name );
+
+	// M-step: EM update and MAP adaption of all parameters from the same statistics
+	Stats adapted( M, D );
+	Model trained( M, D, model.vFloor ), adaptedModel( M, D, model.vFloor );
+	Reference adaptReference( model );
+	const char *names[] = { "em", "map" };
+	unsigned int pass;
+
+	for( pass = 0; pass < 2; pass++ )
+	{
+		Model &updated = pass == 0 ? trained : adaptedModel;
+		Reference &refUpdated = pass == 0 ? reference : adaptReference;
+		Difference weights( string( names[pass] ) + "_weights", backend.Parameter );
+		Difference means( string( names[pass] ) + "_means", backend.Parameter );
+		Difference variances( string( names[pass] ) + "_variances", backend.Parameter );
+
+		for( j = 0; j < D; j++ )
+		{
+			updated.globalvars[j] = model.globalvars[j];
+		}
+
+		for( i = 0; i < M; i++ )
+		{
+			updated.weights[i] = model.weights[i];
+
+			for( j = 0; j < D; j++ )
+			{
+				updated.means[i*D + j] = model.means[i*D + j];
+				updated.variances[i*D + j] = model.variances[i*D + j];
+			}
+		}
+
+		if( pass == 0 )
+		{
+			stats.train( updated );
+			reference.train();
+		}
+		else
+		{
+			for( T = 0; T < number; T++ )
+			{
+				for( j = 0; j < D; j++ )
+				{
+					frame[j] = x[j] = (double)samples[(size_t)T*D + j];
+				}
+				backend.Accumulate( adapted, model, &frame[0] );
+				adaptReference.accumulate( x );
+			}
+			adapted.adapt( updated, 7 );
+			adaptReference.adapt( 7 );
+		}
+
+		for( i = 0; i < M; i++ )
+		{
+			weights.add( updated.weights[i], refUpdated.weights[i] );
+
+			for( j = 0; j < D; j++ )
+			{
+				means.add( updated.means[i*D + j], refUpdated.means[i][j] );
+				variances.add( updated.variances[i*D + j], refUpdated.variances[i][j] );
+			}
+		}
+
+		passed = weights.report( backend.Name ) & passed;
+		passed = means.report( backend.Name ) & passed;
+		passed = variances.report( backend.Name ) & passed;
+	}
+
+	return passed;
+}
+
+//! Synthetic model and feature vectors drawn from it, with a few outliers that underflow.
+/*!	\param model, parameters are overwritten.
+	\param feature vectors.
+	\param number of feature vectors.
+	\param random seed.
+*/
+
+void synthesize( Model &model, vector<float> &samples, unsigned int number, unsigned long long seed )
+{
+	const unsigned int M = model.MixtureNumber, D = model.Dimension;
+	Random generator( seed );
+	unsigned int i, j, T;
+
+	for( j = 0; j < D; j++ )
+	{
+		model.globalvars[j] = model.vFloor;
+	}
+
+	for( i = 0; i < M; i++ )
+	{
+		model.weights[i] = 0.5 + generator.uniform();
+
+		for( j = 0; j < D; j++ )
+		{
+			model.means[i*D + j] = 4.0*generator.uniform() - 2.0;
+			model.variances[i*D + j] = 0.25 + generator.uniform();
+		}
+	}
+
+	double sum = 0.0;
+
+	for( i = 0; i < M; i++ )
+	{
+		sum += model.weights[i];
+	}
+	for( i = 0; i < M; i++ )
+	{
+		model.weights[i] /= sum;
+	}
+
+	samples.resize( (size_t)number*D );
+
+	for( T = 0; T < number; T++ )
+	{
+		i = (unsigned int)( generator.uniform()*M );
+
+		for( j = 0; j < D; j++ )
+		{
+			samples[(size_t)T*D + j] = (float)( model.means[i*D + j] + sqrt( model.variances[i*D + j] )*generator.gauss() );
+
+			if( T % 97 == 96 )
+			{
+				samples[(size_t)T*D + j] += 60.0f;
+			}
+		}
+	}
+}
+
+void printUsage( void )
+{
+	cout << "gmmequiv: help" << endl;
+	cout << endl;
+	cout << "Compares every kernel backend with the reference implementation: frame log-likelihoods," << endl;
+	cout << "posteriors, EM and MAP updates and kmeans assignments. Exits non-zero on any difference" << endl;
+	cout << "beyond the backend tolerances. Uses a synthetic model and corpus unless -i and -l are given." << endl;
+	cout << endl;
+	cout << "-h,  --help\t\tThis message" << endl;
+	cout << "-i,  --input\t\tModel file or VQ codebook (recorded corpus)" << endl;
+	cout << "-t,  --modeltype\tInput init file type 1 = model, 2 = VQ codebook" << endl;
+	cout << "-l,  --list\t\tFile containing data file list (recorded corpus)" << endl;
+	cout << "-m,  --mixture\t\tMixture number (default 64)" << endl;
+	cout << "-d,  --dimension\tFeature vector dimension (default 20)" << endl;
+	cout << "-v,  --vfloor\t\tVariance flooring constant" << endl;
+	cout << "-n,  --number\t\tNumber of feature vectors (default 2000)" << endl;
+	cout << "-r,  --seed\t\tRandom seed of the synthetic corpus (default 1)" << endl;
+
+	exit( -1 );
+}
+
+int main( int argc, char *argv[] )
+{
+	int nextOption;
+
+	const char * shortOptions = "hi:t:l:m:d:v:n:r:";
+
+	const struct option longOptions[] = {
+	{ "help", 0, NULL, 'h' },
+	{ "input", 1, NULL, 'i' },
+	{ "modeltype", 1, NULL, 't' },
+	{ "list", 1, NULL, 'l' },
+	{ "mixture", 1, NULL, 'm' },
+	{ "dimension", 1, NULL, 'd' },
+	{ "vfloor", 1, NULL, 'v' },
+	{ "number", 1, NULL, 'n' },
+	{ "seed", 1, NULL, 'r' },
+	{ NULL, 0, NULL, 0 }
+	};
+
+	string modelFile, listFile;
+	unsigned int modeltype = 1, mixture = 64, dimension = 20, number = 2000, seed = 1;
+	double vfloor = 0.1;
+
+	do {
+		nextOption = getopt_long( argc, argv, shortOptions, longOptions, NULL );
+
+		switch( nextOption )
+		{
+			case 'i':
+				modelFile = optarg;
+				break;
+
+			case 't':
+				modeltype = atoi( optarg );
+				break;
+
+			case 'l':
+				listFile = optarg;
+				break;
+
+			case 'm':
+				mixture = atoi( optarg );
+				break;
+
+			case 'd':
+				dimension = atoi( optarg );
+				break;
+
+			case 'v':
+				vfloor = atof( optarg );
+				break;
+
+			case 'n':
+				number = atoi( optarg );
+				break;
+
+			case 'r':
+				seed = atoi( optarg );
+				break;
+
+			case 'h':
+				printUsage();
+
+			case '?':
+				printUsage();
+
+			case -1:
+				break;
+
+			default:
+				abort();
+		}
+
+	} while( nextOption != -1 );
+
+	if( modelFile.empty() != listFile.empty() || mixture == 0 || dimension == 0 || number == 0 )
+	{
+		cout << "-i and -l go together, -m, -d and -n must be positive" << endl;
+		printUsage();
+	}
+
+	Model model( mixture, dimension, vfloor );
+	vector<float> samples;
+
+	if( modelFile.empty() )
+	{
+		synthesize( model, samples, number, seed );
+	}
+	else
+	{
+		if( model.load( modelFile, modeltype ) != 0 )
+		{
+			cout << model.Error << endl;
+			return -1;
+		}
+
+		vector<string> files;
+		HTKReader reader;
+		unsigned int f = 0, read = 0;
+
+		if( !readList( listFile, files ) )
+		{
+			cout << "Cannot open data list file " << listFile << endl;
+			return -1;
+		}
+
+		samples.resize( (size_t)number*dimension );
+
+		while( f < files.size() && read < number )
+		{
+			if( !reader.open( files[f] ) )
+			{
+				cout << "Cannot open data file " << files[f] << endl;
+				return -1;
+			}
+			read += reader.read( &samples[(size_t)read*dimension], number - read, dimension );
+			f++;
+		}
+		number = read;
+	}
+
+	cout << "backend\tquantity\tcompared\tmax abs\tmax rel\tresult" << endl;
+
+	bool passed = true;
+	unsigned int b = 0;
+
+	const KernelSet *selected = model.Kernels;
+
+	while( Backends[b].Name != NULL )
+	{
+		model.Kernels = Backends[b].Kernels != NULL ? Backends[b].Kernels : selected;
+		passed = compare( Backends[b], model, samples, number ) && passed;
+		b++;
+	}
+
+	cout << ( passed ? "All backends within tolerance" : "Backend differences out of tolerance" ) << endl;
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,727 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+
+#include "model.h"
+#include "htk.h"
+#include "tree.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+using std::ofstream;
+using std::ifstream;
+using std::stringstream;
+
+//! Relative difference allowed between a mode and the single model results (printed scores
+//! have 6 significant digits).
+
+#define MODE_TOLERANCE 1e-5
+
+//! Synthetic corpus size: mixtures, dimension, background speakers, feature vectors per file.
+
+#define MODE_MIXTURE "16"
+#define MODE_DIMENSION "13"
+#define MODE_SPEAKERS "8"
+#define MODE_LENGTH "800"
+
+//! Cohort models, MAP adapted on one background speaker file each.
+
+#define MODE_COHORT 4
+
+//! Tool directory and work directory.
+
+static string binDir, workDir;
+
+//! Number of failed checks.
+
+static unsigned int failures = 0;
+
+//! Run a tool in the work directory, its output goes to <work dir>/<log>.
+/*!	\param log file name.
+	\param tool and arguments.
+	\return exit status, -1 if the tool did not exit normally.
+*/
+
+int run( string log, const vector<string> &args )
+{
+	vector<char *> argv;
+	unsigned int i = 0;
+	int status;
+
+	while( i < args.size() )
+	{
+		argv.push_back( const_cast<char *>( args[i++].c_str() ) );
+	}
+	argv.push_back( NULL );
+
+	pid_t pid = fork();
+
+	if( pid < 0 )
+	{
+		return -1;
+	}
+
+	if( pid == 0 )
+	{
+		int fd = open( ( workDir + "/" + log ).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+		if( fd >= 0 )
+		{
+			dup2( fd, 1 );
+			dup2( fd, 2 );
+			close( fd );
+		}
+
+		if( chdir( workDir.c_str() ) == 0 )
+		{
+			execv( argv[0], &argv[0] );
+		}
+		_exit( 127 );
+	}
+
+	while( waitpid( pid, &status, 0 ) < 0 );
+
+	return WIFEXITED( status ) ? WEXITSTATUS( status ) : -1;
+}
+
+//! Split a command line at spaces.
+
+vector<string> command( string tool, string arguments )
+{
+	stringstream fields( arguments );
+	vector<string> args( 1, binDir + "/" + tool );
+	string field;
+
+	while( fields >> field )
+	{
+		args.push_back( field );
+	}
+
+	return args;
+}
+
+//! Run a tool, exit if it fails.
+
+void step( string log, string tool, string arguments )
+{
+	int status = run( log, command( tool, arguments ) );
+
+	if( status != 0 )
+	{
+		cout << tool << " " << arguments << " failed (" << status << "), see " << workDir << "/" << log << endl;
+		exit( 1 );
+	}
+}
+
+//! Write a list file in the work directory.
+
+void writeList( string name, const vector<string> &lines )
+{
+	ofstream Flist( ( workDir + "/" + name ).c_str() );
+	unsigned int i = 0;
+
+	while( i < lines.size() )
+	{
+		Flist << lines[i++] << endl;
+	}
+}
+
+//! Lines of a results file, split in fields.
+
+vector< vector<string> > readResults( string name )
+{
+	ifstream Fresult( ( workDir + "/" + name ).c_str() );
+	vector< vector<string> > lines;
+	string line, field;
+
+	while( getline( Fresult, line ) )
+	{
+		stringstream fields( line );
+
+		lines.push_back( vector<string>() );
+		while( fields >> field )
+		{
+			lines.back().push_back( field );
+		}
+	}
+
+	return lines;
+}
+
+//! Score of a gmmscore run that writes a single result line.
+/*!	\param log file name.
+	\param gmmscore arguments (without -r).
+	\return last field of the result line.
+*/
+
+double singleScore( string log, string arguments )
+{
+	string results = log + ".res";
+
+	unlink( ( workDir + "/" + results ).c_str() );
+	step( log, "gmmscore", arguments + " -r " + results );
+
+	vector< vector<string> > lines = readResults( results );
+
+	if( lines.size() != 1 || lines[0].empty() )
+	{
+		cout << "gmmscore " << arguments << ": expected one result line" << endl;
+		exit( 1 );
+	}
+
+	return atof( lines[0].back().c_str() );
+}
+
+//! Compare a mode result with the single model reference.
+
+void check( string name, double value, double reference )
+{
+	bool pass = fabs( value - reference ) <= MODE_TOLERANCE*( 1.0 + fabs( reference ) );
+
+	cout << ( pass ? "PASS\t" : "FAIL\t" ) << name << "\t" << value << "\t" << reference << endl;
+	failures += pass ? 0 : 1;
+}
+
+//! Synthetic corpus, UBM, target model and cohort models c0.mdl ... in the work directory.
+
+void corpus()
+{
+	vector<string> cohort, list( 1 );
+	unsigned int k = 0;
+
+	step( "synth.log", "gmmsynth", "-o " + workDir + " -m " MODE_MIXTURE " -d " MODE_DIMENSION " -s " MODE_SPEAKERS " -l " MODE_LENGTH " -t 4" );
+	step( "kmeans.log", "kmeans", "kmeans.cfg" );
+	step( "train_em.log", "gmmtrain", "-i ubm.vq -t 2 -e 1 -l ubm.list -m " MODE_MIXTURE " -d " MODE_DIMENSION " -a 7 -c 3 -o ubm.mdl -r ubm.res" );
+	step( "train_map.log", "gmmtrain", "-i ubm.mdl -t 1 -e 2 -l spk.list -m " MODE_MIXTURE " -d " MODE_DIMENSION " -a 2 -c 1 -o spk.mdl -r spk.res" );
+
+	while( k < MODE_COHORT )
+	{
+		stringstream name;
+
+		name << "c" << k;
+		list[0] = workDir + "/ubm" + name.str().substr( 1 ) + ".htk";
+		writeList( name.str() + ".list", list );
+		step( name.str() + ".log", "gmmtrain", "-i ubm.mdl -t 1 -e 2 -l " + name.str() + ".list -m " MODE_MIXTURE " -d " MODE_DIMENSION " -a 2 -c 1 -o " + name.str() + ".mdl -r " + name.str() + ".res" );
+		cohort.push_back( name.str() + ".mdl" );
+		k++;
+	}
+
+	writeList( "cohort.list", cohort );
+}
+
+//! Common gmmscore arguments: model type, mixtures and dimension.
+
+static const string modelArgs = "-t 1 -m " MODE_MIXTURE " -d " MODE_DIMENSION;
+
+//! Common gmmscore arguments of the world model.
+
+static const string worldArgs = " -w ubm.mdl -b 1";
+
+//! -O T-norm against the T-norm of separate -C scores of the target and cohort models.
+
+void tnormMode()
+{
+	const string top = " -C 5 -K cache -l tgt.list";
+	vector<double> scores;
+	double mean = 0.0, square = 0.0, reference;
+	unsigned int k = 0;
+
+	scores.push_back( singleScore( "single_spk.log", "-i spk.mdl " + modelArgs + worldArgs + top ) );
+
+	while( k < MODE_COHORT )
+	{
+		stringstream name;
+
+		name << "c" << k;
+		scores.push_back( singleScore( "single_" + name.str() + ".log", "-i " + name.str() + ".mdl " + modelArgs + worldArgs + top ) );
+		mean += scores.back();
+		square += scores.back()*scores.back();
+		k++;
+	}
+
+	mean /= (double)MODE_COHORT;
+	square = ( square - mean*mean*(double)MODE_COHORT ) / (double)( MODE_COHORT - 1 );
+	reference = ( scores[0] - mean ) / sqrt( square );
+
+	check( "tnorm", singleScore( "tnorm.log", "-i spk.mdl " + modelArgs + worldArgs + top + " -O cohort.list" ), reference );
+}
+
+//! -X trial list against separate runs of every trial as a one-file data list, exact and
+//! with -C, with caches small enough to evict.
+
+void trialsMode()
+{
+	const char *models[] = { "spk.mdl", "c0.mdl", "c1.mdl" }, *utterances[] = { "tgt0", "tgt1", "imp0", "imp1" };
+	const string paths[] = { "", " -C 5 -K cache" };
+	vector<string> trials, one( 1 );
+	unsigned int i, j, k, p = 0;
+
+	i = 0;
+	while( i < 3 )
+	{
+		j = 0;
+		while( j < 4 )
+		{
+			trials.push_back( string( models[i] ) + " " + workDir + "/" + utterances[j] + ".htk " + ( i == 0 && j < 2 ? "target" : "nontarget" ) );
+			j++;
+		}
+		i++;
+	}
+	writeList( "trials.list", trials );
+
+	while( p < 2 )
+	{
+		unlink( ( workDir + "/trials.res" ).c_str() );
+		step( "trials.log", "gmmscore", "-X trials.list " + modelArgs + worldArgs + paths[p] + " -Q 0.001 -U 0.001 -r trials.res" );
+
+		vector< vector<string> > lines = readResults( "trials.res" );
+
+		if( lines.size() != trials.size() )
+		{
+			cout << "FAIL	trials	expected " << trials.size() << " result lines, got " << lines.size() << endl;
+			failures++;
+			return;
+		}
+
+		k = 0;
+		while( k < trials.size() )
+		{
+			stringstream fields( trials[k] );
+			string model, utterance;
+
+			fields >> model >> one[0];
+			writeList( "one.list", one );
+			check( "trials" + paths[p] + " " + lines[k][0] + " " + lines[k][1].substr( lines[k][1].rfind( '/' ) + 1 ) + " " + lines[k][2], atof( lines[k].back().c_str() ), singleScore( "single.log", "-i " + model + " -l one.list " + modelArgs + worldArgs + paths[p] ) );
+			k++;
+		}
+		p++;
+	}
+}
+
+//! -I identification without pruning against separate -C scores of every model; with -E
+//! the best model has to stay the same.
+
+void identifyMode()
+{
+	const string top = " -C 5 -K cache -l tgt.list";
+	vector<string> models( 1, "spk.mdl" );
+	unsigned int k = 0;
+
+	while( k < MODE_COHORT )
+	{
+		stringstream name;
+
+		name << "c" << k++ << ".mdl";
+		models.push_back( name.str() );
+	}
+	writeList( "identify.list", models );
+
+	unlink( ( workDir + "/identify.res" ).c_str() );
+	step( "identify.log", "gmmscore", "-I identify.list -N 5 " + modelArgs + worldArgs + top + " -r identify.res" );
+
+	vector< vector<string> > lines = readResults( "identify.res" );
+
+	if( lines.size() != models.size() )
+	{
+		cout << "FAIL	identify	expected " << models.size() << " result lines, got " << lines.size() << endl;
+		failures++;
+		return;
+	}
+
+	k = 0;
+	while( k < lines.size() )
+	{
+		check( "identify rank " + lines[k][0] + " " + lines[k][1], atof( lines[k][2].c_str() ), singleScore( "single.log", "-i " + lines[k][1] + " " + modelArgs + worldArgs + top ) );
+
+		if( k > 0 && atof( lines[k][2].c_str() ) > atof( lines[k - 1][2].c_str() ) )
+		{
+			cout << "FAIL	identify rank " << lines[k][0] << " scores above rank " << lines[k - 1][0] << endl;
+			failures++;
+		}
+		k++;
+	}
+
+	unlink( ( workDir + "/pruned.res" ).c_str() );
+	step( "pruned.log", "gmmscore", "-I identify.list -N 1 -E 5 -F 50 " + modelArgs + worldArgs + top + " -r pruned.res" );
+
+	vector< vector<string> > pruned = readResults( "pruned.res" );
+
+	if( pruned.size() != 1 || pruned[0][1] != lines[0][1] )
+	{
+		cout << "FAIL	identify -E best model differs from " << lines[0][1] << endl;
+		failures++;
+		return;
+	}
+
+	check( "identify -E best " + pruned[0][1], atof( pruned[0][2].c_str() ), atof( lines[0][2].c_str() ) );
+}
+
+//! A segment result line has to hold start, end, (label,) scored frames and LLR.
+
+void checkSegment( string results, string start, string end, unsigned int fields )
+{
+	vector< vector<string> > lines = readResults( results );
+
+	if( lines.size() != 1 || lines[0].size() != fields || lines[0][0] != start || lines[0][1] != end )
+	{
+		cout << "FAIL	" << results << " is not a segment " << start << " " << end << " line" << endl;
+		failures++;
+	}
+}
+
+//! -Y segment and -J window covering the whole data list against the -l score, without and
+//! with world model and with -C.
+
+void segmentMode()
+{
+	const string paths[] = { "", worldArgs, worldArgs + " -C 5 -K cache" };
+	stringstream frames;
+	vector<string> segments;
+	unsigned int p = 0;
+
+	frames << listFrames( workDir + "/tgt.list" );
+	segments.push_back( "0 " + frames.str() + " all" );
+	writeList( "segments.list", segments );
+
+	while( p < 3 )
+	{
+		const string arguments = "-i spk.mdl -l tgt.list " + modelArgs + paths[p];
+		double reference = singleScore( "single.log", arguments );
+
+		check( "segment" + paths[p], singleScore( "segment.log", arguments + " -Y segments.list" ), reference );
+		checkSegment( "segment.log.res", "0", frames.str(), 5 );
+		check( "window" + paths[p], singleScore( "window.log", arguments + " -J " + frames.str() ), reference );
+		checkSegment( "window.log.res", "0", frames.str(), 4 );
+		p++;
+	}
+}
+
+//! LLR of the target model over tgt.list with tree selection, computed in process.
+/*!	\param nodes kept per tree level.
+	\return average selected log-likelihood of the target model minus the UBM one.
+*/
+
+double treeLLR( unsigned int width )
+{
+	const unsigned int M = atoi( MODE_MIXTURE ), D = atoi( MODE_DIMENSION );
+	Model spk( M, D, 0.1 ), ubm( M, D, 0.1 );
+	GaussianTree tree;
+	vector<string> files;
+	vector<double> frame( D );
+	double LL[2] = { 0.0, 0.0 }, value;
+	unsigned int i = 0, processed[2] = { 0, 0 };
+
+	if( spk.load( workDir + "/spk.mdl", 1 ) != 0 || ubm.load( workDir + "/ubm.mdl", 1 ) != 0 || tree.load( workDir + "/ubm.tree", D ) != 0 || ! readList( workDir + "/tgt.list", files ) )
+	{
+		cout << "Cannot load the models, the tree or the data list" << endl;
+		exit( 1 );
+	}
+
+	SelectedModel model( spk, tree, width ), world( ubm, tree, width );
+
+	while( i < files.size() )
+	{
+		HTKReader reader;
+
+		if( ! reader.open( files[i++] ) )
+		{
+			cout << "Cannot open " << files[i - 1] << endl;
+			exit( 1 );
+		}
+
+		while( reader.read( &frame[0], 1, D ) == 1 )
+		{
+			if( model.frameLogL( &frame[0], value ) )
+			{
+				LL[0] += value;
+				processed[0]++;
+			}
+			if( world.frameLogL( &frame[0], value ) )
+			{
+				LL[1] += value;
+				processed[1]++;
+			}
+		}
+	}
+
+	return LL[0]/(double)processed[0] - LL[1]/(double)processed[1];
+}
+
+//! -G tree selection with narrow and full width against the same selection computed in
+//! process; at full width also against exact scoring.
+
+void treeMode()
+{
+	const string arguments = "-i spk.mdl -l tgt.list " + modelArgs + worldArgs;
+	const unsigned int widths[] = { 1, 2, 4, (unsigned int)atoi( MODE_MIXTURE ) };
+	unsigned int k = 0;
+
+	step( "tree.log", "gmmtree", "-i ubm.mdl -m " MODE_MIXTURE " -d " MODE_DIMENSION " -o ubm.tree" );
+
+	while( k < 4 )
+	{
+		stringstream width;
+
+		width << widths[k];
+		check( "tree -W " + width.str(), singleScore( "tree_w" + width.str() + ".log", arguments + " -G ubm.tree -W " + width.str() ), treeLLR( widths[k] ) );
+		k++;
+	}
+
+	check( "tree -W " MODE_MIXTURE " exact", singleScore( "tree_full.log", arguments + " -G ubm.tree -W " MODE_MIXTURE ), singleScore( "exact.log", arguments ) );
+}
+
+//! True if a log file in the work directory holds the text.
+
+bool logHas( string log, string text )
+{
+	ifstream Flog( ( workDir + "/" + log ).c_str() );
+	string line;
+
+	while( getline( Flog, line ) )
+	{
+		if( line.find( text ) != string::npos )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//! Z-norm of a model from separate -C scores of every impostor file as a one-file data list.
+
+double znormScore( string model, const string &top )
+{
+	vector<string> impostors, one( 1 );
+	vector<double> scores;
+	double mean = 0.0, square = 0.0, raw;
+	unsigned int f = 0;
+
+	readList( workDir + "/imp.list", impostors );
+
+	while( f < impostors.size() )
+	{
+		one[0] = impostors[f++];
+		writeList( "one.list", one );
+		scores.push_back( singleScore( "single.log", "-i " + model + " -l one.list " + modelArgs + worldArgs + top ) );
+		mean += scores.back();
+	}
+	mean /= (double)scores.size();
+
+	f = 0;
+	while( f < scores.size() )
+	{
+		square += ( scores[f] - mean )*( scores[f] - mean );
+		f++;
+	}
+
+	raw = singleScore( "single.log", "-i " + model + " -l tgt.list " + modelArgs + worldArgs + top );
+
+	return ( raw - mean ) / sqrt( square / (double)( scores.size() - 1 ) );
+}
+
+//! -Z Z-norm (computed, then from the .znorm files) and -Z -O ZT-norm against the norms of
+//! separate -C scores; impostor scores that do not vary have to be rejected.
+
+void znormMode()
+{
+	const string top = " -C 5 -K cache", arguments = "-i spk.mdl -l tgt.list " + modelArgs + worldArgs + top + " -Z imp.list";
+	vector<double> scores( 1, znormScore( "spk.mdl", top ) );
+	vector<string> same( 2 );
+	double mean = 0.0, square = 0.0;
+	unsigned int k = 0;
+
+	// Statistics of earlier runs on the same corpus would be reused
+	unlink( ( workDir + "/spk.mdl.znorm" ).c_str() );
+
+	while( k < MODE_COHORT )
+	{
+		stringstream name;
+
+		name << "c" << k++ << ".mdl";
+		unlink( ( workDir + "/" + name.str() + ".znorm" ).c_str() );
+		scores.push_back( znormScore( name.str(), top ) );
+		mean += scores.back();
+	}
+	mean /= (double)MODE_COHORT;
+
+	k = 1;
+	while( k < scores.size() )
+	{
+		square += ( scores[k] - mean )*( scores[k] - mean );
+		k++;
+	}
+
+	check( "znorm", singleScore( "znorm.log", arguments ), scores[0] );
+
+	if( ! logHas( "znorm.log", "Z-norm statistics of 1 models" ) || access( ( workDir + "/spk.mdl.znorm" ).c_str(), R_OK ) != 0 )
+	{
+		cout << "FAIL	znorm did not compute and store spk.mdl.znorm" << endl;
+		failures++;
+	}
+
+	check( "znorm cached", singleScore( "znorm_cached.log", arguments ), scores[0] );
+
+	if( logHas( "znorm_cached.log", "Z-norm statistics of" ) )
+	{
+		cout << "FAIL	znorm did not reuse spk.mdl.znorm" << endl;
+		failures++;
+	}
+
+	check( "ztnorm", singleScore( "ztnorm.log", arguments + " -O cohort.list" ), ( scores[0] - mean ) / sqrt( square / (double)( MODE_COHORT - 1 ) ) );
+
+	same[0] = same[1] = workDir + "/imp0.htk";
+	writeList( "same.list", same );
+
+	if( run( "same.log", command( "gmmscore", "-i spk.mdl -l tgt.list " + modelArgs + worldArgs + top + " -Z same.list -r same.res" ) ) == 0 || ! logHas( "same.log", "do not vary" ) )
+	{
+		cout << "FAIL	znorm accepted impostor scores that do not vary" << endl;
+		failures++;
+	}
+}
+
+void printUsage( void )
+{
+	cout << "gmmmodes: help" << endl;
+	cout << endl;
+	cout << "Checks a gmmscore mode against single model gmmscore runs on a synthetic corpus." << endl;
+	cout << endl;
+	cout << "-h,  --help\t\tThis message" << endl;
+	cout << "-o,  --output\t\tWork directory (corpus, models and logs)" << endl;
+	cout << "-b,  --bindir\t\tDirectory of the tools (default: directory of gmmmodes)" << endl;
+	cout << "-M,  --mode\t\tMode to check: tnorm, znorm, trials, identify, segment, tree" << endl;
+
+	exit( -1 );
+}
+
+int main( int argc, char *argv[] )
+{
+	int nextOption;
+
+	const char * shortOptions = "ho:b:M:";
+
+	const struct option longOptions[] = {
+	{ "help", 0, NULL, 'h' },
+	{ "output", 1, NULL, 'o' },
+	{ "bindir", 1, NULL, 'b' },
+	{ "mode", 1, NULL, 'M' },
+	{ NULL, 0, NULL, 0 }
+	};
+
+	string mode;
+
+	do {
+		nextOption = getopt_long( argc, argv, shortOptions, longOptions, NULL );
+
+		switch( nextOption )
+		{
+			case 'o':
+				workDir = optarg;
+				break;
+
+			case 'b':
+				binDir = optarg;
+				break;
+
+			case 'M':
+				mode = optarg;
+				break;
+
+			case 'h':
+				printUsage();
+
+			case '?':
+				printUsage();
+
+			case -1:
+				break;
+
+			default:
+				abort();
+		}
+
+	} while( nextOption != -1 );
+
+	if( workDir.empty() || mode.empty() )
+	{
+		cout << "-o, --output and -M, --mode must be set" << endl;
+		printUsage();
+	}
+
+	char path[PATH_MAX];
+
+	if( binDir.empty() )
+	{
+		ssize_t size = readlink( "/proc/self/exe", path, sizeof( path ) - 1 );
+
+		if( size <= 0 )
+		{
+			cout << "Cannot find the tool directory, use -b" << endl;
+			exit( -1 );
+		}
+		path[size] = '\0';
+		binDir = path;
+		binDir.erase( binDir.rfind( '/' ) );
+	}
+
+	mkdir( workDir.c_str(), 0755 );
+
+	if( realpath( workDir.c_str(), path ) == NULL )
+	{
+		cout << "Cannot open work directory " << workDir << endl;
+		exit( -1 );
+	}
+	workDir = path;
+
+	corpus();
+
+	if( mode == "tnorm" )
+	{
+		tnormMode();
+	}
+	else if( mode == "znorm" )
+	{
+		znormMode();
+	}
+	else if( mode == "trials" )
+	{
+		trialsMode();
+	}
+	else if( mode == "identify" )
+	{
+		identifyMode();
+	}
+	else if( mode == "segment" )
+	{
+		segmentMode();
+	}
+	else if( mode == "tree" )
+	{
+		treeMode();
+	}
+	else
+	{
+		cout << "Unknown mode " << mode << endl;
+		printUsage();
+	}
+
+	cout << ( failures == 0 ? "All checks passed" : "Checks failed" ) << endl;
+
+	return failures == 0 ? 0 : 1;
+}